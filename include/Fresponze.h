@@ -21,6 +21,9 @@
 #include "FresponzeEnumerator.h"
 #include "FresponzeHardware.h"
 #include "FresponzeAdvancedMixer.h"
+#include "FresponzeFilters.h"
+#include "FresponzeConvolution.h"
+#include "FresponzeFdnReverb.h"
 
 #ifdef USE_FUNCS_PROTOTYPES
 typedef fr_err(FrInitializeInstance_t)(void** ppInstance);
@@ -40,7 +43,8 @@ enum MixerType
 	eMixerNoneType,
 	eMixerGameType,				// deprecated, use advanced mixer
 	eMixerAdvancedType,
-	eMixerCustomType
+	eMixerCustomType,
+	eMixerFuriousType			// multi-core version of advanced mixer
 };
 
 enum EndpointType
@@ -18,6 +18,102 @@
 #pragma once
 #include "FresponzeMixer.h"
 #include "FresponzeListener.h"
+#include "FresponzeLockFree.h"
+#include "FresponzeVoiceTable.h"
+#include "FresponzeMixerOutput.h"
+#include "FresponzeSoundBank.h"
+#include "FresponzeSpectralChain.h"
+
+#define MIXER_COMMANDS_COUNT 4096
+#define ONE_SHOT_POOL_DEFAULT_SIZE 64
+
+enum EMixerCommandType : fr_i32
+{
+	eLinkListenerCommand = 0,
+	eUnlinkListenerCommand,
+	eLinkEmitterCommand,
+	eUnlinkEmitterCommand,
+	eAddBusEffectCommand,
+	eDeleteBusEffectCommand,
+	ePlayAtCommand,
+	eStopAtCommand,
+	eLinkOutputCommand,
+	eUnlinkOutputCommand,
+	eLinkOneShotCommand
+};
+
+/*
+	Thread which renders mixer blocks. Mode is switched only by API thread,
+	and endpoint callback reports the mode which it uses, so API thread knows
+	when endpoint has finished the last block of previous mode.
+*/
+enum EMixerRenderMode : fr_i32
+{
+	eEnteringRenderMode = -2,		// endpoint is entering callback, mode isn't readed yet
+	eIdleRenderMode = -1,			// endpoint is outside of callback
+	eEndpointRenderMode = 0,		// endpoint callback renders blocks
+	eProducerRenderMode,			// producer thread renders, endpoint copies from ahead ring
+	eOfflineRenderMode				// API thread renders to file, endpoint outputs silence
+};
+
+struct MixerCommand
+{
+	fr_i32 Type;
+	ListenersNode* pListNode;
+	IBaseEmitter* pEmitter;			// command holds reference to emitter
+	fr_i32 Bus;
+	EffectNodeStruct* pEffectNode;	// new node of bus effects chain
+	IBaseEffect* pEffect;			// effect to delete, used only for search
+	fr_i64 Time;					// scheduled time in mixer clock frames
+	CMixerOutput* pOutput;			// secondary output, link command holds reference
+};
+
+/* Objects unlinked by render thread, to be freed in API thread */
+struct MixerGarbage
+{
+	ListenersNode* pListNode;
+	IBaseEmitter* pVoiceEmitter;	// reference from voice table
+	IBaseEmitter* pEmitter;			// reference from command
+	EffectNodeStruct* pEffectNode;	// unlinked node of bus effects chain
+	CMixerOutput* pOutput;			// reference from outputs list
+	IBaseEmitter* pOneShot;			// finished emitter to return to pool
+};
+
+struct MixerBus
+{
+	EffectNodeStruct* pFirstEffect = nullptr;
+	EffectNodeStruct* pFirstSpectralEffect = nullptr;	// FFTEffectType effects, processed before other effects
+	CSpectralChain SpectralChain;						// allocated by render thread with the first FFT effect
+	std::atomic<fr_f32> Volume = { 1.f };
+	fr_f32 LastVolume = 1.f;			// volume of previous block for ramping
+	fr_i32 TailFramesLeft = 0;
+};
+
+/* Mix buffers of submix buses. Every render worker has own target */
+struct BusesMixTarget
+{
+	bool IsActive[eAllBusesCount] = {};	// bus buffer was cleared and used in this block
+	C2DFloatBuffer Buffers[eAllBusesCount];
+
+	void Reset(fr_i32 Channels, fr_i32 Frames)
+	{
+		for (fr_i32 i = 0; i < eAllBusesCount; i++) {
+			Buffers[i].Resize(Channels, Frames);
+			IsActive[i] = false;
+		}
+	}
+
+	/* Buffer is cleared only when first voice is routed to bus */
+	C2DFloatBuffer& GetBuffer(fr_i32 Bus)
+	{
+		if (!IsActive[Bus]) {
+			Buffers[Bus].Clear();
+			IsActive[Bus] = true;
+		}
+
+		return Buffers[Bus];
+	}
+};
 
 class CAdvancedMixer : public IAdvancedMixer
 {
@@ -25,12 +121,107 @@ protected:
 	fr_i32 BufferedSamples = 0;
 	ListenersNode* pFirstListener = nullptr;
 	ListenersNode* pLastListener = nullptr;
+	CSoundBank SoundBank;				// used only by API thread
+	CStreamPrefetcher* pPrefetcher = nullptr;
+	CVoiceTable Voices;
+	bool IsMixSilent = true;			// no voices were added to mix buffer in this block
+	fr_i64 RenderClock = 0;				// clock of current block, used by render thread only
+	std::atomic<fr_i64> MixerClock = { 0 };
+	std::atomic<fr_i32> ResamplerDelay = { 0 };
+	std::atomic<fr_i32> DeviceDelay = { 0 };
+	std::atomic<fr_i32> VoicesBudget = { 0 };
+	std::atomic<fr_i32> VirtualVoicesCount = { 0 };
+
+	/* Submix and aux buses, changed only by render thread */
+	MixerBus Buses[eAllBusesCount];
+	MixerBus MasterBus;
+	BusesMixTarget BusesTarget;
+
+	/* Render mode, endpoint mode is changed only by endpoint thread */
+	std::atomic<fr_i32> RenderMode = { eEndpointRenderMode };
+	std::atomic<fr_i32> EndpointMode = { eIdleRenderMode };
+	std::atomic<bool> IsModeSwitching = { false };
+	IBaseEvent* pModeEvent = nullptr;
+
+	/* Render-ahead producer, thread handle is used only by API thread */
+	fr_i32 RenderAheadBlocks = 0;
+	fr_i32 AheadChannels = 0;
+	fr_ptr hProducerThread = nullptr;
+	IBaseEvent* pProducerEvent = nullptr;
+	std::atomic<bool> IsProducerTerminating = { false };
+	std::atomic<fr_i64> UnderrunsCount = { 0 };
+	CFloatBuffer AheadBuffer = {};
+	CLockFreeRingFloatBuffer AheadRing = {};
+
+	/* Sample FIFO between fixed-size render quanta and endpoint requests */
+	fr_i32 FifoChannels = 0;
+	CLockFreeRingFloatBuffer OutputFifo = {};
+
+	/* Secondary outputs, changed only by render thread */
+	CMixerOutput* pFirstOutput = nullptr;
+
+	/* One-shot emitters pool. Free emitters are taken by API thread */
+	std::atomic<fr_i32> OneShotsCount = { 0 };	// emitters owned by pool, free or playing
+	std::atomic<fr_i32> OneShotsTarget = { 0 };
+	CBoundedQueue<IBaseEmitter*> OneShotsPool = CBoundedQueue<IBaseEmitter*>(MAX_VOICES_COUNT);
+
+	static void ProducerThreadProc(void* pContext);
+	bool StartProducer();
+	void StopProducer();
+
+	/* API thread: set new mode and wait until endpoint leaves block of previous mode */
+	void SwitchRenderMode(fr_i32 NewMode);
+
+	/* Endpoint thread: returns mode for this callback */
+	fr_i32 EnterEndpoint();
+	void LeaveEndpoint();
+	bool ReadAheadRing(fr_f32* pBuffer, fr_i32 Frames, fr_i32 Channels);
+	bool ReadOutputFifo(fr_f32* pBuffer, fr_i32 Frames, fr_i32 Channels);
+	bool RenderQuantum(fr_i32 Frames, fr_i32 Channels);
 
 	void FreeStuff();
 	bool SetNewFormat(PcmFormat fmt);
 
-	bool CreateNode(ListenersNode*& pNode);
-	bool DeleteNode(ListenersNode* pNode);
+	/*
+		Listeners list and voice table are changed only by render thread.
+		API functions push commands to queue, render thread applies them
+		at block boundary and returns unlinked objects back to API thread.
+	*/
+	CBoundedQueue<MixerCommand> CommandsQueue = CBoundedQueue<MixerCommand>(MIXER_COMMANDS_COUNT);
+	CBoundedQueue<MixerGarbage> GarbageQueue = CBoundedQueue<MixerGarbage>(MIXER_COMMANDS_COUNT + MAX_VOICES_COUNT);
+
+	bool PushCommand(MixerCommand& Command);
+	void ProcessCommands();
+	void CollectGarbage();
+	void FreeGarbage(MixerGarbage& Garbage);
+	void PushGarbage(MixerGarbage& Garbage);
+	void RemoveVoice(fr_i32 VoiceIndex);
+	void RecycleOneShots();
+	void ReturnOneShot(IBaseEmitter* pEmitter);
+
+	void LinkNode(ListenersNode* pNode);
+	bool UnlinkNode(ListenersNode* pNode);
+
+	void UpdateVirtualVoices();
+	void ProcessVirtualVoice(fr_i32 VoiceIndex, fr_i32 Frames);
+
+	MixerBus* GetBus(fr_i32 Bus);
+	void FreeBusEffects(MixerBus& Bus);
+	void LinkBusEffect(MixerBus& Bus, EffectNodeStruct* pNode);
+	EffectNodeStruct* UnlinkBusEffect(MixerBus& Bus, IBaseEffect* pEffect);
+	EffectNodeStruct* UnlinkEffectNode(EffectNodeStruct*& pFirstNode, IBaseEffect* pEffect);
+	bool ProcessBus(MixerBus& Bus, C2DFloatBuffer& Buffer, bool IsActive, fr_i32 Frames, fr_i32 Channels);
+	void MixBuses(fr_i32 Frames, fr_i32 Channels);
+
+	/* Process voice and add result to bus buffer. Returns false if voice was silent */
+	bool MixVoice(fr_i32 VoiceIndex, C2DFloatBuffer& TempBuffer, BusesMixTarget& Target, fr_i32 Frames, fr_i32 Channels);
+	void MixVoiceSends(IBaseEmitter* pEmitter, C2DFloatBuffer& TempBuffer, BusesMixTarget& Target, fr_i32 Offset, fr_i32 Frames, fr_i32 Channels);
+	virtual bool MixVoices(fr_i32 Frames, fr_i32 Channels);
+	bool RenderBlock(fr_f32* pOutput, fr_i32 Frames, fr_i32 Channels);
+	bool IsVoicesFinished();
+	void UpdateResamplerDelay();
+	void WriteOutputs(fr_i32 Frames, fr_i32 Channels);
+	CMixerOutput* UnlinkOutput(CMixerOutput* pOutput);
 
 public:
 	CAdvancedMixer();
@@ -44,6 +235,7 @@ public:
 	bool Update(fr_f32* pBuffer, fr_i32 Frames, fr_i32 Channels, fr_i32 SampleRate) override;
 	bool Render(fr_i32 Frames, fr_i32 Channels, fr_i32 SampleRate) override;
 	bool Flush() override;
+	void SetDeviceDelay(fr_i32 DelayFrames) override;
 
 	bool AddEmitterToListener(ListenersNode* pListener, IBaseEmitter* pEmmiter) override;
 	bool DeleteEmitterFromListener(ListenersNode* pListener, IBaseEmitter* pEmmiter) override;
@@ -51,5 +243,36 @@ public:
 	bool CreateListener(void* pListenerOpenLink /* local or internet link */, ListenersNode*& pNewListener, PcmFormat ListFormat = {}) override;
 	bool DeleteListener(ListenersNode* pListNode) override;
 
+	bool PreloadResource(void* pListenerOpenLink) override;
+	void SetSoundBankBudget(fr_i64 MemoryBytes, fr_f32 MaxPreloadTime) override;
+	void PurgeSoundBank() override;
+
+	void SetStreamPrefetch(fr_f32 AheadTime) override;
+	fr_i64 GetStreamStarvationsCount() override;
+	void SetStreamHeadCache(fr_f32 HeadTime) override;
+
 	bool CreateEmitter(IBaseEmitter*& pEmitterToCreate, fr_i32 Type) override;
+	bool SetOneShotPoolSize(fr_i32 EmittersCount) override;
+	bool PlayOneShot(ListenersNode* pListener, const OneShotParams& Params) override;
+
+	bool SetRenderAhead(fr_i32 BlocksCount) override;
+	fr_i64 GetUnderrunsCount() override;
+
+	void SetVoicesBudget(fr_i32 RealVoicesCount) override;
+	fr_i32 GetVirtualVoicesCount() override;
+
+	bool AddBusEffect(fr_i32 Bus, IBaseEffect* pEffect) override;
+	bool DeleteBusEffect(fr_i32 Bus, IBaseEffect* pEffect) override;
+	bool SetBusVolume(fr_i32 Bus, fr_f32 Volume) override;
+	fr_f32 GetBusVolume(fr_i32 Bus) override;
+
+	bool RenderToFile(const fr_utf8* pFilePath, fr_i64 FramesCount, bool IsFloat = true) override;
+
+	bool PlayAt(IBaseEmitter* pEmitter, fr_i64 ClockTime) override;
+	bool StopAt(IBaseEmitter* pEmitter, fr_i64 ClockTime) override;
+	fr_i64 GetClock() override;
+	bool GetLatency(MixerLatency& Latency) override;
+
+	bool CreateOutput(IAudioCallback*& pOutputCallback) override;
+	bool DeleteOutput(IAudioCallback* pOutputCallback) override;
 };
\ No newline at end of file
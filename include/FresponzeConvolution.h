@@ -0,0 +1,170 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2019-2020. All rights reserved.
+* Copyright (C) Suirless, 2020. All rights reserved.
+* Fresponze - fast, simple and modern multimedia sound library
+* Apache-2 License
+**********************************************************************
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*****************************************************************/
+#pragma once
+#include "FresponzeEffect.h"
+#include "FresponzeMediaResource.h"
+#include "FresponzeFFT.h"
+
+/*
+	Non-uniform partitioned convolution. The first taps of impulse response
+	are convolved directly, so effect adds no latency. Other taps are split
+	to stages of uniform partitions, and every next stage has partitions 
+	CONVOLUTION_BLOCK_RATIO times longer than previous one:
+
+	[0, 64) - direct, [64, 512) - 64 frames blocks, [512, 4096) - 512 frames
+	blocks, [4096, end) - 4096 frames blocks.
+
+	Stage with block size N starts at offset N, so result of every block is
+	ready right before it must be played.
+*/
+#define CONVOLUTION_HEAD_LENGTH 64
+#define CONVOLUTION_BLOCK_RATIO 8
+#define CONVOLUTION_STAGES_COUNT 3
+#define CONVOLUTION_MAX_BLOCK (CONVOLUTION_HEAD_LENGTH * CONVOLUTION_BLOCK_RATIO * CONVOLUTION_BLOCK_RATIO)
+
+/* Spectra of impulse response partitions for one block size */
+struct ConvolutionStage
+{
+	fr_i32 BlockSize = 0;
+	fr_i32 BinsCount = 0;
+	fr_i32 PartitionsCount = 0;
+	CFloatBuffer Spectra = {};			// [channel][partition][real bins, imaginary bins]
+};
+
+/*
+	Impulse response in frequency domain. It's loaded once and shared by 
+	all convolution effects which use it (every effect holds reference). 
+	Impulse response must not be changed after it was set to effect.
+*/
+class CImpulseResponse : public IBaseInterface
+{
+private:
+	fr_i32 SampleRate = 0;
+	fr_i32 Channels = 0;
+	fr_i32 Frames = 0;
+	fr_i32 HeadLength = 0;
+	fr_i32 StagesCount = 0;
+	CFloatBuffer HeadTaps = {};			// [channel][CONVOLUTION_HEAD_LENGTH]
+	ConvolutionStage Stages[CONVOLUTION_STAGES_COUNT];
+	CRealFFT StagesFFT[CONVOLUTION_STAGES_COUNT];
+
+public:
+	CImpulseResponse();
+
+	/* Planar impulse response in SampleRate. Normalized response has unit energy per channel */
+	bool SetData(fr_f32** ppData, fr_i32 ChannelsCount, fr_i32 FramesCount, fr_i32 DataSampleRate, bool Normalize = true);
+
+	/* Decode resource (WAV, Opus or custom) and resample it to SampleRate of effect */
+	bool Load(IMediaResource* pResource, fr_i32 OutputSampleRate, bool Normalize = true);
+	bool LoadFile(const fr_utf8* pPath, fr_i32 OutputSampleRate, bool Normalize = true);
+
+	fr_i32 GetSampleRate() { return SampleRate; }
+	fr_i32 GetChannels() { return Channels; }
+	fr_i32 GetFrames() { return Frames; }
+	fr_i32 GetHeadLength() { return HeadLength; }
+	fr_i32 GetStagesCount() { return StagesCount; }
+
+	fr_f32* GetHeadTaps(fr_i32 Channel) { return HeadTaps.Data() + Channel * CONVOLUTION_HEAD_LENGTH; }
+	ConvolutionStage& GetStage(fr_i32 Stage) { return Stages[Stage]; }
+	CRealFFT& GetStageFFT(fr_i32 Stage) { return StagesFFT[Stage]; }
+
+	/* Real part of partition spectrum, imaginary part follows it */
+	fr_f32* GetPartition(fr_i32 Stage, fr_i32 Channel, fr_i32 Partition)
+	{
+		ConvolutionStage& StageData = Stages[Stage];
+		return StageData.Spectra.Data() + ((fr_i64)Channel * StageData.PartitionsCount + Partition) * StageData.BinsCount * 2;
+	}
+};
+
+enum EConvolutionParameter : fr_i32
+{
+	eConvolutionDryParameter,			// linear gain
+	eConvolutionWetParameter,			// linear gain
+	eConvolutionParametersCount
+};
+
+/* Frequency domain state of one channel for one stage */
+struct ConvolutionStageState
+{
+	CFloatBuffer Input = {};			// previous and current input blocks
+	CFloatBuffer History = {};			// spectra of previous input blocks (ring)
+	CFloatBuffer Accumulator = {};		// spectrum of the next output block
+	CFloatBuffer Output = {};			// output block, played while the next input block is collected
+	fr_i32 HistoryHead = 0;
+	fr_i32 PartitionsDone = 0;			// partitions of the next block which are already accumulated
+};
+
+/*
+	Convolution reverb. Sum of old partitions for the next block doesn't 
+	depend on current input, so it's computed by parts in every call, and 
+	long blocks don't make processing spikes. Channels without own channel 
+	of impulse response use the last one.
+*/
+class CConvolutionReverb final : public IBaseEffect
+{
+private:
+	PcmFormat ReverbFormat = {};
+	CImpulseResponse* pImpulseResponse = nullptr;
+	fr_i32 BlockPhase = 0;					// position in the longest block
+	fr_f32 DryGain = 1.f;
+	fr_f32 WetGain = 1.f;
+	fr_f32 LastDryGain = 1.f;
+	fr_f32 LastWetGain = 1.f;
+	bool IsGainsValid = false;				// the first block doesn't ramp gains from defaults
+	CFloatBuffer HeadHistory[MAX_CHANNELS];	// previous and current input for direct part
+	ConvolutionStageState States[MAX_CHANNELS][CONVOLUTION_STAGES_COUNT];
+	CFloatBuffer WetBuffer = {};
+	CFloatBuffer TimeBuffer = {};
+	CFloatBuffer TempBuffer = {};
+
+	void AllocateState();
+	void FreeState();
+	void ProcessHead(fr_i32 Channel, fr_f32* pInput, fr_f32* pWet, fr_i32 Frames);
+	void AccumulatePartitions(fr_i32 Channel, fr_i32 Stage, fr_i32 LastPartition);
+	void CompleteBlock(fr_i32 Channel, fr_i32 Stage);
+
+public:
+	CConvolutionReverb(CImpulseResponse* pResponse = nullptr);
+	~CConvolutionReverb() override;
+
+	/* Must be called before effect is added to emitter or bus */
+	void SetImpulseResponse(CImpulseResponse* pResponse);
+
+	bool GetEffectCategory(fr_i32& EffectCategory) override;
+	bool GetEffectType(fr_i32& EffectType) override;
+
+	bool GetPluginName(fr_string64& DescriptionString) override;
+	bool GetPluginVendor(fr_string64& DescriptionString) override;
+	bool GetPluginDescription(fr_string256& DescriptionString) override;
+
+	bool GetVariablesCount(fr_i32& CountOfVariables) override;
+	bool GetVariableDescription(fr_i32 VariableIndex, fr_string128& DescriptionString) override;
+	bool GetVariableKnob(fr_i32 VariableIndex, fr_i32& KnobType) override;
+	void SetOption(fr_i32 Option, fr_f32* pData, fr_i32 DataSize) override;
+	void GetOption(fr_i32 Option, fr_f32* pData, fr_i32 DataSize) override;
+
+	bool Process(fr_f32** ppData, fr_i32 Frames) override;
+
+	void SetFormat(PcmFormat* pFormat) override;
+	void GetFormat(PcmFormat* pFormat) override;
+
+	fr_i32 GetTailLength() override;
+};
+
+IBaseEffect* GetConvolutionReverb(CImpulseResponse* pResponse);
@@ -127,7 +127,7 @@ enum EEffectType : fr_i32
 	SoundEffectType,		// For single sound or input signal
 	PreMixEffect,			// For pre-master state, for check audio engine picture 
 	AfterMixEffect, 		// For master-channel
-	FFTEffectType			// Special FFT-effect, in FFT chain. Do not recommended add more then 2 parallel FFT effects (bad perfomance issue)
+	FFTEffectType			// Special FFT-effect, in FFT chain. Effects of one bus share forward and inverse transforms (see ProcessSpectrum)
 };
 
 /* Visualisation and knobs */
@@ -167,6 +167,24 @@ public:
 	virtual void GetFormat(PcmFormat* pFormat) = 0;
 	/* VERSION 1.2 ADDITION END */
 
+	/* VERSION 1.3 ADDITION BEGIN */
+	/* 
+		Count of frames which effect produces after the end of input 
+		signal (reverb, delay). Effect with zero tail is not processed 
+		after source stop.
+	*/
+	virtual fr_i32 GetTailLength() { return 0; }
+	/* VERSION 1.3 ADDITION END */
+
+	/* VERSION 1.4 ADDITION BEGIN */
+	/*
+		Processing of FFTEffectType effects. Spectrum of every channel is in
+		split format (Bins real and Bins imaginary values) and it's shared
+		by all FFT effects of bus, so effect changes it in place.
+	*/
+	virtual bool ProcessSpectrum(fr_f32** ppReal, fr_f32** ppImag, fr_i32 Bins) { return false; }
+	/* VERSION 1.4 ADDITION END */
+
 	/* Add functions to interface here */
 }; 
 
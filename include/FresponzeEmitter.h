@@ -45,6 +45,9 @@ protected:
 	fr_f32 VolumeLevel = 1.f;
 	fr_f32 Angle = 0;		
 	PcmFormat ListenerFormat = {};
+	fr_f32 LastGains[MAX_CHANNELS] = {};	// gains of previous block for ramping
+	fr_f32 FaderStartGains[MAX_CHANNELS] = {};	// start of ramp in the last block
+	bool IsGainsValid = false;
 
 	/* Parameters and flags */
 	fr_i32 EmitterEffectCategory = CategoryEffect;
@@ -61,7 +64,10 @@ protected:
 	};
 
 	/* Counting and support functions */
-	void ProcessInternal(fr_f32** ppData, fr_i32 Frames, fr_i32 Channels, fr_i32 SampleRate);
+	void GetChannelGains(fr_f32* pGains, fr_i32 Channels);
+	fr_i32 ReadSource(fr_f32** ppData, fr_i32 Frames);
+	bool ProcessSource(fr_f32** ppData, fr_i32 Frames, fr_i32 Channels);
+	void UpdateFaderGains(fr_i32 Channels);
 	void FreeStuff();
 
 public:
@@ -81,6 +87,7 @@ public:
 	void* GetListener() override;
 	fr_i32 GetState() override;
 	fr_i64 GetPosition() override;
+	fr_f32 GetVolume() override { return VolumeLevel; }
 
 	bool GetEffectCategory(fr_i32& EffectCategory) override;
 	bool GetEffectType(fr_i32& EffectType) override;
@@ -96,4 +103,6 @@ public:
 	void GetOption(fr_i32 Option, fr_f32* pData, fr_i32 DataSize) override;
 
 	bool Process(fr_f32** ppData, fr_i32 Frames) override;
+	bool ProcessAdd(fr_f32** ppTemp, fr_f32** ppOutput, fr_i32 Frames, fr_i32 Channels) override;
+	void GetFaderGains(fr_f32* pStartGains, fr_f32* pEndGains, fr_i32 Channels) override;
 };
@@ -0,0 +1,54 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2019-2020. All rights reserved.
+* Copyright (C) Suirless, 2020. All rights reserved.
+* Fresponze - fast, simple and modern multimedia sound library
+* Apache-2 License
+**********************************************************************
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*****************************************************************/
+#pragma once
+#include "FresponzeTypes.h"
+
+/*
+	Real FFT of power of two size. Spectrum is stored in split format: 
+	real and imaginary parts of Size / 2 + 1 bins are in separate arrays.
+	Object contains only tables, so one object can be used by many threads.
+*/
+class CRealFFT
+{
+private:
+	fr_i32 FFTSize = 0;						// real samples count
+	fr_i32 ComplexSize = 0;					// size of internal complex FFT
+	CIntBuffer BitReverse = {};
+	CFloatBuffer StageCos = {};				// twiddles of every butterfly stage, one after another
+	CFloatBuffer StageSin = {};
+	CFloatBuffer StageSinInverse = {};		// conjugated twiddles of inverse transform
+	CFloatBuffer PackCos = {};				// twiddles of real spectrum packing
+	CFloatBuffer PackSin = {};
+
+	void ComplexTransform(fr_f32* pReal, fr_f32* pImag, bool IsInverse);
+
+public:
+	CRealFFT() {}
+	CRealFFT(fr_i32 Size) { Initialize(Size); }
+
+	bool Initialize(fr_i32 Size);
+	fr_i32 GetSize() const { return FFTSize; }
+	fr_i32 GetBinsCount() const { return FFTSize / 2 + 1; }
+
+	/* pTemp must have Size floats. Input and output can't overlap */
+	void Forward(const fr_f32* pInput, fr_f32* pReal, fr_f32* pImag, fr_f32* pTemp);
+
+	/* Output is scaled by 1 / Size, so Inverse(Forward(x)) is x */
+	void Inverse(const fr_f32* pReal, const fr_f32* pImag, fr_f32* pOutput, fr_f32* pTemp);
+};
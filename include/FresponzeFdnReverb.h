@@ -0,0 +1,126 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2019-2020. All rights reserved.
+* Copyright (C) Suirless, 2020. All rights reserved.
+* Fresponze - fast, simple and modern multimedia sound library
+* Apache-2 License
+**********************************************************************
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*****************************************************************/
+#pragma once
+#include "FresponzeEffect.h"
+#include <atomic>
+
+/*
+	Feedback delay network reverb. Delay lines are stored separately and
+	network is computed by chunks not longer than the shortest delay, so
+	every stage of one chunk is a vector operation over time:
+
+	read lines -> decay and damping filter -> output taps -> Hadamard 
+	matrix (butterflies between lines) -> input injection -> write lines
+
+	Damping filters of 4 lines are computed by one biquad lanes group.
+*/
+#define FDN_MIN_LINES 8
+#define FDN_MAX_LINES 16
+#define FDN_LINES_GROUPS (FDN_MAX_LINES / FILTER_LANES)
+#define FDN_MAX_CHUNK 64
+#define FDN_MAX_ROOM_SIZE_MS 100.f		// the longest line with room size 1
+#define FDN_MAX_MODULATION_MS 1.f
+#define FDN_MAX_DECAY_TIME 30.f
+
+enum EFdnParameter : fr_i32
+{
+	eFdnRoomSizeParameter,			// 0.0f to 1.0f, scales delay lengths
+	eFdnDecayTimeParameter,			// time of 60 dB decay at low frequencies in seconds
+	eFdnDampingParameter,			// 0.0f to 1.0f, high frequencies decay faster
+	eFdnModulationParameter,		// 0.0f to 1.0f, depth of delay lines modulation
+	eFdnModulationRateParameter,	// in Hz
+	eFdnLinesParameter,				// 8 or 16 delay lines
+	eFdnDryParameter,				// linear gain
+	eFdnWetParameter,				// linear gain
+	eFdnParametersCount
+};
+
+/*
+	Algorithmic reverb for buses and emitters which can't afford convolution. 
+	Parameters can be changed from any thread, delays and filters are updated
+	by render thread only if parameters were changed since the previous block.
+	Delay buffers are allocated for the largest room, so room size changes 
+	don't allocate memory.
+*/
+class CFdnReverb final : public IBaseEffect
+{
+private:
+	PcmFormat ReverbFormat = {};
+	fr_i32 LinesCount = FDN_MIN_LINES;
+	fr_i32 ActiveLines = 0;					// lines count of allocated state
+	fr_i32 ChunkFrames = FDN_MAX_CHUNK;
+	fr_i32 LineLength = 0;					// size of ring buffer of every line
+	fr_i32 WritePosition = 0;
+	fr_f32 RoomSize = 0.5f;
+	fr_f32 DecayTime = 1.5f;
+	fr_f32 Damping = 0.5f;
+	fr_f32 Modulation = 0.2f;
+	fr_f32 ModulationRate = 0.7f;
+	fr_f32 DryGain = 1.f;
+	fr_f32 WetGain = 0.3f;
+	fr_f32 LastDryGain = 1.f;
+	fr_f32 LastWetGain = 0.3f;
+	bool IsGainsValid = false;				// the first block doesn't ramp gains from defaults
+	std::atomic<fr_i32> ParametersVersion = { 0 };
+	fr_i32 AppliedVersion = -1;
+
+	fr_i32 Delays[FDN_MAX_LINES] = {};
+	fr_f32 ModulationDepth = 0.f;			// in frames
+	fr_f64 ModulationPhase = 0.;
+	fr_f64 ModulationStep = 0.;				// phase increment per frame
+	fr_f32 OutputTaps[2][FDN_MAX_LINES] = {};
+	BiquadLanes Lanes[FDN_LINES_GROUPS] = {};
+	C2DFloatBuffer LinesBuffer = {};		// ring buffers of delay lines
+	C2DFloatBuffer ChunkBuffer = {};		// current chunk of every line
+	CFloatBuffer WetBuffer = {};
+
+	void OnParametersChanged() { ParametersVersion.fetch_add(1, std::memory_order_release); }
+	bool IsParametersChanged();
+	void AllocateState();
+	void UpdateParameters();
+	void ReadLines(fr_i32 Frames);
+	void WriteLines(fr_i32 Frames);
+	void ProcessChunk(fr_f32** ppData, fr_i32 Position, fr_i32 Frames, fr_f32** ppWet);
+
+public:
+	CFdnReverb();
+	~CFdnReverb() override;
+
+	bool GetEffectCategory(fr_i32& EffectCategory) override;
+	bool GetEffectType(fr_i32& EffectType) override;
+
+	bool GetPluginName(fr_string64& DescriptionString) override;
+	bool GetPluginVendor(fr_string64& DescriptionString) override;
+	bool GetPluginDescription(fr_string256& DescriptionString) override;
+
+	bool GetVariablesCount(fr_i32& CountOfVariables) override;
+	bool GetVariableDescription(fr_i32 VariableIndex, fr_string128& DescriptionString) override;
+	bool GetVariableKnob(fr_i32 VariableIndex, fr_i32& KnobType) override;
+	void SetOption(fr_i32 Option, fr_f32* pData, fr_i32 DataSize) override;
+	void GetOption(fr_i32 Option, fr_f32* pData, fr_i32 DataSize) override;
+
+	bool Process(fr_f32** ppData, fr_i32 Frames) override;
+
+	void SetFormat(PcmFormat* pFormat) override;
+	void GetFormat(PcmFormat* pFormat) override;
+
+	fr_i32 GetTailLength() override;
+};
+
+IBaseEffect* GetFdnReverb();
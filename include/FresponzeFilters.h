@@ -0,0 +1,165 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2019-2020. All rights reserved.
+* Copyright (C) Suirless, 2020. All rights reserved.
+* Fresponze - fast, simple and modern multimedia sound library
+* Apache-2 License
+**********************************************************************
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*****************************************************************/
+#pragma once
+#include "FresponzeEffect.h"
+#include <atomic>
+
+#define MAX_FILTER_SECTIONS 8
+#define MAX_FILTER_LANES_GROUPS ((MAX_CHANNELS / FILTER_LANES) * MAX_FILTER_SECTIONS)
+#define FILTER_MIN_FREQUENCY 10.f
+
+enum EFilterType : fr_i32
+{
+	eLowPassFilter,
+	eHighPassFilter,
+	eBandPassFilter,
+	eNotchFilter,
+	ePeakFilter,				// bell with gain
+	eLowShelfFilter,
+	eHighShelfFilter,
+	eFilterTypesCount
+};
+
+/* Parameters of one filter section. Type and sections count are passed as float too */
+enum EFilterParameter : fr_i32
+{
+	eFilterTypeParameter,
+	eFilterFrequencyParameter,	// Hz
+	eFilterQParameter,
+	eFilterGainParameter,		// dB, for peak and shelf filters
+	eFilterParametersCount
+};
+
+struct FilterSection
+{
+	fr_f32 Type = eLowPassFilter;
+	fr_f32 Frequency = 1000.f;
+	fr_f32 Q = 0.7071f;
+	fr_f32 Gain = 0.f;
+};
+
+/*
+	Shared part of filter effects. Channels are packed to SIMD lanes: mono
+	and stereo fill free lanes by cascaded sections, 3 and more channels
+	are processed by groups of 4 channels. Parameters can be changed from
+	any thread, coefficients are recomputed by render thread only if 
+	parameters were changed since the previous block.
+*/
+class CBaseFilterEffect : public IBaseEffect
+{
+protected:
+	PcmFormat FilterFormat = {};
+	fr_i32 LaneChannels = 0;				// channels in one lanes group
+	fr_i32 ChannelGroups = 0;
+	fr_i32 SectionsPerLanes = 0;
+	std::atomic<fr_i32> ParametersVersion = { 0 };
+	fr_i32 AppliedVersion = -1;
+	CFloatBuffer PaddingBuffer = {};		// fake channel for incomplete groups of 4 channels
+
+	const char* FilterName = "";
+	const char* FilterDescription = "";
+
+	/* Pointers to channels of lanes group */
+	void GetGroupChannels(fr_f32** ppData, fr_i32 Group, fr_i32 Frames, fr_f32** ppGroupData);
+	bool SetSectionOption(FilterSection& Section, fr_i32 Option, fr_f32 Value);
+	bool GetSectionOption(FilterSection& Section, fr_i32 Option, fr_f32& Value);
+	void GetSectionDescription(fr_i32 Option, fr_string128& DescriptionString);
+	void OnParametersChanged() { ParametersVersion.fetch_add(1, std::memory_order_release); }
+
+	/* Returns true if coefficients must be recomputed */
+	bool IsParametersChanged();
+
+	virtual void ResetState() = 0;
+
+public:
+	bool GetEffectCategory(fr_i32& EffectCategory) override;
+	bool GetEffectType(fr_i32& EffectType) override;
+
+	bool GetPluginName(fr_string64& DescriptionString) override;
+	bool GetPluginVendor(fr_string64& DescriptionString) override;
+	bool GetPluginDescription(fr_string256& DescriptionString) override;
+
+	void SetFormat(PcmFormat* pFormat) override;
+	void GetFormat(PcmFormat* pFormat) override;
+};
+
+/*
+	Cascade of biquad sections (RBJ cookbook), every section has own type,
+	so cascade can be used as parametric equalizer or as steep filter.
+	Option index is Section * eFilterParametersCount + parameter, and the
+	last option is count of active sections.
+*/
+#define BIQUAD_SECTIONS_OPTION (MAX_FILTER_SECTIONS * eFilterParametersCount)
+
+class CBiquadFilterEffect final : public CBaseFilterEffect
+{
+private:
+	FilterSection Sections[MAX_FILTER_SECTIONS];
+	fr_i32 SectionsCount = 1;
+	fr_i32 AppliedSectionsCount = 0;
+	BiquadLanes Lanes[MAX_FILTER_LANES_GROUPS] = {};
+
+	void UpdateCoefficients();
+	void ResetState() override;
+
+public:
+	CBiquadFilterEffect();
+
+	bool GetVariablesCount(fr_i32& CountOfVariables) override;
+	bool GetVariableDescription(fr_i32 VariableIndex, fr_string128& DescriptionString) override;
+	bool GetVariableKnob(fr_i32 VariableIndex, fr_i32& KnobType) override;
+	void SetOption(fr_i32 Option, fr_f32* pData, fr_i32 DataSize) override;
+	void GetOption(fr_i32 Option, fr_f32* pData, fr_i32 DataSize) override;
+
+	bool Process(fr_f32** ppData, fr_i32 Frames) override;
+};
+
+/*
+	Trapezoidal state variable filter. It's stable under fast modulation 
+	of frequency, so it's better for filter sweeps than biquad. Stages 
+	are equal filters in cascade, every stage adds 12 dB/oct of slope.
+*/
+#define SVF_STAGES_OPTION eFilterParametersCount
+#define MAX_SVF_STAGES 4
+
+class CSvfFilterEffect final : public CBaseFilterEffect
+{
+private:
+	FilterSection Section;
+	fr_i32 StagesCount = 1;
+	fr_i32 AppliedStagesCount = 0;
+	SvfLanes Lanes[MAX_FILTER_LANES_GROUPS] = {};
+
+	void UpdateCoefficients();
+	void ResetState() override;
+
+public:
+	CSvfFilterEffect();
+
+	bool GetVariablesCount(fr_i32& CountOfVariables) override;
+	bool GetVariableDescription(fr_i32 VariableIndex, fr_string128& DescriptionString) override;
+	bool GetVariableKnob(fr_i32 VariableIndex, fr_i32& KnobType) override;
+	void SetOption(fr_i32 Option, fr_f32* pData, fr_i32 DataSize) override;
+	void GetOption(fr_i32 Option, fr_f32* pData, fr_i32 DataSize) override;
+
+	bool Process(fr_f32** ppData, fr_i32 Frames) override;
+};
+
+IBaseEffect* GetBiquadFilter();
+IBaseEffect* GetSvfFilter();
@@ -27,6 +27,35 @@ enum EListenerState : fr_i32
 	eReplayState
 };
 
+/* Submix buses of advanced mixer. Master bus is the final mix */
+enum EMixerBus : fr_i32
+{
+	eMasterBus = -1,
+	eSfxBus = 0,
+	eMusicBus,
+	eVoiceBus,
+	eUIBus,
+	eBusesCount
+};
+
+/*
+	Aux (send/return) buses. Emitters are not routed to them, but send part
+	of own output by IBaseEmitter::SetSend, so effects of aux bus (reverb) 
+	run once for all emitters. Returns are summed to master like submix 
+	buses, and mixer bus functions accept these indices too.
+*/
+enum EMixerAuxBus : fr_i32
+{
+	eFirstAuxBus = eBusesCount,
+	eAuxBus0 = eFirstAuxBus,
+	eAuxBus1,
+	eAuxBus2,
+	eAuxBus3,
+	eAllBusesCount
+};
+
+#define AUX_BUSES_COUNT (eAllBusesCount - eFirstAuxBus)
+
 class IBaseEmitter : public IBaseEffect
 {
 protected:
@@ -34,8 +63,142 @@ protected:
 	EffectNodeStruct* pLastEffect = nullptr;
 	void* pParentListener = nullptr;
 	fr_i64 FilePosition = 0;
+	fr_u64 VoiceId = 0;			// voice handle in mixer voice table
+	fr_i32 VoicePriority = 0;
+	fr_f32 VoiceDistance = 0.f;
+	fr_i32 TailFramesLeft = 0;		// frames of effects tail after source end
+	fr_i32 OutputBus = eSfxBus;
+	bool IsPooledEmitter = false;	// owned by mixer one-shot pool
+	fr_f32 SendLevels[AUX_BUSES_COUNT] = {};
+	fr_f32 LastSendLevels[AUX_BUSES_COUNT] = {};	// levels of previous block for ramping
+	fr_u32 PreFaderSends = 0;		// bit for every aux bus
+
+	fr_i32 GetEffectsTailLength()
+	{
+		fr_i32 TailLength = 0;
+		EffectNodeStruct* pNode = pFirstEffect;
+		while (pNode) {
+			TailLength = std::max(TailLength, pNode->pEffect->GetTailLength());
+			pNode = pNode->pNext;
+		}
+
+		return TailLength;
+	}
+
+	/* Process effects by silent input until tail is finished */
+	bool ProcessTail(fr_f32** ppData, fr_i32 Frames)
+	{
+		EffectNodeStruct* pNode = pFirstEffect;
+		if (TailFramesLeft <= 0 || !pNode) {
+			TailFramesLeft = 0;
+			return false;
+		}
+
+		while (pNode) {
+			pNode->pEffect->Process(ppData, Frames);
+			pNode = pNode->pNext;
+		}
+
+		TailFramesLeft -= Frames;
+		return true;
+	}
 
 public:
+	/* Emitter is stopped, but it still has effects output */
+	bool HasTail() { return TailFramesLeft > 0; }
+
+	void SetVoiceHandle(fr_u64 Handle) { VoiceId = Handle; }
+	fr_u64 GetVoiceHandle() { return VoiceId; }
+
+	/* Pooled emitters are returned to mixer pool instead of being released */
+	void SetPooled(bool IsPooled) { IsPooledEmitter = IsPooled; }
+	bool IsPooled() { return IsPooledEmitter; }
+
+	/* 
+		Part of emitter output which goes to aux bus. Post-fader send follows 
+		emitter volume and pan, pre-fader send takes signal before them.
+	*/
+	void SetSend(fr_i32 AuxBus, fr_f32 Level, bool IsPreFader = false)
+	{
+		if (AuxBus < eFirstAuxBus || AuxBus >= eAllBusesCount) return;
+		fr_i32 SendIndex = AuxBus - eFirstAuxBus;
+		SendLevels[SendIndex] = std::max(Level, 0.f);
+		if (IsPreFader) PreFaderSends |= 1u << SendIndex;
+		else PreFaderSends &= ~(1u << SendIndex);
+	}
+
+	fr_f32 GetSendLevel(fr_i32 AuxBus) 
+	{ 
+		if (AuxBus < eFirstAuxBus || AuxBus >= eAllBusesCount) return 0.f;
+		return SendLevels[AuxBus - eFirstAuxBus];
+	}
+
+	bool IsPreFaderSend(fr_i32 AuxBus) 
+	{ 
+		if (AuxBus < eFirstAuxBus || AuxBus >= eAllBusesCount) return false;
+		return !!(PreFaderSends & (1u << (AuxBus - eFirstAuxBus)));
+	}
+
+	/* Only for emitters which are not played by mixer (pooled ones) */
+	void ClearSends()
+	{
+		memset(SendLevels, 0, sizeof(SendLevels));
+		memset(LastSendLevels, 0, sizeof(LastSendLevels));
+		PreFaderSends = 0;
+	}
+
+	/* Used by render thread: send level is ramped from the previous block value */
+	bool GetSendRamp(fr_i32 SendIndex, fr_f32& StartLevel, fr_f32& EndLevel)
+	{
+		StartLevel = LastSendLevels[SendIndex];
+		EndLevel = SendLevels[SendIndex];
+		LastSendLevels[SendIndex] = EndLevel;
+		return StartLevel > 0.f || EndLevel > 0.f;
+	}
+
+	/* Volume and pan gains of the last ProcessAdd call, for post-fader sends */
+	virtual void GetFaderGains(fr_f32* pStartGains, fr_f32* pEndGains, fr_i32 Channels)
+	{
+		for (fr_i32 i = 0; i < Channels; i++) {
+			pStartGains[i] = 1.f;
+			pEndGains[i] = 1.f;
+		}
+	}
+
+	/* 
+		Voice limiting settings. If mixer has more playing voices than 
+		budget, voices with lower priority and audibility become virtual. 
+	*/
+	void SetPriority(fr_i32 Priority) { VoicePriority = Priority; }
+	fr_i32 GetPriority() { return VoicePriority; }
+	void SetDistance(fr_f32 Distance) { VoiceDistance = Distance; }
+	fr_f32 GetDistance() { return VoiceDistance; }
+	virtual fr_f32 GetVolume() { return 1.f; }
+
+	/* Submix bus of mixer which receives emitter output */
+	void SetBus(fr_i32 Bus) { OutputBus = (Bus >= 0 && Bus < eBusesCount) ? Bus : eSfxBus; }
+	fr_i32 GetBus() { return OutputBus; }
+
+	/*
+		Accumulating process: emitter renders to ppTemp and adds result to
+		ppOutput. Emitters can override it to apply final gain and pan while
+		adding, so mixer doesn't need separate passes for gain and mixing.
+		ppTemp must keep signal before gain and pan, it's used by sends.
+	*/
+	virtual bool ProcessAdd(fr_f32** ppTemp, fr_f32** ppOutput, fr_i32 Frames, fr_i32 Channels)
+	{
+		for (fr_i32 i = 0; i < Channels; i++) {
+			memset(ppTemp[i], 0, sizeof(fr_f32) * Frames);
+		}
+
+		if (!Process(ppTemp, Frames)) return false;
+		for (fr_i32 i = 0; i < Channels; i++) {
+			MixerAddToBuffer(ppOutput[i], ppTemp[i], Frames);
+		}
+
+		return true;
+	}
+
 	virtual void AddEffect(IBaseEffect* pNewEffect) = 0;
 	virtual void DeleteEffect(IBaseEffect* pNewEffect) = 0;
 
@@ -50,21 +213,9 @@ public:
 
 IBaseEmitter* GetAdvancedEmitter();
 
-struct EmittersNode;
-struct EmittersNode 
-{
-	EmittersNode* pNext = nullptr;
-	EmittersNode* pPrev = nullptr;
-	IBaseEmitter* pEmitter = nullptr;
-};
-
 class IMediaListener : public IBaseInterface
 {
 public:
-	virtual bool AddEmitter(IBaseEmitter* pNewEmitter) = 0;
-	virtual bool DeleteEmitter(IBaseEmitter* pEmitter) = 0;
-	virtual bool GetFirstEmitter(EmittersNode** pFirstEmitter) = 0;
-
 	virtual bool SetResource(IMediaResource* pInitialResource) = 0;
 
 	virtual fr_i32 SetPosition(fr_f32 FloatPosition) = 0;		// 0.0f to 1.0f
@@ -72,6 +223,7 @@ public:
 	virtual fr_i64 GetPosition() = 0;
 
 	virtual fr_i32 GetFullFrames() = 0;
+	virtual fr_i32 GetDelay() = 0;			// resampler delay in listener format frames
 
 	virtual fr_i32 GetFormat(PcmFormat& fmt) = 0;
 	virtual fr_i32 SetFormat(PcmFormat fmt) = 0;
@@ -79,17 +231,40 @@ public:
 	virtual fr_i32 Process(fr_f32** ppOutputFloatData, fr_i32 frames) = 0;
 };
 
+#define LISTENER_CACHE_BLOCKS 8
+#define LISTENER_CACHE_DEFAULT_FRAMES 1024
+
+/* Decoded and resampled block of listener resource */
+struct ListenerCacheBlock
+{
+	fr_i64 BlockIndex = -1;
+	fr_i64 LastUse = 0;
+	fr_i32 FramesCount = 0;			// less than block size only for the end of resource
+	bool IsEnd = false;				// cursor reported the end of resource in this block
+	C2DFloatBuffer Data;
+};
+
 class CMediaListener : public IMediaListener
 {
 protected:
-	fr_i64 framesPos = 0;
+	fr_i64 framesPos = 0;				// read position in listener format frames
 	PcmFormat ResourceFormat = {};
 	PcmFormat ListenerFormat = {};
 	IMediaResource* pLocalResource = nullptr;
-	EmittersNode* pFirstEmitter = nullptr;
-	EmittersNode* pLastEmitter = nullptr;
+	IMediaCursor* pCursor = nullptr;
 
-	void FreeStuff();
+	/*
+		Emitters of one listener read the same resource from their own 
+		positions. Decoded blocks are cached, so emitters at the same or 
+		nearby positions share one decode, and cursor seeks only if 
+		requested block doesn't follow the last decoded one.
+	*/
+	ListenerCacheBlock CacheBlocks[LISTENER_CACHE_BLOCKS];
+	fr_i64 CacheUseCounter = 0;
+	fr_i32 CacheBlockFrames = LISTENER_CACHE_DEFAULT_FRAMES;
+
+	void ResetCache();
+	ListenerCacheBlock* GetCacheBlock(fr_i64 BlockIndex);
 
 public:
 	/*
@@ -101,10 +276,6 @@ public:
 	CMediaListener(IMediaResource* pInitialResource = nullptr);
 	~CMediaListener();
 
-	bool AddEmitter(IBaseEmitter* pNewEmitter) override;
-	bool DeleteEmitter(IBaseEmitter* pEmitter) override;
-	bool GetFirstEmitter(EmittersNode** pFirstEmitter) override;
-
 	bool SetResource(IMediaResource* pInitialResource) override;
 
 	fr_i32 SetPosition(fr_f32 FloatPosition) override;		// 0.0f to 1.0f
@@ -112,6 +283,7 @@ public:
 	fr_i64 GetPosition() override;
 
 	fr_i32 GetFullFrames() override;
+	fr_i32 GetDelay() override;
 
 	fr_i32 GetFormat(PcmFormat& fmt) override;
 	fr_i32 SetFormat(PcmFormat fmt) override;
@@ -126,4 +298,6 @@ struct ListenersNode
 	ListenersNode* pNext = nullptr;
 	ListenersNode* pPrev = nullptr;
 	IMediaListener* pListener = nullptr;
+	fr_i32 VoicesCount = 0;			// voices of this listener in mixer voice table
+	fr_i32 WorkerIndex = 0;			// render worker for multi-threaded mixers
 };
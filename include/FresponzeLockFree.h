@@ -0,0 +1,204 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2019-2020. All rights reserved.
+* Copyright (C) Suirless, 2020. All rights reserved.
+* Fresponze - fast, simple and modern multimedia sound library
+* Apache-2 License
+**********************************************************************
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*****************************************************************/
+#pragma once
+#include "FresponzeTypes.h"
+#include <atomic>
+
+/*
+	Single producer/single consumer ring buffer. Positions are growing
+	counters, so we don't need any extra flag to know if the ring is
+	full or empty. Only one thread may write and only one may read.
+*/
+template<typename TYPE>
+class CLockFreeRingBuffer
+{
+private:
+	fr_i64 Capacity = 0;
+	TYPE* pData = nullptr;
+	alignas(64) std::atomic<fr_i64> WritePosition = { 0 };
+	alignas(64) std::atomic<fr_i64> ReadPosition = { 0 };
+
+public:
+	CLockFreeRingBuffer() {}
+	CLockFreeRingBuffer(fr_i64 SizeOfBuffer)
+	{
+		Resize(SizeOfBuffer);
+	}
+
+	/* Not thread-safe: both sides must be stopped */
+	void Resize(fr_i64 SizeOfBuffer)
+	{
+		Free();
+		pData = (TYPE*)FastMemAlloc((fr_i32)(SizeOfBuffer * sizeof(TYPE)));
+		memset(pData, 0, SizeOfBuffer * sizeof(TYPE));
+		Capacity = SizeOfBuffer;
+	}
+
+	/* Not thread-safe: both sides must be stopped */
+	void Reset()
+	{
+		WritePosition.store(0, std::memory_order_relaxed);
+		ReadPosition.store(0, std::memory_order_relaxed);
+	}
+
+	void Free()
+	{
+		if (pData) FreeFastMemory(pData);
+		pData = nullptr;
+		Capacity = 0;
+		Reset();
+	}
+
+	fr_i64 GetCapacity()
+	{
+		return Capacity;
+	}
+
+	fr_i64 GetReadAvailable()
+	{
+		return WritePosition.load(std::memory_order_acquire) - ReadPosition.load(std::memory_order_relaxed);
+	}
+
+	fr_i64 GetWriteAvailable()
+	{
+		return Capacity - (WritePosition.load(std::memory_order_relaxed) - ReadPosition.load(std::memory_order_acquire));
+	}
+
+	/* Producer side. Returns count of written elements */
+	fr_i64 Write(const TYPE* pInput, fr_i64 Count)
+	{
+		fr_i64 WritePos = WritePosition.load(std::memory_order_relaxed);
+		fr_i64 ToWrite = std::min(Count, Capacity - (WritePos - ReadPosition.load(std::memory_order_acquire)));
+		if (ToWrite <= 0) return 0;
+
+		fr_i64 Offset = WritePos % Capacity;
+		fr_i64 FirstPart = std::min(ToWrite, Capacity - Offset);
+		memcpy(&pData[Offset], pInput, FirstPart * sizeof(TYPE));
+		if (ToWrite > FirstPart) memcpy(pData, &pInput[FirstPart], (ToWrite - FirstPart) * sizeof(TYPE));
+
+		WritePosition.store(WritePos + ToWrite, std::memory_order_release);
+		return ToWrite;
+	}
+
+	/* Consumer side. Returns count of readed elements */
+	fr_i64 Read(TYPE* pOutput, fr_i64 Count)
+	{
+		fr_i64 ReadPos = ReadPosition.load(std::memory_order_relaxed);
+		fr_i64 ToRead = std::min(Count, WritePosition.load(std::memory_order_acquire) - ReadPos);
+		if (ToRead <= 0) return 0;
+
+		fr_i64 Offset = ReadPos % Capacity;
+		fr_i64 FirstPart = std::min(ToRead, Capacity - Offset);
+		memcpy(pOutput, &pData[Offset], FirstPart * sizeof(TYPE));
+		if (ToRead > FirstPart) memcpy(&pOutput[FirstPart], pData, (ToRead - FirstPart) * sizeof(TYPE));
+
+		ReadPosition.store(ReadPos + ToRead, std::memory_order_release);
+		return ToRead;
+	}
+
+	~CLockFreeRingBuffer()
+	{
+		Free();
+	}
+};
+
+typedef CLockFreeRingBuffer<fr_f32> CLockFreeRingFloatBuffer;
+
+/*
+	Bounded multi-producer/multi-consumer queue (D. Vyukov's algorithm).
+	All cells are preallocated, so Push() and Pop() never allocate memory
+	and can be used in real-time threads. Size is rounded to power of 2.
+*/
+template<typename TYPE>
+class CBoundedQueue
+{
+private:
+	struct QueueCell
+	{
+		std::atomic<fr_i64> Sequence;
+		TYPE Data;
+	};
+
+	fr_i64 Mask = 0;
+	QueueCell* pCells = nullptr;
+	alignas(64) std::atomic<fr_i64> EnqueuePosition = { 0 };
+	alignas(64) std::atomic<fr_i64> DequeuePosition = { 0 };
+
+public:
+	CBoundedQueue(fr_i64 SizeOfQueue)
+	{
+		fr_i64 CellsCount = 2;
+		while (CellsCount < SizeOfQueue) CellsCount <<= 1;
+
+		Mask = CellsCount - 1;
+		pCells = new QueueCell[CellsCount];
+		for (fr_i64 i = 0; i < CellsCount; i++) {
+			pCells[i].Sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	bool Push(const TYPE& Data)
+	{
+		QueueCell* pCell = nullptr;
+		fr_i64 Position = EnqueuePosition.load(std::memory_order_relaxed);
+		while (true) {
+			pCell = &pCells[Position & Mask];
+			fr_i64 Difference = pCell->Sequence.load(std::memory_order_acquire) - Position;
+			if (!Difference) {
+				if (EnqueuePosition.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed)) break;
+			} else if (Difference < 0) {
+				/* Queue is full */
+				return false;
+			} else {
+				Position = EnqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+
+		pCell->Data = Data;
+		pCell->Sequence.store(Position + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool Pop(TYPE& Data)
+	{
+		QueueCell* pCell = nullptr;
+		fr_i64 Position = DequeuePosition.load(std::memory_order_relaxed);
+		while (true) {
+			pCell = &pCells[Position & Mask];
+			fr_i64 Difference = pCell->Sequence.load(std::memory_order_acquire) - (Position + 1);
+			if (!Difference) {
+				if (DequeuePosition.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed)) break;
+			} else if (Difference < 0) {
+				/* Queue is empty */
+				return false;
+			} else {
+				Position = DequeuePosition.load(std::memory_order_relaxed);
+			}
+		}
+
+		Data = pCell->Data;
+		pCell->Sequence.store(Position + Mask + 1, std::memory_order_release);
+		return true;
+	}
+
+	~CBoundedQueue()
+	{
+		delete[] pCells;
+	}
+};
@@ -19,6 +19,62 @@
 #include "FresponzeResampler.h"
 #include "FresponzeFileSystem.h"
 
+/*
+	Read cursor of media resource. Every consumer owns own cursor with own
+	decoder and resampler state, so cursors of one resource can be read 
+	from different threads at the same time. Cursor holds reference to
+	its resource.
+*/
+class IMediaCursor : public IBaseInterface
+{
+public:
+	virtual void GetFormat(PcmFormat& format) = 0;
+	virtual void SetFormat(PcmFormat outputFormat) = 0;
+
+	/* 
+		Position is in output format frames. Cursor seeks decoder only if 
+		position doesn't continue previous read. Returns count of readed 
+		frames, other frames of buffer are filled by zeros. Count is less 
+		than FramesCount only at the end of resource, and pIsEnd is set
+		if the read reached the end.
+	*/
+	virtual fr_i64 ReadAt(fr_i64 Position, fr_i64 FramesCount, fr_f32** ppFloatData, bool* pIsEnd = nullptr) = 0;
+	virtual fr_i32 GetDelay() = 0;
+};
+
+#define CURSOR_MIN_DECODE_FRAMES 256
+#define CURSOR_MAX_FLUSH_BLOCKS 64		// blocks of silence to get resampler tail after the end
+
+/* Shared part of cursors: rate conversion and channels mapping */
+class CBaseMediaCursor : public IMediaCursor
+{
+protected:
+	fr_i64 NextPosition = -1;			// output position after previous read
+	fr_i64 DecodePosition = 0;			// decoder position in file frames
+	fr_i64 MaxDecodeFrames = CURSOR_MIN_DECODE_FRAMES;
+	fr_i64 ResampledFrames = 0;			// resampled frames which weren't returned yet
+	fr_i64 ResampledOffset = 0;
+	fr_i64 EndPosition = -1;			// resource length in output frames, known after decoder reached the end
+	PcmFormat fileFormat = {};
+	PcmFormat outputFormat = {};
+	IBaseResampler* resampler = nullptr;
+	C2DFloatBuffer transferBuffers = {};
+	C2DFloatBuffer resampledBuffers = {};
+
+	/* Decode file frames from position to planar buffer. Returns count of decoded frames */
+	virtual fr_i64 Decode(fr_i64 Position, fr_i64 FramesCount, fr_f32** ppFloatData) = 0;
+	void CopyToOutput(fr_f32** ppFloatData, fr_i64 Offset, fr_f32** ppSourceData, fr_i64 SourceOffset, fr_i64 FramesCount);
+
+public:
+	~CBaseMediaCursor() override;
+
+	void GetFormat(PcmFormat& format) override;
+	void SetFormat(PcmFormat outputFormat) override;
+
+	fr_i64 ReadAt(fr_i64 Position, fr_i64 FramesCount, fr_f32** ppFloatData, bool* pIsEnd = nullptr) override;
+	fr_i32 GetDelay() override;
+};
+
 class IMediaResource : public IBaseInterface
 {
 protected:
@@ -46,4 +102,10 @@ public:
 
 	virtual fr_i64 SetPosition(fr_i64 FramePosition) = 0;
 	virtual fr_i64 GetPosition() = 0;
+
+	/* Resampler delay in output format frames */
+	virtual fr_i32 GetDelay() = 0;
+
+	/* Independent reader, see IMediaCursor */
+	virtual bool CreateCursor(IMediaCursor*& pCursor) = 0;
 };
@@ -33,6 +33,30 @@ public:
 	virtual bool Update(fr_f32* pBuffer, fr_i32 Frames, fr_i32 Channels, fr_i32 SampleRate) = 0;
 	virtual bool Render(fr_i32 Frames, fr_i32 Channels, fr_i32 SampleRate) = 0;
 	virtual bool Flush() = 0;
+	virtual void SetDeviceDelay(fr_i32 DelayFrames) = 0;
+};
+
+/* Latency breakdown, all values are in mix format frames */
+struct MixerLatency
+{
+	fr_i64 Clock;				// frames rendered by mixer
+	fr_i64 AudibleClock;		// mixer clock of sample which is audible now
+	fr_i32 QueuedFrames;		// rendered, but not sent to endpoint yet
+	fr_i32 ResamplerFrames;		// max resampler delay of playing listeners, before mixer clock
+	fr_i32 DeviceFrames;		// endpoint buffer delay (snd_pcm_delay, WASAPI padding)
+	fr_i32 TotalFrames;			// output latency after mixer clock, Clock - AudibleClock
+};
+
+/* Settings of fire-and-forget emitter */
+struct OneShotParams
+{
+	fr_f32 Volume = 1.f;
+	fr_f32 Angle = 0.f;			// pan angle, see eAngleParameter
+	fr_i32 Bus = eSfxBus;
+	fr_i32 Priority = 0;
+	fr_f32 Distance = 0.f;
+	fr_i64 StartTime = -1;		// mixer clock time, -1 to play at the next block
+	fr_f32 Sends[AUX_BUSES_COUNT] = {};	// post-fader send levels to aux buses
 };
 
 class CMixerAudioCallback final : public IAudioCallback
@@ -72,26 +96,29 @@ public:
 		return -2;
 	}
 
-	fr_err RenderCallback(fr_i32 Frames, fr_i32 Channels, fr_i32 SampleRate)
+	fr_err RenderCallback(fr_i32 Frames, fr_i32 Channels, fr_i32 SampleRate) override
 	{
 		if (!pAudioMixer) return -1;
 		return (pAudioMixer->Render(Frames, Channels, SampleRate) ? 0 : -1);
 	}
+
+	fr_err LatencyCallback(fr_i32 DeviceDelayFrames) override
+	{
+		if (!pAudioMixer) return -1;
+		pAudioMixer->SetDeviceDelay(DeviceDelayFrames);
+		return 0;
+	}
 };
 
 class IAdvancedMixer : public IAudioMixer
 {
 protected:
-	fr_i32 BufferPosition = 0;
-	fr_i32 CurrentBuffer = 0;
 	SoundState InputState = NoneState;
 	EffectNodeStruct* pInputFirstEffect = nullptr;
-	EffectNodeStruct* pMasterFirstEffect = nullptr;
 	IAudioCallback* pAudioCallback = nullptr;
 	C2DFloatBuffer mixBuffer = {};
 	C2DFloatBuffer tempBuffer = {};
 	CFloatBuffer OutputBuffer = {};
-	CRingFloatBuffer RingBuffer = {};
 	PcmFormat MixFormat = {};
 	PcmFormat InputFormat = {};
 
@@ -111,5 +138,110 @@ public:
 	virtual bool CreateListener(void* pListenerOpenLink /* local or internet link */, ListenersNode*& pNewListener, PcmFormat ListFormat = {}) = 0;
 	virtual bool DeleteListener(ListenersNode* pListNode) = 0;
 
+	/*
+		Listeners share resources by path. Assets shorter than MaxPreloadTime
+		seconds are decoded once to PCM in mix sample rate, while the memory
+		budget allows it; longer ones are streamed. PurgeSoundBank frees
+		resources which are not used by any listener.
+	*/
+	virtual bool PreloadResource(void* pListenerOpenLink) = 0;
+	virtual void SetSoundBankBudget(fr_i64 MemoryBytes, fr_f32 MaxPreloadTime) = 0;
+	virtual void PurgeSoundBank() = 0;
+
+	/*
+		Streamed resources are decoded by background thread AheadTime seconds
+		ahead, so render thread only copies decoded data. If decoder is late,
+		silence is played and counted as starvation. Pass 0 to decode streams
+		in render thread. Applies to resources which are opened after this call.
+	*/
+	virtual void SetStreamPrefetch(fr_f32 AheadTime) = 0;
+	virtual fr_i64 GetStreamStarvationsCount() = 0;
+
+	/*
+		Prefetched streams keep the first HeadTime seconds decoded in sound
+		bank memory. Playback from the start reads the head, while prefetch
+		thread decodes stream after it, so streams start as fast as preloaded
+		resources. Pass 0 to disable. Applies to resources which are opened
+		after this call.
+	*/
+	virtual void SetStreamHeadCache(fr_f32 HeadTime) = 0;
+
 	virtual bool CreateEmitter(IBaseEmitter*& pEmitterToCreate, fr_i32 Type) = 0;
+
+	/*
+		One-shots are played by emitters from preallocated pool. Emitter goes
+		back to pool when listener reaches end of stream, so steady playback
+		doesn't allocate memory. PlayOneShot fails if all pool emitters are
+		busy. Pool is created with default size on the first call.
+	*/
+	virtual bool SetOneShotPoolSize(fr_i32 EmittersCount) = 0;
+	virtual bool PlayOneShot(ListenersNode* pListener, const OneShotParams& Params) = 0;
+
+	/*
+		Render-ahead mode: producer thread renders BlocksCount blocks before
+		endpoint requests it, and endpoint callback only copies ready data.
+		Pass 0 to render inside endpoint callback (default mode).
+	*/
+	virtual bool SetRenderAhead(fr_i32 BlocksCount) = 0;
+	virtual fr_i64 GetUnderrunsCount() = 0;
+
+	/*
+		Max count of really processed voices. Other playing voices are 
+		virtual: only their position is updated. Pass 0 to disable limit.
+	*/
+	virtual void SetVoicesBudget(fr_i32 RealVoicesCount) = 0;
+	virtual fr_i32 GetVirtualVoicesCount() = 0;
+
+	/*
+		Submix buses. Emitters are routed to buses by IBaseEmitter::SetBus, 
+		every bus has own effects chain and volume, so bus effects run once 
+		per block for all emitters. eMasterBus chain is applied to final mix.
+		Aux buses (EMixerAuxBus) get signal by emitter sends, and their volume
+		is return level.
+		FFTEffectType effects of bus are processed before other effects on
+		one shared spectrum, and they delay bus by SPECTRAL_FFT_SIZE frames.
+	*/
+	virtual bool AddBusEffect(fr_i32 Bus, IBaseEffect* pEffect) = 0;
+	virtual bool DeleteBusEffect(fr_i32 Bus, IBaseEffect* pEffect) = 0;
+	virtual bool SetBusVolume(fr_i32 Bus, fr_f32 Volume) = 0;
+	virtual fr_f32 GetBusVolume(fr_i32 Bus) = 0;
+
+	/*
+		Offline render: mixer is pulled as fast as possible without endpoint,
+		and result is written to WAV file (32-bit float or 16-bit integer).
+		Pass FramesCount <= 0 to render until all emitters are stopped and
+		effects tails are finished (but not longer than 10 minutes, because
+		looping emitters never stop). Pass nullptr as file path to render 
+		without writing (for performance runs). Endpoint callbacks may still
+		be called while offline render is working, they output silence.
+	*/
+	virtual bool RenderToFile(const fr_utf8* pFilePath, fr_i64 FramesCount, bool IsFloat = true) = 0;
+
+	/*
+		Sample-accurate scheduling. Time is absolute mixer clock in frames
+		(see GetClock), emitter starts or stops at exact sample inside the
+		render block. Emitter must be added to listener before. Time in the
+		past means "at the next block".
+	*/
+	virtual bool PlayAt(IBaseEmitter* pEmitter, fr_i64 ClockTime) = 0;
+	virtual bool StopAt(IBaseEmitter* pEmitter, fr_i64 ClockTime) = 0;
+	virtual fr_i64 GetClock() = 0;			// frames rendered by mixer
+
+	/* 
+		Current latency of mixer output. AudibleClock can be used for A/V sync,
+		and queue depths to tune buffer sizes. TotalFrames is output latency 
+		only (queue and device). Resampler delay is between source position
+		and mixer clock, so source frame is heard after ResamplerFrames + 
+		TotalFrames.
+	*/
+	virtual bool GetLatency(MixerLatency& Latency) = 0;
+
+	/*
+		Secondary outputs. Mix is rendered once for primary endpoint, and
+		every output resamples and buffers it for own device. Pass created 
+		callback to hardware interface of secondary device. Primary endpoint
+		must be running, because it drives the render.
+	*/
+	virtual bool CreateOutput(IAudioCallback*& pOutputCallback) = 0;
+	virtual bool DeleteOutput(IAudioCallback* pOutputCallback) = 0;
 };
\ No newline at end of file
@@ -0,0 +1,100 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2019-2020. All rights reserved.
+* Copyright (C) Suirless, 2020. All rights reserved.
+* Fresponze - fast, simple and modern multimedia sound library
+* Apache-2 License
+**********************************************************************
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*****************************************************************/
+#pragma once
+#include "FresponzeMixer.h"
+#include "FresponzeLockFree.h"
+#include "FresponzeResampler.h"
+
+/* FIFO size in endpoint blocks. Must hide jitter between primary and secondary endpoints */
+#define MIXER_OUTPUT_FIFO_BLOCKS 4
+#define MIXER_OUTPUT_MAX_DRIFT 0.002		// max clock correction, 2000 ppm
+#define MIXER_OUTPUT_DRIFT_SMOOTHING 0.01	// FIFO level filter coefficient per block
+#define MIXER_OUTPUT_DRIFT_RANGE 0.25		// FIFO level deviation (of half FIFO) for max correction
+#define MIXER_OUTPUT_DRIFT_HISTORY 3		// frames of previous block for cubic interpolation
+
+/*
+	Secondary output of mixer. Mix is rendered only once by primary endpoint,
+	and every secondary output converts it to own channels and sample rate
+	and buffers it in own FIFO. Pass this callback to hardware interface
+	of secondary device.
+
+	Secondary device runs on own clock, so resampled mix is also stretched
+	by up to MIXER_OUTPUT_MAX_DRIFT, to keep FIFO about half full. Step of
+	this stage follows smoothed FIFO level, so clock drift is compensated
+	without dropped blocks or underruns. Underrun or overflow can still 
+	happen if device stalls for longer than FIFO.
+
+	Endpoint thread: FormatCallback and EndpointCallback (FIFO consumer).
+	Render thread: Write (FIFO producer), called by mixer for every block.
+*/
+class CMixerOutput final : public IAudioCallback
+{
+private:
+	/* Changed only by endpoint thread */
+	std::atomic<fr_i32> RequestedChannels = { 0 };
+	std::atomic<fr_i32> RequestedSampleRate = { 0 };
+	std::atomic<fr_i32> RequestedFrames = { 0 };
+	std::atomic<fr_i32> FormatVersion = { 0 };
+	std::atomic<fr_i64> UnderrunsCount = { 0 };
+	bool IsPrimed = false;
+
+	/* 
+		Changed only by render thread. FIFO and output format are changed 
+		only while ReadyVersion is not equal to FormatVersion, so endpoint
+		doesn't read them at this moment.
+	*/
+	std::atomic<fr_i32> ReadyVersion = { -1 };
+	fr_i32 ConfiguredVersion = -1;
+	fr_i32 OutputChannels = 0;
+	fr_i32 OutputSampleRate = 0;
+	fr_i32 InputFrames = 0;
+	fr_i32 InputSampleRate = 0;
+	fr_i32 MaxOutputFrames = 0;
+	IBaseResampler* pResampler = nullptr;
+	C2DFloatBuffer ChannelsBuffer = {};
+	C2DFloatBuffer ResampledBuffer = {};
+	CFloatBuffer LinearBuffer = {};
+	CLockFreeRingFloatBuffer Fifo = {};
+
+	/* Clock drift correction, input frames per output frame follow FIFO level */
+	fr_f64 DriftPosition = 1.;
+	fr_f64 SmoothedLevel = 0.;
+	fr_i32 MaxDriftFrames = 0;
+	C2DFloatBuffer DriftInput = {};
+	C2DFloatBuffer DriftOutput = {};
+
+	void Configure(fr_i32 MixFrames, fr_i32 MixSampleRate);
+	void MapChannels(fr_f32** ppMix, fr_i32 Frames, fr_i32 MixChannels);
+	fr_i32 CorrectDrift(fr_f32** ppInput, fr_i32 Frames);
+
+public:
+	CMixerOutput* pNext = nullptr;		// list of render thread
+
+	CMixerOutput();
+	~CMixerOutput();
+
+	fr_err FlushCallback() override;
+	fr_err FormatCallback(PcmFormat* fmtToSwitch) override;
+	fr_err EndpointCallback(fr_f32* pData, fr_i32 Frames, fr_i32 Channels, fr_i32 SampleRate, fr_i32 CurrentEndpointType) override;
+	fr_err RenderCallback(fr_i32 Frames, fr_i32 Channels, fr_i32 SampleRate) override;
+
+	/* Render thread: push planar mix block to output */
+	void Write(fr_f32** ppMix, fr_i32 Frames, fr_i32 MixChannels, fr_i32 MixSampleRate);
+	fr_i64 GetUnderrunsCount() { return UnderrunsCount.load(std::memory_order_relaxed); }
+};
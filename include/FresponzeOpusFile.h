@@ -53,6 +53,31 @@ public:
 
 	fr_i64 SetPosition(fr_i64 FramePosition) override;
 	fr_i64 GetPosition() override;
+
+	fr_i32 GetDelay() override;
+	bool CreateCursor(IMediaCursor*& pCursor) override;
+
+	/* Encoded file in memory, read-only, so it can be shared by decoders of cursors */
+	void GetFileMemory(fr_ptr& pFileData, fr_i64& FileSize) { pFileData = FilePtr; FileSize = PtrSize; }
+};
+
+/* Cursor has own Opus decoder over memory of resource */
+class COpusMediaCursor final : public CBaseMediaCursor
+{
+private:
+	fr_i64 DecoderPosition = 0;
+	OggOpusFile* of = nullptr;
+	COpusMediaResource* pResource = nullptr;
+	CFloatBuffer tempBuffer = {};
+
+protected:
+	fr_i64 Decode(fr_i64 Position, fr_i64 FramesCount, fr_f32** ppFloatData) override;
+
+public:
+	COpusMediaCursor(COpusMediaResource* pParentResource);
+	~COpusMediaCursor() override;
+
+	bool IsOpened() { return !!of; }
 };
 
 #endif
\ No newline at end of file
@@ -25,9 +25,14 @@ public:
     virtual ~IBaseResampler() = default;
 	virtual void Initialize(fr_i32 MaxBufferIn, fr_i32 InputSampleRate, fr_i32 OutputSampleRate, fr_i32 ChannelsCount, bool isLinear) = 0;
 	virtual void Destroy() = 0;
+	virtual void Flush() = 0;		// clear history, used after seek
 	virtual void Reset(fr_i32 MaxBufferIn, fr_i32 InputSampleRate, fr_i32 OutputSampleRate, fr_i32 ChannelsCount, bool isLinear) = 0;
 	virtual void Resample(fr_i32 frames, fr_f32** inputData, fr_f32** outputData) = 0;
 	virtual void ResampleDouble(fr_i32 frames, fr_f64** inputData, fr_f64** outputData) = 0;
+	virtual fr_i32 GetDelayTime() = 0;		// in input sample rate frames
+
+	/* Returns real count of output frames, which can be different for every block */
+	virtual fr_i32 ResampleCounted(fr_i32 frames, fr_f32** inputData, fr_f32** outputData, fr_i32 maxOutputFrames) = 0;
 };
 
 
@@ -68,12 +73,12 @@ public:
 		Flush();
 	}
 
-	fr_i32 GetDelayTime()
+	fr_i32 GetDelayTime() override
 	{
 		return DelayTime;
 	}
 
-	void Destroy()
+	void Destroy() override
 	{
 		size_t index = 0;
 		for (auto& resampler_ptr : resampler) {
@@ -91,7 +96,7 @@ public:
 		}
 	}
 
-	void Flush()
+	void Flush() override
 	{
 		for (auto& elem : StaticFloatBuffer) {
 			if (elem) memset(elem, 0, bufLength * sizeof(fr_f64));
@@ -137,6 +142,21 @@ public:
 			DoubleToFloatSingle(outputData[i], tempSecondPointer, convertedFrames);
 		}
 	}
+
+	fr_i32 ResampleCounted(fr_i32 frames, fr_f32** inputData, fr_f32** outputData, fr_i32 maxOutputFrames) override
+	{
+		fr_i32 outputFrames = 0;
+		if (frames > bufLength) Reset(frames, inSRate, outSRate, channels, lin);
+
+		FloatToDouble(inputData, StaticFloatBuffer, channels, frames);
+		for (size_t i = 0; i < channels; i++) {
+			double* tempOutputPointer = nullptr;
+			outputFrames = std::min(resampler[i]->process(StaticFloatBuffer[i], frames, tempOutputPointer), maxOutputFrames);
+			DoubleToFloatSingle(outputData[i], tempOutputPointer, outputFrames);
+		}
+
+		return outputFrames;
+	}
 };
 
 inline
@@ -85,6 +85,7 @@ public:
     void* GetListener() override;
     fr_i32 GetState() override;
     fr_i64 GetPosition() override;
+    fr_f32 GetVolume() override { return VolumeLevel; }
 
     bool GetEffectCategory(fr_i32& EffectCategory) override;
     bool GetEffectType(fr_i32& EffectType) override;
@@ -0,0 +1,138 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2019-2020. All rights reserved.
+* Copyright (C) Suirless, 2020. All rights reserved.
+* Fresponze - fast, simple and modern multimedia sound library
+* Apache-2 License
+**********************************************************************
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*****************************************************************/
+#pragma once
+#include "FresponzeMediaResource.h"
+#include "FresponzeStreaming.h"
+
+#define SOUND_BANK_DEFAULT_BUDGET (64ll * 1024 * 1024)
+#define SOUND_BANK_DEFAULT_PRELOAD_TIME 5.f
+
+/* Fully decoded resource in float planar PCM */
+class CPcmMediaResource : public IMediaResource
+{
+private:
+	C2DFloatBuffer PcmData = {};
+	IMediaCursor* pOwnCursor = nullptr;		// for stateful Read function
+
+public:
+	CPcmMediaResource();
+	~CPcmMediaResource();
+
+	/* Decode source resource to PCM with sample rate of DecodeFormat. Pass MaxFrames to decode only the head */
+	bool Decode(IMediaResource* pSourceResource, PcmFormat DecodeFormat, fr_i64 MaxFrames = -1);
+	fr_i64 GetMemorySize();
+
+	bool OpenResource(void* pResourceLinker) override;
+	bool CloseResource() override;
+
+	void GetFormat(PcmFormat& format) override;
+	void SetFormat(PcmFormat outputFormat) override;
+
+	void GetVendorName(const char*& vendorName) override;
+	void GetVendorString(const char*& vendorString) override;
+
+	fr_i64 Read(fr_i64 FramesCount, fr_f32** ppFloatData) override;
+	fr_i64 ReadRaw(fr_i64 FramesCount, fr_f32** ppFloatData) override;
+
+	fr_i64 SetPosition(fr_i64 FramePosition) override;
+	fr_i64 GetPosition() override;
+
+	fr_i32 GetDelay() override;
+	bool CreateCursor(IMediaCursor*& pCursor) override;
+
+	/* Doesn't change resource state, so it can be called from any thread */
+	fr_i64 ReadRawAt(fr_i64 Position, fr_i64 FramesCount, fr_f32** ppFloatData);
+};
+
+/* Cursor of PCM resource, it's just a memcpy if output sample rate is equal */
+class CPcmMediaCursor final : public CBaseMediaCursor
+{
+private:
+	CPcmMediaResource* pResource = nullptr;
+
+protected:
+	fr_i64 Decode(fr_i64 Position, fr_i64 FramesCount, fr_f32** ppFloatData) override;
+
+public:
+	CPcmMediaCursor(CPcmMediaResource* pParentResource);
+	~CPcmMediaCursor() override;
+};
+
+struct SoundBankEntry;
+struct SoundBankEntry
+{
+	SoundBankEntry* pNext = nullptr;
+	SoundBankEntry* pPrev = nullptr;
+	fr_u64 PathHash = 0;
+	fr_utf8* pPath = nullptr;
+	IMediaResource* pResource = nullptr;
+	fr_i64 MemorySize = 0;				// decoded resource or head of streamed one
+};
+
+/*
+	Resources shared by path. Short assets are decoded once to PCM in mix 
+	sample rate, long ones are streamed from file (by prefetch thread, if 
+	it's set). Prefetched streams can keep decoded head, so playback starts
+	without waiting for prefetch thread. Entries are sorted from last used 
+	to oldest one, and only entries which are not referenced by listeners 
+	can be evicted to fit memory budget.
+
+	Sound bank is used only by API thread.
+*/
+class CSoundBank : public IBaseInterface
+{
+private:
+	SoundBankEntry* pFirstEntry = nullptr;
+	SoundBankEntry* pLastEntry = nullptr;
+	fr_i64 MemoryBudget = SOUND_BANK_DEFAULT_BUDGET;
+	fr_i64 MemoryUsed = 0;
+	fr_f32 MaxPreloadTime = SOUND_BANK_DEFAULT_PRELOAD_TIME;
+	fr_f32 PrefetchTime = PREFETCH_DEFAULT_AHEAD_TIME;
+	fr_f32 HeadCacheTime = 0.f;
+	CStreamPrefetcher* pPrefetcher = nullptr;
+
+	SoundBankEntry* FindEntry(const fr_utf8* pPath, fr_u64 PathHash);
+	void LinkEntry(SoundBankEntry* pEntry);
+	void UnlinkEntry(SoundBankEntry* pEntry);
+	void FreeEntry(SoundBankEntry* pEntry);
+	bool Trim(fr_i64 BytesToFit);
+
+public:
+	CSoundBank();
+	~CSoundBank();
+
+	/* Max memory of decoded resources, and max duration of resource to decode it */
+	void SetMemoryBudget(fr_i64 BytesBudget);
+	void SetMaxPreloadTime(fr_f32 Seconds);
+	fr_i64 GetMemoryUsed();
+
+	/* Streamed resources opened after this call are decoded by prefetcher. Pass nullptr to disable */
+	void SetPrefetcher(CStreamPrefetcher* pStreamPrefetcher, fr_f32 AheadSeconds);
+
+	/* Decoded head duration of prefetched streams opened after this call. Pass 0 to disable */
+	void SetHeadCacheTime(fr_f32 Seconds);
+
+	/* Returns new reference to shared resource */
+	bool GetResource(const fr_utf8* pPath, PcmFormat MixFormat, IMediaResource*& pResource);
+
+	/* Free all entries which are not used by anybody */
+	void Purge();
+};
+
+void* GetFormatListener(char* pListenerOpenLink);
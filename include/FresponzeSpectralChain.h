@@ -0,0 +1,62 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2019-2020. All rights reserved.
+* Copyright (C) Suirless, 2020. All rights reserved.
+* Fresponze - fast, simple and modern multimedia sound library
+* Apache-2 License
+**********************************************************************
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*****************************************************************/
+#pragma once
+#include "FresponzeEffect.h"
+#include "FresponzeFFT.h"
+
+#define SPECTRAL_FFT_SIZE 1024
+#define SPECTRAL_OVERLAP 4
+#define SPECTRAL_HOP_SIZE (SPECTRAL_FFT_SIZE / SPECTRAL_OVERLAP)
+
+/*
+	Short-time Fourier transform stage of bus. Input is transformed once per
+	hop, every FFT effect of chain changes the same spectrum, and then one
+	inverse transform is added to output by overlap-add. Square root of Hann
+	window is used for analysis and synthesis, so unchanged spectrum gives
+	the same signal delayed by SPECTRAL_FFT_SIZE frames.
+*/
+class CSpectralChain
+{
+private:
+	fr_i32 Channels = 0;
+	fr_i32 HopPosition = 0;
+	fr_f32 OutputScale = 1.f;
+	CRealFFT FFT;
+	CFloatBuffer Window = {};
+	C2DFloatBuffer InputFrames = {};	// the last SPECTRAL_FFT_SIZE input frames
+	C2DFloatBuffer OutputFrames = {};	// overlap-add sum, the first hop is played now
+	C2DFloatBuffer RealBins = {};
+	C2DFloatBuffer ImagBins = {};
+	CFloatBuffer TimeBuffer = {};
+	CFloatBuffer TempBuffer = {};
+
+	void ProcessFrame(EffectNodeStruct* pFirstEffect);
+
+public:
+	/* Allocates buffers, must be called when chain isn't processed */
+	void SetFormat(fr_i32 ChannelsCount);
+	bool IsInitialized() { return Channels > 0; }
+	fr_i32 GetChannels() { return Channels; }
+
+	/* Clears history, so new chain doesn't play old signal */
+	void Reset();
+	fr_i32 GetLatency() { return SPECTRAL_FFT_SIZE; }
+
+	void Process(fr_f32** ppData, fr_i32 Frames, EffectNodeStruct* pFirstEffect);
+};
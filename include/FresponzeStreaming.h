@@ -0,0 +1,180 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2019-2020. All rights reserved.
+* Copyright (C) Suirless, 2020. All rights reserved.
+* Fresponze - fast, simple and modern multimedia sound library
+* Apache-2 License
+**********************************************************************
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*****************************************************************/
+#pragma once
+#include "FresponzeMediaResource.h"
+#include "FresponzeLockFree.h"
+
+#define PREFETCH_BLOCK_FRAMES 2048
+#define PREFETCH_POLL_TIME 5				// ms
+#define PREFETCH_DEFAULT_AHEAD_TIME 0.5f	// s
+#define HEAD_CACHE_WARMUP_FRAMES 512
+
+/*
+	Cursor which reads decoded PCM from ring, filled by prefetch thread.
+	Audio thread never decodes or resamples stream data. If the ring doesn't
+	have enough data, silence is returned and counted as starvation.
+
+	Prefetch thread: Prefetch (ring producer).
+	Audio thread: ReadAt (ring consumer). Random access restarts decoding
+	from new position, so streams are designed for sequential reading.
+	SetFormat must not be called while cursor is being read.
+*/
+class CPrefetchCursor final : public IMediaCursor
+{
+private:
+	IMediaCursor* pSourceCursor = nullptr;
+	fr_f32 AheadTime = PREFETCH_DEFAULT_AHEAD_TIME;
+	PcmFormat fileFormat = {};
+	PcmFormat outputFormat = {};
+	CLockFreeRingFloatBuffer Ring = {};
+
+	/* Consumer state */
+	fr_i64 NextPosition = -1;
+	fr_i64 RingPosition = 0;				// stream position of the first frame in ring
+	fr_i32 ConsumedVersion = -1;
+	CFloatBuffer ReadBuffer = {};
+	std::atomic<fr_i64> StarvationsCount = { 0 };
+
+	/* Requests to prefetch thread. Ring is changed only while ReadyVersion isn't equal to RequestVersion */
+	std::atomic<fr_i32> RequestVersion = { 0 };
+	std::atomic<fr_i32> FormatVersion = { 0 };
+	std::atomic<fr_i64> RequestedPosition = { 0 };
+	std::atomic<fr_i32> ReadyVersion = { -1 };
+	std::atomic<fr_i64> ReadyPosition = { 0 };		// stream position where decoding was started
+	std::atomic<fr_i64> EndPosition = { -1 };		// frames count of stream, after decoder reaches the end
+	std::atomic<fr_i32> SourceDelay = { 0 };
+
+	/* Prefetch thread state */
+	fr_i32 AppliedVersion = -1;
+	fr_i32 AppliedFormatVersion = 0;
+	fr_i32 RingChannels = 0;
+	fr_i64 DecodePosition = 0;
+	C2DFloatBuffer DecodeBuffer = {};
+	CFloatBuffer LinearBuffer = {};
+
+	/* Read frames from ring, or skip them if ppFloatData is null */
+	fr_i64 ReadRing(fr_f32** ppFloatData, fr_i64 FramesCount, fr_i32 Channels);
+
+public:
+	CPrefetchCursor* pNext = nullptr;		// list of prefetch thread
+
+	CPrefetchCursor(IMediaCursor* pSource, fr_f32 AheadSeconds);
+	~CPrefetchCursor() override;
+
+	void GetFormat(PcmFormat& format) override;
+	void SetFormat(PcmFormat outputFormat) override;
+	fr_i64 ReadAt(fr_i64 Position, fr_i64 FramesCount, fr_f32** ppFloatData, bool* pIsEnd = nullptr) override;
+	fr_i32 GetDelay() override;
+
+	/* 
+		Audio thread: start decoding from DecodePosition before the next read
+		at ReadPosition. Frames before ReadPosition are skipped by reader.
+	*/
+	void Prepare(fr_i64 DecodePosition, fr_i64 ReadPosition);
+
+	/* Prefetch thread: fill ring. Returns count of starvations since last call */
+	fr_i64 Prefetch();
+};
+
+/*
+	Cursor which plays the first frames of stream from decoded head, while
+	prefetch thread decodes stream from the end of head. Stream is started
+	a bit before the end of head, so decoder and resampler are settled, and
+	stream continues head from the same output frame. Warmup begins at 
+	output frame which is exactly on input frame, so restarted resampler 
+	has the same phase as head. The last frames of resampled head are 
+	computed from silence after the end of head, so stream replaces them.
+*/
+class CHeadCacheCursor final : public IMediaCursor
+{
+private:
+	IMediaCursor* pHeadCursor = nullptr;
+	CPrefetchCursor* pStreamCursor = nullptr;
+	PcmFormat fileFormat = {};
+	PcmFormat headFormat = {};
+	fr_i64 HeadFrames = 0;				// in output format frames
+	fr_i64 HandoffPosition = 0;			// the first frame which is read from stream
+	fr_i64 WarmupPosition = 0;			// in output format frames
+	fr_i32 Channels = 0;
+	bool IsWholeStream = false;			// head contains the whole stream
+
+public:
+	CHeadCacheCursor(IMediaCursor* pHead, CPrefetchCursor* pStream);
+	~CHeadCacheCursor() override;
+
+	void GetFormat(PcmFormat& format) override;
+	void SetFormat(PcmFormat outputFormat) override;
+	fr_i64 ReadAt(fr_i64 Position, fr_i64 FramesCount, fr_f32** ppFloatData, bool* pIsEnd = nullptr) override;
+	fr_i32 GetDelay() override;
+};
+
+/* Decoder thread for all streaming cursors */
+class CStreamPrefetcher : public IBaseInterface
+{
+private:
+	fr_ptr hThread = nullptr;
+	IBaseEvent* pThreadEvent = nullptr;
+	std::atomic<bool> IsTerminating = { false };
+	std::atomic<fr_i64> StarvationsCount = { 0 };
+	CPrefetchCursor* pFirstCursor = nullptr;
+	CBoundedQueue<CPrefetchCursor*> NewCursors = CBoundedQueue<CPrefetchCursor*>(1024);
+
+	static void ThreadProc(void* pContext);
+	void PrefetchAll();
+
+public:
+	CStreamPrefetcher();
+	~CStreamPrefetcher();
+
+	/* Prefetcher holds reference to cursor until nobody else uses it */
+	bool AddCursor(CPrefetchCursor* pCursor);
+	fr_i64 GetStarvationsCount();
+};
+
+/* Resource wrapper, which creates prefetching cursors */
+class CStreamedMediaResource : public IMediaResource
+{
+private:
+	IMediaResource* pSource = nullptr;
+	IMediaResource* pHead = nullptr;		// decoded first frames of source, optional
+	CStreamPrefetcher* pPrefetcher = nullptr;
+	fr_f32 AheadTime = PREFETCH_DEFAULT_AHEAD_TIME;
+
+public:
+	CStreamedMediaResource(IMediaResource* pSourceResource, CStreamPrefetcher* pStreamPrefetcher, fr_f32 AheadSeconds, IMediaResource* pHeadResource = nullptr);
+	~CStreamedMediaResource();
+
+	bool OpenResource(void* pResourceLinker) override;
+	bool CloseResource() override;
+
+	void GetFormat(PcmFormat& format) override;
+	void SetFormat(PcmFormat outputFormat) override;
+
+	void GetVendorName(const char*& vendorName) override;
+	void GetVendorString(const char*& vendorString) override;
+
+	fr_i64 Read(fr_i64 FramesCount, fr_f32** ppFloatData) override;
+	fr_i64 ReadRaw(fr_i64 FramesCount, fr_f32** ppFloatData) override;
+
+	fr_i64 SetPosition(fr_i64 FramePosition) override;
+	fr_i64 GetPosition() override;
+
+	fr_i32 GetDelay() override;
+	bool CreateCursor(IMediaCursor*& pCursor) override;
+};
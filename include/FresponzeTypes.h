@@ -416,18 +416,21 @@ public:
 	{
 		if (!pDoublePointer) return;
 		for (size_t i = 0; i < BuffersCount; i++) if (pDoublePointer[i]) {
-			pDoublePointer[i] = nullptr;
 			FreeFastMemory(pDoublePointer[i]); 
+			pDoublePointer[i] = nullptr;
 		}
 		FreeFastMemory(pDoublePointer);
+		pDoublePointer = nullptr;
+		BuffersCount = 0;
+		DataSize = 0;
 	}
 
 	void SetBuffersCount(fr_i32 NewBuffersCount)
 	{
 		TYPE** tempDoubleBuffer = (TYPE**)FastMemAlloc(sizeof(TYPE*) * (NewBuffersCount));
 		if (pDoublePointer) {
-			for (size_t i = 0; i < BuffersCount; i++) { 
-				tempDoubleBuffer[i] = pDoublePointer[i]; 
+			for (size_t i = 0; i < NewBuffersCount; i++) { 
+				tempDoubleBuffer[i] = i < BuffersCount ? pDoublePointer[i] : nullptr; 
 			}
 			FreeFastMemory(pDoublePointer);
 			pDoublePointer = nullptr;
@@ -443,12 +446,18 @@ public:
 
 	void Resize(fr_i32 NewBuffersCount, fr_i32 SizeToResize)
 	{
+		fr_i32 OldBuffersCount = BuffersCount;
 		if (NewBuffersCount > BuffersCount) SetBuffersCount(NewBuffersCount);
 		if (SizeToResize > DataSize) {
 			for (size_t i = 0; i < BuffersCount; i++) { 
 				pDoublePointer[i] = (TYPE*)FastMemTryRealloc(pDoublePointer[i], SizeToResize * sizeof(TYPE), DataSize * sizeof(TYPE));
 			}
 			DataSize = SizeToResize;
+		} else if (DataSize) {
+			/* New buffers must be allocated even if size wasn't changed */
+			for (size_t i = OldBuffersCount; i < BuffersCount; i++) {
+				pDoublePointer[i] = (TYPE*)FastMemAlloc(DataSize * sizeof(TYPE));
+			}
 		}
 	}
 
@@ -722,6 +731,16 @@ public:
 #endif
 	}
 
+	/* Used by caches to find objects which are not referenced by anybody else */
+	long GetRefCount()
+	{
+#ifdef WINDOWS_PLATFORM
+		return _InterlockedOr(&Counter, 0);
+#else
+		return __sync_fetch_and_add(&Counter, 0);
+#endif
+	}
+
 	virtual void Release()
 	{
 #ifdef WINDOWS_PLATFORM
@@ -729,7 +748,7 @@ public:
 			delete this;
 		}
 #else
-		if (__sync_fetch_and_sub(&Counter, 1) <= 0) {
+		if (__sync_sub_and_fetch(&Counter, 1) <= 0) {
 			delete this;
 		}
 #endif
@@ -746,8 +765,20 @@ public:
 	virtual void Wait() = 0;
 	virtual bool Wait(fr_i32 TimeToWait) = 0;
 	virtual bool IsRaised() = 0;
+	virtual ~IBaseEvent() = default;
 };
 
+typedef void(FrThreadFunction)(void* pContext);
+
+/*
+	Platform threads for internal workers. Real-time threads are registered
+	in "Pro Audio" MMCSS class on Windows and in SCHED_FIFO on POSIX systems
+	(if the process have rights for it).
+*/
+fr_ptr CreateAudioThread(FrThreadFunction* pThreadFunction, void* pContext, bool IsRealtime);
+void JoinAudioThread(fr_ptr pThreadHandle);
+fr_i32 GetCPUCoresCount();
+
 class IAudioCallback : public IBaseInterface
 {
 public:
@@ -755,8 +786,71 @@ public:
 	virtual fr_err FormatCallback(PcmFormat* fmtToSwitch) = 0;
 	virtual fr_err EndpointCallback(fr_f32* pData, fr_i32 Frames, fr_i32 Channels, fr_i32 SampleRate, fr_i32 CurrentEndpointType) = 0;
 	virtual fr_err RenderCallback(fr_i32 Frames, fr_i32 Channels, fr_i32 SampleRate) = 0;
+
+	/* Endpoint reports frames which are queued in device buffer, but not played yet */
+	virtual fr_err LatencyCallback(fr_i32 DeviceDelayFrames) { return 0; }
+};
+
+/*
+	State of 4 IIR filters, computed in parallel by SIMD lanes. Lane is one
+	channel of one section: lane = Section * LaneChannels + Channel, where
+	LaneChannels is 1, 2 or 4. If lanes hold more than one section, sections
+	are pipelined: every step section filters the sample which previous 
+	section produced on the previous step, so cascade doesn't wait for 
+	previous section to finish the whole block.
+*/
+#define FILTER_LANES 4
+
+/* Biquad in transposed direct form II, coefficients are normalized by a0 */
+struct alignas(16) BiquadLanes
+{
+	fr_f32 B0[FILTER_LANES];
+	fr_f32 B1[FILTER_LANES];
+	fr_f32 B2[FILTER_LANES];
+	fr_f32 A1[FILTER_LANES];
+	fr_f32 A2[FILTER_LANES];
+	fr_f32 Z1[FILTER_LANES];
+	fr_f32 Z2[FILTER_LANES];
+};
+
+/* Trapezoidal state variable filter, output = M0 * input + M1 * band + M2 * low */
+struct alignas(16) SvfLanes
+{
+	fr_f32 A1[FILTER_LANES];
+	fr_f32 A2[FILTER_LANES];
+	fr_f32 A3[FILTER_LANES];
+	fr_f32 M0[FILTER_LANES];
+	fr_f32 M1[FILTER_LANES];
+	fr_f32 M2[FILTER_LANES];
+	fr_f32 Ic1[FILTER_LANES];
+	fr_f32 Ic2[FILTER_LANES];
+};
+
+/*
+	Buffer helpers for every voice and every block. Implementation (scalar,
+	SSE2, AVX2, AVX-512 or NEON) is selected once at startup by CPU features.
+	All functions work with any channels count.
+*/
+struct FresponzeKernels
+{
+	const char* pName;
+	void(*pMixerAddToBuffer)(fr_f32* pFirstBuffer, fr_f32* pSecondBuffer, fr_i64 Samples);
+	void(*pMixerAddToBufferRamp)(fr_f32* pFirstBuffer, fr_f32* pSecondBuffer, fr_i64 Samples, fr_f32 StartGain, fr_f32 EndGain);
+	void(*pScaleBufferRamp)(fr_f32* pBuffer, fr_i64 Samples, fr_f32 StartGain, fr_f32 EndGain);
+	void(*pPlanarToLinear)(fr_f32** pPlanar, fr_f32* pLinear, fr_i32 SamplesCount, fr_i32 Channels);
+	void(*pLinearToPlanar)(fr_f32** pPlanar, fr_f32* pLinear, fr_i32 SamplesCount, fr_i32 Channels);
+	void(*pMixLinearToPlanar)(fr_f32** pPlanar, fr_f32* pLinear, fr_i32 SamplesCount, fr_i32 Channels);
+	void(*pFloatToDoubleSingle)(fr_f32* pFloat, fr_f64* pDouble, fr_i32 FramesCount);
+	void(*pDoubleToFloatSingle)(fr_f32* pFloat, fr_f64* pDouble, fr_i32 FramesCount);
+	void(*pBiquadLanes)(BiquadLanes* pLanes, fr_f32** ppData, fr_i32 Frames, fr_i32 LaneChannels);
+	void(*pSvfLanes)(SvfLanes* pLanes, fr_f32** ppData, fr_i32 Frames, fr_i32 LaneChannels);
+	void(*pComplexMultiplyAdd)(fr_f32* pOutReal, fr_f32* pOutImag, fr_f32* pFirstReal, fr_f32* pFirstImag, fr_f32* pSecondReal, fr_f32* pSecondImag, fr_i32 Count);
+	void(*pComplexButterflies)(fr_f32* pFirstReal, fr_f32* pFirstImag, fr_f32* pSecondReal, fr_f32* pSecondImag, fr_f32* pTwiddleReal, fr_f32* pTwiddleImag, fr_i32 Count);
+	void(*pSumDifference)(fr_f32* pFirstBuffer, fr_f32* pSecondBuffer, fr_i32 Count);
 };
 
+extern FRAPI FresponzeKernels FrKernels;
+
 inline
 void
 MixerAddToBuffer(
@@ -765,9 +859,34 @@ MixerAddToBuffer(
 	fr_i64 Samples
 )
 {
-	for (fr_i64 i = 0; i < Samples; i++) {
-		pFirstBuffer[i] += pSecondBuffer[i];
-	}
+	FrKernels.pMixerAddToBuffer(pFirstBuffer, pSecondBuffer, Samples);
+}
+
+/* Adds second buffer with linear gain ramp from StartGain to EndGain */
+inline
+void
+MixerAddToBufferRamp(
+	fr_f32* pFirstBuffer,
+	fr_f32* pSecondBuffer,
+	fr_i64 Samples,
+	fr_f32 StartGain,
+	fr_f32 EndGain
+)
+{
+	FrKernels.pMixerAddToBufferRamp(pFirstBuffer, pSecondBuffer, Samples, StartGain, EndGain);
+}
+
+/* Multiplies buffer in place by linear gain ramp from StartGain to EndGain */
+inline
+void
+ScaleBufferRamp(
+	fr_f32* pBuffer,
+	fr_i64 Samples,
+	fr_f32 StartGain,
+	fr_f32 EndGain
+)
+{
+	FrKernels.pScaleBufferRamp(pBuffer, Samples, StartGain, EndGain);
 }
 
 inline
@@ -779,122 +898,7 @@ PlanarToLinear(
 	fr_i32 Channels
 )
 {
-	fr_i64 index = 0;
-	fr_i64 index2 = 0;
-
-	switch (Channels)
-	{
-	case 1: {
-		while (SamplesCount >= 8) {
-			pLinear[index] = pPlanar[0][index];
-			pLinear[index + 1] = pPlanar[0][index + 1];
-			pLinear[index + 2] = pPlanar[0][index + 2];
-			pLinear[index + 3] = pPlanar[0][index + 3];
-			pLinear[index + 4] = pPlanar[0][index + 4];
-			pLinear[index + 5] = pPlanar[0][index + 5];
-			pLinear[index + 6] = pPlanar[0][index + 6];
-			pLinear[index + 7] = pPlanar[0][index + 7];
-			index += 8;
-			SamplesCount -= 8;
-		}
-	} break;
-	case 2: {
-		while (SamplesCount >= 8) {
-			fr_f32 A = pPlanar[0][index2];		
-			fr_f32 B = pPlanar[1][index2];		
-			fr_f32 C = pPlanar[0][index2 + 1];
-			fr_f32 D = pPlanar[1][index2 + 1];
-			fr_f32 E = pPlanar[0][index2 + 2];
-			fr_f32 F = pPlanar[1][index2 + 2];
-			fr_f32 G = pPlanar[0][index2 + 3];
-			fr_f32 H = pPlanar[1][index2 + 3];
-			pLinear[index] = A;
-			pLinear[index + 1] = B;
-			pLinear[index + 2] = C;
-			pLinear[index + 3] = D;
-			pLinear[index + 4] = E;
-			pLinear[index + 5] = F;
-			pLinear[index + 6] = G;
-			pLinear[index + 7] = H;
-			index += 8;
-			index2 += 4;
-			SamplesCount -= 8;
-		}
-	} break;
-	case 4: {
-		while (SamplesCount >= 8) {
-			fr_f32 A = pPlanar[0][index2];
-			fr_f32 B = pPlanar[1][index2];
-			fr_f32 C = pPlanar[2][index2];
-			fr_f32 D = pPlanar[3][index2];
-			fr_f32 E = pPlanar[0][index2 + 1];
-			fr_f32 F = pPlanar[1][index2 + 1];
-			fr_f32 G = pPlanar[2][index2 + 1];
-			fr_f32 H = pPlanar[3][index2 + 1];
-			pLinear[index] = A;
-			pLinear[index + 1] = B;
-			pLinear[index + 2] = C;
-			pLinear[index + 3] = D;
-			pLinear[index + 4] = E;
-			pLinear[index + 5] = F;
-			pLinear[index + 6] = G;
-			pLinear[index + 7] = H;
-			index += 8;
-			index2 += 2;
-			SamplesCount -= 8;
-		}
-	} break;
-	case 6: {
-		while (SamplesCount >= 6) {
-			fr_f32 A = pPlanar[0][index2];
-			fr_f32 B = pPlanar[1][index2];
-			fr_f32 C = pPlanar[2][index2];
-			fr_f32 D = pPlanar[3][index2];
-			fr_f32 E = pPlanar[4][index2];
-			fr_f32 F = pPlanar[5][index2];
-			pLinear[index] = A;
-			pLinear[index + 1] = B;
-			pLinear[index + 2] = C;
-			pLinear[index + 3] = D;
-			pLinear[index + 4] = E;
-			pLinear[index + 5] = F;
-			index += 6;
-			index2 += 1;
-			SamplesCount -= 6;
-		}
-	} break;
-	case 8: {
-		while (SamplesCount >= 8) {
-			fr_f32 A = pPlanar[0][index2];
-			fr_f32 B = pPlanar[1][index2];
-			fr_f32 C = pPlanar[2][index2];
-			fr_f32 D = pPlanar[3][index2];
-			fr_f32 E = pPlanar[4][index2];
-			fr_f32 F = pPlanar[5][index2];
-			fr_f32 G = pPlanar[6][index2];
-			fr_f32 H = pPlanar[7][index2];
-			pLinear[index] = A;
-			pLinear[index + 1] = B;
-			pLinear[index + 2] = C;
-			pLinear[index + 3] = D;
-			pLinear[index + 4] = E;
-			pLinear[index + 5] = F;
-			pLinear[index + 6] = G;
-			pLinear[index + 7] = H;
-			index += 8;
-			index2++;
-			SamplesCount -= 8;
-		}
-	} break;
-	default:
-		break;
-	}
-
-	while (SamplesCount > 0) {
-		pLinear[index] = pPlanar[index % Channels][index / Channels];
-		index++;
-		SamplesCount--;
-	}
+	FrKernels.pPlanarToLinear(pPlanar, pLinear, SamplesCount, Channels);
 }
 
 inline
@@ -906,125 +910,9 @@ LinearToPlanar(
 	fr_i32 Channels
 )
 {
-	fr_i64 index = 0;
-	fr_i64 index2 = 0;
-
-	switch (Channels)
-	{
-	case 1: {
-		while (SamplesCount >= 8) {
-			pPlanar[0][index] = pLinear[index];
-			pPlanar[0][index + 1] = pLinear[index + 1];
-			pPlanar[0][index + 2] = pLinear[index + 2];
-			pPlanar[0][index + 3] = pLinear[index + 3];
-			pPlanar[0][index + 4] = pLinear[index + 4];
-			pPlanar[0][index + 5] = pLinear[index + 5];
-			pPlanar[0][index + 6] = pLinear[index + 6];
-			pPlanar[0][index + 7] = pLinear[index + 7];
-			index += 8;
-			SamplesCount -= 8;
-		}
-	} break;
-	case 2: {
-		while (SamplesCount >= 8) {
-			fr_f32 A = pLinear[index];
-			fr_f32 B = pLinear[index + 1];
-			fr_f32 C = pLinear[index + 2];
-			fr_f32 D = pLinear[index + 3];
-			fr_f32 E = pLinear[index + 4];
-			fr_f32 F = pLinear[index + 5];
-			fr_f32 G = pLinear[index + 6];
-			fr_f32 H = pLinear[index + 7];
-			pPlanar[0][index2] = A;
-			pPlanar[1][index2] = B;
-			pPlanar[0][index2 + 1] = C;
-			pPlanar[1][index2 + 1] = D;
-			pPlanar[0][index2 + 2] = E;
-			pPlanar[1][index2 + 2] = F;
-			pPlanar[0][index2 + 3] = G;
-			pPlanar[1][index2 + 3] = H; 
-			index += 8;
-			index2 += 4;
-			SamplesCount -= 8;
-		}
-	} break;
-	case 4: {
-		while (SamplesCount >= 8) {
-			fr_f32 A = pLinear[index];
-			fr_f32 B = pLinear[index + 1];
-			fr_f32 C = pLinear[index + 2];
-			fr_f32 D = pLinear[index + 3];
-			fr_f32 E = pLinear[index + 4];
-			fr_f32 F = pLinear[index + 5];
-			fr_f32 G = pLinear[index + 6];
-			fr_f32 H = pLinear[index + 7];
-			pPlanar[0][index2] = A;
-			pPlanar[1][index2] = B;
-			pPlanar[2][index2] = C;
-			pPlanar[3][index2] = D;
-			pPlanar[0][index2 + 1] = E;
-			pPlanar[1][index2 + 1] = F;
-			pPlanar[2][index2 + 1] = G;
-			pPlanar[3][index2 + 1] = H;
-			index += 8;
-			index2 += 2;
-			SamplesCount -= 8;
-		}
-	} break;
-	case 6: {
-		while (SamplesCount >= 6) {
-			fr_f32 A = pLinear[index];
-			fr_f32 B = pLinear[index + 1];
-			fr_f32 C = pLinear[index + 2];
-			fr_f32 D = pLinear[index + 3];
-			fr_f32 E = pLinear[index + 4];
-			fr_f32 F = pLinear[index + 5];
-			pPlanar[0][index2] = A;
-			pPlanar[1][index2] = B;
-			pPlanar[2][index2] = C;
-			pPlanar[3][index2] = D;
-			pPlanar[4][index2] = E;
-			pPlanar[5][index2] = F;
-			index += 6;
-			index2 += 1;
-			SamplesCount -= 6;
-		}
-	} break;
-	case 8: {
-		while (SamplesCount >= 8) {
-			fr_f32 A = pLinear[index];
-			fr_f32 B = pLinear[index + 1];
-			fr_f32 C = pLinear[index + 2];
-			fr_f32 D = pLinear[index + 3];
-			fr_f32 E = pLinear[index + 4];
-			fr_f32 F = pLinear[index + 5];
-			fr_f32 G = pLinear[index + 6];
-			fr_f32 H = pLinear[index + 7];
-			pPlanar[0][index2] = A;
-			pPlanar[1][index2] = B;
-			pPlanar[2][index2] = C;
-			pPlanar[3][index2] = D;
-			pPlanar[4][index2] = E;
-			pPlanar[5][index2] = F;
-			pPlanar[6][index2] = G;
-			pPlanar[7][index2] = H;
-			index += 8;
-			index2++;
-			SamplesCount -= 8;
-		}
-	} break;
-	default:
-		break;
-	}
-
-	while (SamplesCount > 0){
-		pPlanar[index % Channels][index / Channels] = pLinear[index];
-		index++;
-		SamplesCount--;
-	}
+	FrKernels.pLinearToPlanar(pPlanar, pLinear, SamplesCount, Channels);
 }
 
-
 inline
 bool
 MixComplexToArray(
@@ -1035,12 +923,8 @@ MixComplexToArray(
 )
 {
 	if (!pComplex || !ppArray || !*ppArray) return false;
-
-	for (fr_i64 i = 0; i < FramesToConvert / Channels; i++) {
-		for (fr_i32 o = 0; o < Channels; o++) {
-			ppArray[o][i] += pComplex[i * Channels + o];
-		}
-	}
+	FrKernels.pMixLinearToPlanar(ppArray, pComplex, FramesToConvert, Channels);
+	return true;
 }
 
 inline
@@ -1053,11 +937,7 @@ FloatToDouble(
 )
 {
 	for (fr_i32 i = 0; i < ChannelsCount; i++) {
-		fr_f32* pTempData = pFloat[i];
-		fr_f64* pDoubleData = pDouble[i];
-		for (fr_i32 o = 0; o < FramesCount; o++) {
-			pDoubleData[o] = pTempData[o];
-		}
+		FrKernels.pFloatToDoubleSingle(pFloat[i], pDouble[i], FramesCount);
 	}
 }
 
@@ -1071,11 +951,7 @@ DoubleToFloat(
 )
 {
 	for (fr_i32 i = 0; i < ChannelsCount; i++) {
-		fr_f32* pTempData = pFloat[i];
-		fr_f64* pDoubleData = pDouble[i];
-		for (fr_i32 o = 0; o < FramesCount; o++) {
-			pTempData[o] = (fr_f32)pDoubleData[o];
-		}
+		FrKernels.pDoubleToFloatSingle(pFloat[i], pDouble[i], FramesCount);
 	}
 }
 
@@ -1087,9 +963,76 @@ DoubleToFloatSingle(
 	fr_i32 FramesCount
 )
 {
-	for (fr_i32 o = 0; o < FramesCount; o++) {
-		pFloat[o] = (fr_f32)pDouble[o];
-	}
+	FrKernels.pDoubleToFloatSingle(pFloat, pDouble, FramesCount);
+}
+
+/* Filter LaneChannels channels of ppData in place by all sections of lanes */
+inline
+void
+ProcessBiquadLanes(
+	BiquadLanes* pLanes,
+	fr_f32** ppData,
+	fr_i32 Frames,
+	fr_i32 LaneChannels
+)
+{
+	FrKernels.pBiquadLanes(pLanes, ppData, Frames, LaneChannels);
+}
+
+inline
+void
+ProcessSvfLanes(
+	SvfLanes* pLanes,
+	fr_f32** ppData,
+	fr_i32 Frames,
+	fr_i32 LaneChannels
+)
+{
+	FrKernels.pSvfLanes(pLanes, ppData, Frames, LaneChannels);
+}
+
+/* Out += First * Second for spectra in split format (real and imaginary arrays) */
+inline
+void
+ComplexMultiplyAdd(
+	fr_f32* pOutReal,
+	fr_f32* pOutImag,
+	fr_f32* pFirstReal,
+	fr_f32* pFirstImag,
+	fr_f32* pSecondReal,
+	fr_f32* pSecondImag,
+	fr_i32 Count
+)
+{
+	FrKernels.pComplexMultiplyAdd(pOutReal, pOutImag, pFirstReal, pFirstImag, pSecondReal, pSecondImag, Count);
+}
+
+/* Radix-2 FFT butterflies: T = Second * Twiddle, Second = First - T, First = First + T */
+inline
+void
+ComplexButterflies(
+	fr_f32* pFirstReal,
+	fr_f32* pFirstImag,
+	fr_f32* pSecondReal,
+	fr_f32* pSecondImag,
+	fr_f32* pTwiddleReal,
+	fr_f32* pTwiddleImag,
+	fr_i32 Count
+)
+{
+	FrKernels.pComplexButterflies(pFirstReal, pFirstImag, pSecondReal, pSecondImag, pTwiddleReal, pTwiddleImag, Count);
+}
+
+/* Hadamard butterfly: First = First + Second, Second = First - Second */
+inline
+void
+SumDifference(
+	fr_f32* pFirstBuffer,
+	fr_f32* pSecondBuffer,
+	fr_i32 Count
+)
+{
+	FrKernels.pSumDifference(pFirstBuffer, pSecondBuffer, Count);
 }
 
 #ifdef WINDOWS_PLATFORM
@@ -1222,6 +1165,17 @@ private:
 };
 #endif
 
+inline
+IBaseEvent*
+CreatePlatformEvent()
+{
+#ifdef WINDOWS_PLATFORM
+	return new CWinEvent();
+#else
+	return new CPosixEvent();
+#endif
+}
+
 enum EFSOpenFlags
 {
 	eNoFlag = 0x0,
@@ -0,0 +1,99 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2019-2020. All rights reserved.
+* Copyright (C) Suirless, 2020. All rights reserved.
+* Fresponze - fast, simple and modern multimedia sound library
+* Apache-2 License
+**********************************************************************
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*****************************************************************/
+#pragma once
+#include "FresponzeListener.h"
+
+#define MAX_VOICES_COUNT 4096
+#define INVALID_VOICE_HANDLE 0
+#define NO_SCHEDULED_TIME -1
+
+enum EVoiceFlags : fr_i32
+{
+	eVoiceRealFlag = 0,
+	eVoiceVirtualFlag = 1 << 0		// only playback position is updated
+};
+
+/*
+	Voice handle: low 32 bits are slot index, high 32 bits are slot
+	generation. Generation is increased when voice is removed, so old
+	handles to reused slot are invalid. Generation 0 is never used.
+*/
+typedef fr_u64 VoiceHandle;
+
+/*
+	Table of active voices in structure-of-arrays layout. Every column is
+	contiguous and aligned to cache line, voices are packed densely, so 
+	render loop walks plain arrays. Add and remove are O(1): free slots 
+	are kept in stack, removed voice is replaced by the last one. 
+	All memory is allocated in constructor, so the table can be changed 
+	in render thread.
+*/
+class CVoiceTable
+{
+private:
+	fr_i32 Capacity = 0;
+	fr_i32 VoicesCount = 0;
+	fr_i32 FreeSlotsCount = 0;
+	void* pMemory = nullptr;
+
+	/* Dense columns (by voice index) */
+	IBaseEmitter** pEmitters = nullptr;
+	ListenersNode** pListeners = nullptr;
+	fr_i32* pStates = nullptr;
+	fr_f32* pGains = nullptr;
+	fr_i64* pPositions = nullptr;
+	fr_i32* pPriorities = nullptr;
+	fr_f32* pAudibilities = nullptr;
+	fr_i32* pFlags = nullptr;
+	fr_i64* pStartTimes = nullptr;	// scheduled start in mixer clock frames
+	fr_i64* pStopTimes = nullptr;	// scheduled stop in mixer clock frames
+	fr_i32* pSlots = nullptr;
+	fr_i32* pOrder = nullptr;		// scratch column for sorting, not moved on remove
+
+	/* Sparse columns (by handle slot) */
+	fr_u32* pGenerations = nullptr;
+	fr_i32* pIndices = nullptr;
+	fr_i32* pFreeSlots = nullptr;
+
+public:
+	CVoiceTable(fr_i32 MaxVoicesCount = MAX_VOICES_COUNT);
+	~CVoiceTable();
+
+	VoiceHandle Add(IBaseEmitter* pEmitter, ListenersNode* pListNode);
+	bool Remove(VoiceHandle Handle);
+	void RemoveAt(fr_i32 VoiceIndex);
+
+	/* Returns -1 if handle is invalid or voice was removed */
+	fr_i32 GetIndex(VoiceHandle Handle);
+
+	fr_i32 GetCount() { return VoicesCount; }
+	fr_i32 GetCapacity() { return Capacity; }
+
+	IBaseEmitter** GetEmitters() { return pEmitters; }
+	ListenersNode** GetListeners() { return pListeners; }
+	fr_i32* GetStates() { return pStates; }
+	fr_f32* GetGains() { return pGains; }
+	fr_i64* GetPositions() { return pPositions; }
+	fr_i32* GetPriorities() { return pPriorities; }
+	fr_f32* GetAudibilities() { return pAudibilities; }
+	fr_i32* GetFlags() { return pFlags; }
+	fr_i64* GetStartTimes() { return pStartTimes; }
+	fr_i64* GetStopTimes() { return pStopTimes; }
+	fr_i32* GetOrder() { return pOrder; }
+};
@@ -42,4 +42,50 @@ public:
 
 	fr_i64 SetPosition(fr_i64 FramePosition) override;
 	fr_i64 GetPosition() override;
+
+	fr_i32 GetDelay() override;
+	bool CreateCursor(IMediaCursor*& pCursor) override;
+
+	/* Doesn't change resource state, so it can be called from any thread */
+	fr_i64 ReadRawAt(fr_i64 Position, fr_i64 FramesCount, fr_f32** ppFloatData);
+};
+
+/* Mapped file is read directly, so cursor has only resampler state */
+class CRIFFMediaCursor final : public CBaseMediaCursor
+{
+private:
+	CRIFFMediaResource* pResource = nullptr;
+
+protected:
+	fr_i64 Decode(fr_i64 Position, fr_i64 FramesCount, fr_f32** ppFloatData) override;
+
+public:
+	CRIFFMediaCursor(CRIFFMediaResource* pParentResource);
+	~CRIFFMediaCursor() override;
+};
+
+/*
+	Streaming WAV writer. Data is written by blocks, and header is 
+	updated with real sizes when file is closed. Format.IsFloat selects 
+	32-bit float samples, otherwise samples are stored as 16-bit integer.
+*/
+class CRIFFWriter : public IBaseInterface
+{
+private:
+	FILE* pFile = nullptr;
+	PcmFormat FileFormat = {};
+	fr_i64 DataBytes = 0;
+	CShortBuffer ConvertBuffer = {};
+
+	bool WriteHeader();
+
+public:
+	CRIFFWriter();
+	~CRIFFWriter();
+
+	bool Open(const fr_utf8* pFilePath, PcmFormat Format);
+	bool Write(fr_f32* pLinearData, fr_i64 FramesCount);
+	bool Close();
+
+	fr_i64 GetWrittenFrames();
 };
@@ -21,33 +21,93 @@
 #include "FresponzeMasterEmitter.h"
 #include "FresponzeResonanceEmitter.h"
 
-#define RING_BUFFERS_COUNT 2
+#define OUTPUT_FIFO_BLOCKS 2
+#define OFFLINE_MAX_SILENT_RENDER_SECONDS 600
 
 CAdvancedMixer::CAdvancedMixer()
 {
 	AddRef();
+	pModeEvent = CreatePlatformEvent();
 }
 
 CAdvancedMixer::~CAdvancedMixer()
 {
+	StopProducer();
+	if (pProducerEvent) delete pProducerEvent;
+	if (pModeEvent) delete pModeEvent;
+
+	/* No render thread anymore, so we can apply all pending commands here */
+	ProcessCommands();
+	CollectGarbage();
 	FreeStuff();
+	_RELEASE(pPrefetcher);
 }
 
 void
 CAdvancedMixer::FreeStuff()
 {
 	ListenersNode* pNode = pFirstListener;
+	while (Voices.GetCount()) {
+		IBaseEmitter* pEmitter = Voices.GetEmitters()[0];
+		Voices.RemoveAt(0);
+		pEmitter->SetVoiceHandle(INVALID_VOICE_HANDLE);
+		pEmitter->SetListener(nullptr);
+		_RELEASE(pEmitter);
+	}
+
+	/* Playing one-shots were released with voice table, so only free ones are left */
+	IBaseEmitter* pOneShot = nullptr;
+	while (OneShotsPool.Pop(pOneShot)) {
+		_RELEASE(pOneShot);
+	}
+
+	OneShotsCount = 0;
+
 	while (pNode) {
 		ListenersNode* pNextNode = pNode->pNext;
 		_RELEASE(pNode->pListener);
+		delete pNode;
 		pNode = pNextNode;
 	}
+
+	pFirstListener = nullptr;
+	pLastListener = nullptr;
+
+	for (fr_i32 i = 0; i < eAllBusesCount; i++) {
+		FreeBusEffects(Buses[i]);
+	}
+
+	FreeBusEffects(MasterBus);
+
+	while (pFirstOutput) {
+		CMixerOutput* pNextOutput = pFirstOutput->pNext;
+		_RELEASE(pFirstOutput);
+		pFirstOutput = pNextOutput;
+	}
+}
+
+void
+CAdvancedMixer::FreeBusEffects(MixerBus& Bus)
+{
+	EffectNodeStruct* Chains[] = { Bus.pFirstEffect, Bus.pFirstSpectralEffect };
+	for (EffectNodeStruct* pNode : Chains) {
+		while (pNode) {
+			EffectNodeStruct* pNextNode = pNode->pNext;
+			_RELEASE(pNode->pEffect);
+			delete pNode;
+			pNode = pNextNode;
+		}
+	}
+
+	Bus.pFirstEffect = nullptr;
+	Bus.pFirstSpectralEffect = nullptr;
 }
 
 bool
 CAdvancedMixer::SetNewFormat(PcmFormat fmt)
 {
 	int counter = 0;
+	PcmFormat ListenerFormat = {};
 	ListenersNode* pNode = pFirstListener;
 	while (pNode) {
 		if (pNode->pListener) pNode->pListener->SetFormat(fmt);
@@ -55,15 +115,33 @@ CAdvancedMixer::SetNewFormat(PcmFormat fmt)
 		counter++;
 	}
 
+	for (fr_i32 i = 0; i < Voices.GetCount(); i++) {
+		Voices.GetListeners()[i]->pListener->GetFormat(ListenerFormat);
+		Voices.GetEmitters()[i]->SetFormat(&ListenerFormat);
+	}
+
+	for (fr_i32 i = eMasterBus; i < eAllBusesCount; i++) {
+		MixerBus* pBus = GetBus(i);
+		EffectNodeStruct* Chains[] = { pBus->pFirstEffect, pBus->pFirstSpectralEffect };
+		for (EffectNodeStruct* pEffectNode : Chains) {
+			while (pEffectNode) {
+				pEffectNode->pEffect->SetFormat(&fmt);
+				pEffectNode = pEffectNode->pNext;
+			}
+		}
+	}
+
 	return !!counter;
 }
 
 bool
 CAdvancedMixer::SetMixFormat(PcmFormat& NewFormat)
 {
+	StopProducer();
 	SetNewFormat(NewFormat);
 	SetBufferSamples(NewFormat.Frames);
 	MixFormat = NewFormat;
+	if (RenderAheadBlocks > 0) StartProducer();
 	return true;
 }
 
@@ -74,25 +152,22 @@ CAdvancedMixer::GetMixFormat(PcmFormat& ThisFormat)
 	return true;
 }
 
-bool
-CAdvancedMixer::CreateNode(ListenersNode*& pNode)
+void
+CAdvancedMixer::LinkNode(ListenersNode* pNode)
 {
-	ListenersNode* pCurrent = pLastListener;
-	if (!pCurrent) {
-		pLastListener = new ListenersNode;
-		pFirstListener = pLastListener;
+	pNode->pNext = nullptr;
+	pNode->pPrev = pLastListener;
+	if (!pLastListener) {
+		pFirstListener = pNode;
 	} else {
-		pLastListener->pNext = new ListenersNode;
-		pLastListener->pNext->pPrev = pLastListener;
-		pLastListener = pLastListener->pNext;
+		pLastListener->pNext = pNode;
 	}
 
-	pNode = pLastListener;
-	return true;
+	pLastListener = pNode;
 }
 
 bool
-CAdvancedMixer::DeleteNode(ListenersNode* pNode)
+CAdvancedMixer::UnlinkNode(ListenersNode* pNode)
 {
 	ListenersNode* pCurrent = pLastListener;
 	if (!pNode) return false;
@@ -102,8 +177,8 @@ CAdvancedMixer::DeleteNode(ListenersNode* pNode)
 			if (pFirstListener == pCurrent) pFirstListener = pCurrent->pNext;
 			if (pCurrent->pPrev) pCurrent->pPrev->pNext = pCurrent->pNext;
 			if (pCurrent->pNext) pCurrent->pNext->pPrev = pCurrent->pPrev;
-			_RELEASE(pCurrent->pListener);
-			delete pCurrent;
+			pCurrent->pNext = nullptr;
+			pCurrent->pPrev = nullptr;
 			return true;
 		}
 		pCurrent = pCurrent->pPrev;
@@ -112,60 +187,317 @@ CAdvancedMixer::DeleteNode(ListenersNode* pNode)
 	return false;
 }
 
-void*
-GetFormatListener(char* pListenerOpenLink)
+bool
+CAdvancedMixer::PushCommand(MixerCommand& Command)
+{
+	if (!CommandsQueue.Push(Command)) {
+		TypeToLog("Mixer: commands queue is full");
+		return false;
+	}
+
+	return true;
+}
+
+void
+CAdvancedMixer::PushGarbage(MixerGarbage& Garbage)
 {
-	if (!strcmp(GetFilePathFormat(pListenerOpenLink), ".wav")) return new CRIFFMediaResource();
-#ifdef FRESPONZE_USE_OPUS
-	if (!strcmp(GetFilePathFormat(pListenerOpenLink), ".opus")) return new COpusMediaResource();
-#endif
-	return nullptr;
-} 
+	/* Garbage queue can be full only if nobody calls API, so it's the last chance */
+	if (!GarbageQueue.Push(Garbage)) FreeGarbage(Garbage);
+}
+
+void
+CAdvancedMixer::RemoveVoice(fr_i32 VoiceIndex)
+{
+	MixerGarbage Garbage = {};
+	IBaseEmitter* pEmitter = Voices.GetEmitters()[VoiceIndex];
+	if (pEmitter->IsPooled()) Garbage.pOneShot = pEmitter;
+	else Garbage.pVoiceEmitter = pEmitter;
+	Voices.GetListeners()[VoiceIndex]->VoicesCount--;
+	Voices.RemoveAt(VoiceIndex);
+	PushGarbage(Garbage);
+}
+
+void
+CAdvancedMixer::RecycleOneShots()
+{
+	/* Voice is finished only if it isn't waiting for scheduled start */
+	for (fr_i32 i = Voices.GetCount() - 1; i >= 0; i--) {
+		IBaseEmitter* pEmitter = Voices.GetEmitters()[i];
+		if (!pEmitter->IsPooled() || Voices.GetStates()[i] != eStopState) continue;
+		if (Voices.GetStartTimes()[i] != NO_SCHEDULED_TIME || pEmitter->HasTail()) continue;
+		pEmitter->SetVoiceHandle(INVALID_VOICE_HANDLE);
+		RemoveVoice(i);
+	}
+}
+
+void
+CAdvancedMixer::ReturnOneShot(IBaseEmitter* pEmitter)
+{
+	pEmitter->SetListener(nullptr);
+	pEmitter->SetVoiceHandle(INVALID_VOICE_HANDLE);
+	pEmitter->SetState(eStopState);
+	pEmitter->SetPosition(0);
+
+	/* Pool was shrunk while emitter was playing */
+	if (OneShotsCount > OneShotsTarget || !OneShotsPool.Push(pEmitter)) {
+		OneShotsCount--;
+		_RELEASE(pEmitter);
+	}
+}
+
+void
+CAdvancedMixer::ProcessCommands()
+{
+	MixerCommand Command = {};
+	while (CommandsQueue.Pop(Command)) {
+		MixerGarbage Garbage = {};
+		switch (Command.Type)
+		{
+		case eLinkListenerCommand:
+			LinkNode(Command.pListNode);
+			break;
+		case eUnlinkListenerCommand:
+			if (!UnlinkNode(Command.pListNode)) break;
+			for (fr_i32 i = Voices.GetCount() - 1; i >= 0; i--) {
+				if (Voices.GetListeners()[i] == Command.pListNode) RemoveVoice(i);
+			}
+
+			Garbage.pListNode = Command.pListNode;
+			break;
+		case eLinkEmitterCommand: {
+			/* Command reference goes to voice table */
+			VoiceHandle Handle = Voices.Add(Command.pEmitter, Command.pListNode);
+			if (Handle == INVALID_VOICE_HANDLE) {
+				TypeToLog("Mixer: voice table is full");
+				Garbage.pEmitter = Command.pEmitter;
+				break;
+			}
+
+			Command.pEmitter->SetVoiceHandle(Handle);
+			Command.pListNode->VoicesCount++;
+		}
+			break;
+		case eUnlinkEmitterCommand: {
+			fr_i32 VoiceIndex = Voices.GetIndex(Command.pEmitter->GetVoiceHandle());
+			if (VoiceIndex >= 0 && Voices.GetEmitters()[VoiceIndex] == Command.pEmitter) {
+				Command.pEmitter->SetVoiceHandle(INVALID_VOICE_HANDLE);
+				RemoveVoice(VoiceIndex);
+			}
+
+			Garbage.pEmitter = Command.pEmitter;
+		}
+			break;
+		case eAddBusEffectCommand:
+			LinkBusEffect(*GetBus(Command.Bus), Command.pEffectNode);
+			break;
+		case eDeleteBusEffectCommand:
+			Garbage.pEffectNode = UnlinkBusEffect(*GetBus(Command.Bus), Command.pEffect);
+			break;
+		case ePlayAtCommand:
+		case eStopAtCommand: {
+			fr_i32 VoiceIndex = Voices.GetIndex(Command.pEmitter->GetVoiceHandle());
+			if (VoiceIndex >= 0 && Voices.GetEmitters()[VoiceIndex] == Command.pEmitter) {
+				if (Command.Type == ePlayAtCommand) Voices.GetStartTimes()[VoiceIndex] = std::max(Command.Time, (fr_i64)0);
+				else Voices.GetStopTimes()[VoiceIndex] = std::max(Command.Time, (fr_i64)0);
+			}
+
+			Garbage.pEmitter = Command.pEmitter;
+		}
+			break;
+		case eLinkOutputCommand:
+			/* Command reference goes to outputs list */
+			Command.pOutput->pNext = pFirstOutput;
+			pFirstOutput = Command.pOutput;
+			break;
+		case eUnlinkOutputCommand:
+			Garbage.pOutput = UnlinkOutput(Command.pOutput);
+			break;
+		case eLinkOneShotCommand: {
+			/* Pool reference goes to voice table */
+			VoiceHandle Handle = Voices.Add(Command.pEmitter, Command.pListNode);
+			if (Handle == INVALID_VOICE_HANDLE) {
+				TypeToLog("Mixer: voice table is full");
+				Garbage.pOneShot = Command.pEmitter;
+				break;
+			}
+
+			Command.pEmitter->SetVoiceHandle(Handle);
+			Command.pListNode->VoicesCount++;
+			if (Command.Time != NO_SCHEDULED_TIME) {
+				Voices.GetStartTimes()[Voices.GetIndex(Handle)] = std::max(Command.Time, (fr_i64)0);
+			}
+		}
+			break;
+		default:
+			break;
+		}
+
+		if (Garbage.pListNode || Garbage.pVoiceEmitter || Garbage.pEmitter || Garbage.pEffectNode || Garbage.pOutput || Garbage.pOneShot) PushGarbage(Garbage);
+	}
+}
+
+void
+CAdvancedMixer::FreeGarbage(MixerGarbage& Garbage)
+{
+	if (Garbage.pVoiceEmitter) {
+		Garbage.pVoiceEmitter->SetListener(nullptr);
+		_RELEASE(Garbage.pVoiceEmitter);
+	}
+
+	_RELEASE(Garbage.pEmitter);
+	if (Garbage.pListNode) {
+		_RELEASE(Garbage.pListNode->pListener);
+		delete Garbage.pListNode;
+	}
+
+	if (Garbage.pEffectNode) {
+		_RELEASE(Garbage.pEffectNode->pEffect);
+		delete Garbage.pEffectNode;
+	}
+
+	_RELEASE(Garbage.pOutput);
+	if (Garbage.pOneShot) ReturnOneShot(Garbage.pOneShot);
+}
+
+void
+CAdvancedMixer::CollectGarbage()
+{
+	MixerGarbage Garbage = {};
+	while (GarbageQueue.Pop(Garbage)) {
+		FreeGarbage(Garbage);
+	}
+}
 
 bool 
 CAdvancedMixer::AddEmitterToListener(ListenersNode* pListener, IBaseEmitter* pEmmiter)
 {
 	PcmFormat tempFormat = {};
-	if (!pListener->pListener->AddEmitter(pEmmiter)) return false;
-	pEmmiter->SetListener(pListener->pListener);
+	MixerCommand Command = {};
+	CollectGarbage();
+	if (!pListener || !pListener->pListener || !pEmmiter) return false;
 
+	pEmmiter->SetListener(pListener->pListener);
 	pListener->pListener->GetFormat(tempFormat);
 	pEmmiter->SetFormat(&tempFormat);
 
+	Command.Type = eLinkEmitterCommand;
+	Command.pListNode = pListener;
+	pEmmiter->Clone((void**)&Command.pEmitter);
+	if (!PushCommand(Command)) {
+		_RELEASE(Command.pEmitter);
+		return false;
+	}
+
 	return true;
 }
 
 bool 
 CAdvancedMixer::DeleteEmitterFromListener(ListenersNode* pListener, IBaseEmitter* pEmmiter)
 {
-	if (!pListener->pListener->DeleteEmitter(pEmmiter)) return false;
-	pEmmiter->SetListener(nullptr);
+	MixerCommand Command = {};
+	CollectGarbage();
+	if (!pListener || !pListener->pListener || !pEmmiter) return false;
+
+	/* Emitter must be alive until render thread unlinks it */
+	Command.Type = eUnlinkEmitterCommand;
+	Command.pListNode = pListener;
+	pEmmiter->Clone((void**)&Command.pEmitter);
+	if (!PushCommand(Command)) {
+		_RELEASE(Command.pEmitter);
+		return false;
+	}
+
 	return true;
 }
 
 bool
 CAdvancedMixer::CreateListener(void* pListenerOpenLink, ListenersNode*& pNewListener, PcmFormat ListFormat)
 {
+	MixerCommand Command = {};
+	CollectGarbage();
 	if (!ListFormat.Bits) ListFormat = MixFormat;
 
-	IMediaResource* pNewResource = (IMediaResource*)GetFormatListener((char*)pListenerOpenLink);
-	if (!pNewResource) return false;
-	if (!pNewResource->OpenResource(pListenerOpenLink)) {
-		_RELEASE(pNewResource);
-		return false;
-	}
+	/* Resource is shared by path, listener reads it by own cursor */
+	IMediaResource* pNewResource = nullptr;
+	if (!SoundBank.GetResource((const fr_utf8*)pListenerOpenLink, MixFormat, pNewResource)) return false;
 
-	if (ListFormat.Bits) pNewResource->SetFormat(ListFormat);
-	CreateNode(pNewListener);
+	pNewListener = new ListenersNode;
 	pNewListener->pListener = new CMediaListener(pNewResource);
 	pNewListener->pListener->SetFormat(ListFormat);
+	_RELEASE(pNewResource);
+
+	Command.Type = eLinkListenerCommand;
+	Command.pListNode = pNewListener;
+	if (!PushCommand(Command)) {
+		_RELEASE(pNewListener->pListener);
+		delete pNewListener;
+		pNewListener = nullptr;
+		return false;
+	}
+
+	return true;
+}
+
+bool
+CAdvancedMixer::PreloadResource(void* pListenerOpenLink)
+{
+	IMediaResource* pResource = nullptr;
+	if (!SoundBank.GetResource((const fr_utf8*)pListenerOpenLink, MixFormat, pResource)) return false;
+
+	_RELEASE(pResource);
 	return true;
 }
 
+void
+CAdvancedMixer::SetSoundBankBudget(fr_i64 MemoryBytes, fr_f32 MaxPreloadTime)
+{
+	CollectGarbage();
+	SoundBank.SetMaxPreloadTime(MaxPreloadTime);
+	SoundBank.SetMemoryBudget(MemoryBytes);
+}
+
+void
+CAdvancedMixer::PurgeSoundBank()
+{
+	/* Freed listeners release their resources here */
+	CollectGarbage();
+	SoundBank.Purge();
+}
+
+void
+CAdvancedMixer::SetStreamPrefetch(fr_f32 AheadTime)
+{
+	if (AheadTime <= 0.f) {
+		SoundBank.SetPrefetcher(nullptr, 0.f);
+		return;
+	}
+
+	if (!pPrefetcher) pPrefetcher = new CStreamPrefetcher;
+	SoundBank.SetPrefetcher(pPrefetcher, AheadTime);
+}
+
+void
+CAdvancedMixer::SetStreamHeadCache(fr_f32 HeadTime)
+{
+	SoundBank.SetHeadCacheTime(HeadTime);
+}
+
+fr_i64
+CAdvancedMixer::GetStreamStarvationsCount()
+{
+	return pPrefetcher ? pPrefetcher->GetStarvationsCount() : 0;
+}
+
 bool
 CAdvancedMixer::DeleteListener(ListenersNode* pListNode)
 {
-	return DeleteNode(pListNode);
+	MixerCommand Command = {};
+	CollectGarbage();
+	if (!pListNode) return false;
+
+	Command.Type = eUnlinkListenerCommand;
+	Command.pListNode = pListNode;
+	return PushCommand(Command);
 }
 
 bool
@@ -183,6 +515,192 @@ CAdvancedMixer::CreateEmitter(IBaseEmitter*& pEmitterToCreate, fr_i32 Type)
 	return true;
 }
 
+bool
+CAdvancedMixer::SetOneShotPoolSize(fr_i32 EmittersCount)
+{
+	IBaseEmitter* pEmitter = nullptr;
+	CollectGarbage();
+	if (EmittersCount < 0 || EmittersCount > MAX_VOICES_COUNT) return false;
+
+	OneShotsTarget = EmittersCount;
+	while (OneShotsCount < EmittersCount) {
+		pEmitter = GetAdvancedEmitter();
+		pEmitter->SetPooled(true);
+		OneShotsPool.Push(pEmitter);
+		OneShotsCount++;
+	}
+
+	/* Busy emitters are released when they are finished */
+	while (OneShotsCount > EmittersCount && OneShotsPool.Pop(pEmitter)) {
+		_RELEASE(pEmitter);
+		OneShotsCount--;
+	}
+
+	return true;
+}
+
+bool
+CAdvancedMixer::PlayOneShot(ListenersNode* pListener, const OneShotParams& Params)
+{
+	PcmFormat tempFormat = {};
+	MixerCommand Command = {};
+	IBaseEmitter* pEmitter = nullptr;
+	fr_f32 Volume = Params.Volume;
+	fr_f32 Angle = Params.Angle;
+	CollectGarbage();
+	if (!pListener || !pListener->pListener) return false;
+	if (!OneShotsTarget) SetOneShotPoolSize(ONE_SHOT_POOL_DEFAULT_SIZE);
+	if (!OneShotsPool.Pop(pEmitter)) {
+		TypeToLog("Mixer: all one-shot emitters are busy");
+		return false;
+	}
+
+	pEmitter->SetListener(pListener->pListener);
+	pListener->pListener->GetFormat(tempFormat);
+	pEmitter->SetFormat(&tempFormat);
+	pEmitter->SetOption(eVolumeParameter, &Volume, sizeof(fr_f32));
+	pEmitter->SetOption(eAngleParameter, &Angle, sizeof(fr_f32));
+	pEmitter->SetBus(Params.Bus);
+	pEmitter->SetPriority(Params.Priority);
+	pEmitter->SetDistance(Params.Distance);
+	pEmitter->SetPosition(0);
+	pEmitter->ClearSends();
+	for (fr_i32 i = 0; i < AUX_BUSES_COUNT; i++) {
+		pEmitter->SetSend(eFirstAuxBus + i, Params.Sends[i]);
+	}
+
+	/* Scheduled one-shot is started by render thread at exact sample */
+	pEmitter->SetState(Params.StartTime < 0 ? ePlayState : eStopState);
+
+	Command.Type = eLinkOneShotCommand;
+	Command.pListNode = pListener;
+	Command.pEmitter = pEmitter;
+	Command.Time = Params.StartTime < 0 ? NO_SCHEDULED_TIME : Params.StartTime;
+	if (!PushCommand(Command)) {
+		ReturnOneShot(pEmitter);
+		return false;
+	}
+
+	return true;
+}
+
+bool
+CAdvancedMixer::SetRenderAhead(fr_i32 BlocksCount)
+{
+	StopProducer();
+	RenderAheadBlocks = std::max(BlocksCount, 0);
+	if (!RenderAheadBlocks) return true;
+
+	/* Producer will be started with first mix format */
+	if (!BufferedSamples || !MixFormat.Channels) return true;
+	return StartProducer();
+}
+
+fr_i64
+CAdvancedMixer::GetUnderrunsCount()
+{
+	return UnderrunsCount.load(std::memory_order_relaxed);
+}
+
+bool
+CAdvancedMixer::StartProducer()
+{
+	if (hProducerThread) return true;
+	if (!BufferedSamples || !MixFormat.Channels) return false;
+
+	/* Endpoint doesn't use ahead ring in endpoint mode, so it can be resized here */
+	AheadChannels = MixFormat.Channels;
+	AheadBuffer.Resize(BufferedSamples * AheadChannels);
+	AheadRing.Resize((fr_i64)RenderAheadBlocks * BufferedSamples * AheadChannels);
+	if (!pProducerEvent) pProducerEvent = CreatePlatformEvent();
+
+	/* Producer renders the first block only after endpoint has finished its own one */
+	SwitchRenderMode(eProducerRenderMode);
+	IsProducerTerminating = false;
+	hProducerThread = CreateAudioThread(ProducerThreadProc, this, true);
+	if (!hProducerThread) {
+		TypeToLog("Mixer: can't create render-ahead thread, rendering in endpoint callback");
+		SwitchRenderMode(eEndpointRenderMode);
+		return false;
+	}
+
+	return true;
+}
+
+void
+CAdvancedMixer::StopProducer()
+{
+	if (!hProducerThread) return;
+	IsProducerTerminating = true;
+	pProducerEvent->Raise();
+	JoinAudioThread(hProducerThread);
+	hProducerThread = nullptr;
+
+	/* Ring is reset only after endpoint stopped reading it */
+	SwitchRenderMode(eEndpointRenderMode);
+	AheadRing.Reset();
+}
+
+void
+CAdvancedMixer::SwitchRenderMode(fr_i32 NewMode)
+{
+	IsModeSwitching.store(true, std::memory_order_seq_cst);
+	RenderMode.store(NewMode, std::memory_order_seq_cst);
+
+	/* 
+		Endpoint which is outside of callback will read new mode on next call.
+		Otherwise endpoint raises event when it reports its mode or leaves callback.
+	*/
+	while (true) {
+		fr_i32 CurrentMode = EndpointMode.load(std::memory_order_seq_cst);
+		if (CurrentMode == eIdleRenderMode || CurrentMode == NewMode) break;
+		pModeEvent->Wait();
+	}
+
+	IsModeSwitching.store(false, std::memory_order_seq_cst);
+}
+
+fr_i32
+CAdvancedMixer::EnterEndpoint()
+{
+	EndpointMode.store(eEnteringRenderMode, std::memory_order_seq_cst);
+	fr_i32 Mode = RenderMode.load(std::memory_order_seq_cst);
+	EndpointMode.store(Mode, std::memory_order_seq_cst);
+	if (IsModeSwitching.load(std::memory_order_seq_cst)) pModeEvent->Raise();
+	return Mode;
+}
+
+void
+CAdvancedMixer::LeaveEndpoint()
+{
+	EndpointMode.store(eIdleRenderMode, std::memory_order_seq_cst);
+	if (IsModeSwitching.load(std::memory_order_seq_cst)) pModeEvent->Raise();
+}
+
+void
+CAdvancedMixer::ProducerThreadProc(void* pContext)
+{
+	CAdvancedMixer* pThis = (CAdvancedMixer*)pContext;
+	fr_i32 Frames = pThis->BufferedSamples;
+	fr_i32 Channels = pThis->AheadChannels;
+	fr_i32 SampleRate = pThis->MixFormat.SampleRate ? pThis->MixFormat.SampleRate : 48000;
+	fr_i32 WaitTime = std::max((fr_i32)((fr_i64)Frames * 1000 / SampleRate / 2), 1);
+
+	while (!pThis->IsProducerTerminating) {
+		/* Fill all free space in queue, so heavy blocks are hidden by other ones */
+		while (!pThis->IsProducerTerminating && pThis->AheadRing.GetWriteAvailable() >= Frames * Channels) {
+			if (!pThis->RenderBlock(pThis->AheadBuffer.Data(), Frames, Channels)) {
+				memset(pThis->AheadBuffer.Data(), 0, (fr_i64)Frames * Channels * sizeof(fr_f32));
+				pThis->UnderrunsCount.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			pThis->AheadRing.Write(pThis->AheadBuffer.Data(), Frames * Channels);
+		}
+
+		pThis->pProducerEvent->Wait(WaitTime);
+	}
+}
+
 bool
 CAdvancedMixer::Record(fr_f32* pBuffer, fr_i32 Frames, fr_i32 Channels, fr_i32 SampleRate)
 {
@@ -192,24 +710,55 @@ CAdvancedMixer::Record(fr_f32* pBuffer, fr_i32 Frames, fr_i32 Channels, fr_i32 S
 bool
 CAdvancedMixer::Update(fr_f32* pBuffer, fr_i32 Frames, fr_i32 Channels, fr_i32 SampleRate)
 {
-	fr_i32 UpdatedSamples = 0;
-	if (RingBuffer.GetLeftBuffers() <= 0) {
-		/* No buffers in queue - no data. Render it */
-		if (!Render(BufferedSamples, Channels, SampleRate)) return false;
+	bool IsUpdated = false;
+	fr_i32 Mode = EnterEndpoint();
+	if (Mode == eOfflineRenderMode) {
+		/* Mixer is owned by offline render, so endpoint plays silence */
+		memset(pBuffer, 0, (fr_i64)Frames * Channels * sizeof(fr_f32));
+		IsUpdated = true;
+	} else if (Mode == eProducerRenderMode) {
+		IsUpdated = ReadAheadRing(pBuffer, Frames, Channels);
+	} else {
+		IsUpdated = ReadOutputFifo(pBuffer, Frames, Channels);
+	}
+
+	LeaveEndpoint();
+	return IsUpdated;
+}
+
+bool
+CAdvancedMixer::ReadAheadRing(fr_f32* pBuffer, fr_i32 Frames, fr_i32 Channels)
+{
+	fr_i64 SamplesCount = (fr_i64)Frames * Channels;
+	fr_i64 ReadedSamples = 0;
+
+	/* Render-ahead mode: just copy rendered data and wake up producer */
+	if (Channels == AheadChannels) ReadedSamples = AheadRing.Read(pBuffer, SamplesCount);
+	if (ReadedSamples < SamplesCount) {
+		memset(&pBuffer[ReadedSamples], 0, (SamplesCount - ReadedSamples) * sizeof(fr_f32));
+		UnderrunsCount.fetch_add(1, std::memory_order_relaxed);
 	}
 
-	fr_i32 ret = RingBuffer.ReadData(pBuffer, Frames * Channels);
-	UpdatedSamples += ret / Channels;
+	pProducerEvent->Raise();
+	return true;
+}
+
+bool
+CAdvancedMixer::ReadOutputFifo(fr_f32* pBuffer, fr_i32 Frames, fr_i32 Channels)
+{
 	/*
-		If we can't read more data because WASAPI or other output send 
-		non-typical samples count query to ring buffer, we must render
-		data to push new data to required buffer with other write position
+		Any request size is served from sample FIFO. Mixer renders only fixed
+		quanta, and new quantum is rendered only when FIFO doesn't have 
+		enough samples, so odd-sized requests never cause extra renders.
 	*/
-	if (UpdatedSamples < Frames) {
-		if (!Render(BufferedSamples, Channels, SampleRate)) return false;
-		ret = RingBuffer.ReadData(&pBuffer[ret], (Frames - UpdatedSamples) * Channels);
-		UpdatedSamples += ret / Channels;
-		if (UpdatedSamples < Frames) {
+	fr_i64 SamplesCount = (fr_i64)Frames * Channels;
+	fr_i64 ReadedSamples = 0;
+	if (FifoChannels != Channels) OutputFifo.Reset();
+	while (true) {
+		ReadedSamples += OutputFifo.Read(&pBuffer[ReadedSamples], SamplesCount - ReadedSamples);
+		if (ReadedSamples >= SamplesCount) break;
+		if (!RenderQuantum(BufferedSamples ? BufferedSamples : Frames, Channels) || !OutputFifo.GetReadAvailable()) {
+			memset(&pBuffer[ReadedSamples], 0, (SamplesCount - ReadedSamples) * sizeof(fr_f32));
 			return false;
 		}
 	}
@@ -231,54 +780,654 @@ CAdvancedMixer::Update(fr_f32* pBuffer, fr_i32 Frames, fr_i32 Channels, fr_i32 S
 	}
 */
 
+void
+CAdvancedMixer::SetVoicesBudget(fr_i32 RealVoicesCount)
+{
+	VoicesBudget = std::max(RealVoicesCount, 0);
+}
+
+fr_i32
+CAdvancedMixer::GetVirtualVoicesCount()
+{
+	return VirtualVoicesCount;
+}
+
 bool
-CAdvancedMixer::Render(fr_i32 Frames, fr_i32 Channels, fr_i32 SampleRate)
+CAdvancedMixer::PlayAt(IBaseEmitter* pEmitter, fr_i64 ClockTime)
 {
-	ListenersNode* pListNode = pFirstListener;
-	PcmFormat fmt = { };
+	MixerCommand Command = {};
+	CollectGarbage();
+	if (!pEmitter) return false;
 
-	FRESPONZE_BEGIN_TEST
-	if (!pFirstListener) return false;
-	/* Update buffer size if output endpoint change sample rate/bitrate/*/
-	if (RingBuffer.GetLeftBuffers()) return false;
-	RingBuffer.SetBuffersCount(RING_BUFFERS_COUNT);
-	RingBuffer.Resize(Frames * Channels);
-	OutputBuffer.Resize(Frames * Channels);
+	Command.Type = ePlayAtCommand;
+	Command.Time = ClockTime;
+	pEmitter->Clone((void**)&Command.pEmitter);
+	if (!PushCommand(Command)) {
+		_RELEASE(Command.pEmitter);
+		return false;
+	}
+
+	return true;
+}
+
+bool
+CAdvancedMixer::StopAt(IBaseEmitter* pEmitter, fr_i64 ClockTime)
+{
+	MixerCommand Command = {};
+	CollectGarbage();
+	if (!pEmitter) return false;
+
+	Command.Type = eStopAtCommand;
+	Command.Time = ClockTime;
+	pEmitter->Clone((void**)&Command.pEmitter);
+	if (!PushCommand(Command)) {
+		_RELEASE(Command.pEmitter);
+		return false;
+	}
+
+	return true;
+}
+
+fr_i64
+CAdvancedMixer::GetClock()
+{
+	return MixerClock.load(std::memory_order_acquire);
+}
+
+bool
+CAdvancedMixer::CreateOutput(IAudioCallback*& pOutputCallback)
+{
+	MixerCommand Command = {};
+	CMixerOutput* pOutput = nullptr;
+	CollectGarbage();
+
+	pOutput = new CMixerOutput;
+	Command.Type = eLinkOutputCommand;
+	pOutput->Clone((void**)&Command.pOutput);
+	if (!PushCommand(Command)) {
+		_RELEASE(Command.pOutput);
+		_RELEASE(pOutput);
+		return false;
+	}
+
+	pOutputCallback = pOutput;
+	return true;
+}
+
+bool
+CAdvancedMixer::DeleteOutput(IAudioCallback* pOutputCallback)
+{
+	MixerCommand Command = {};
+	CollectGarbage();
+	if (!pOutputCallback) return false;
+
+	/* Used only for search, so command doesn't hold reference */
+	Command.Type = eUnlinkOutputCommand;
+	Command.pOutput = (CMixerOutput*)pOutputCallback;
+	return PushCommand(Command);
+}
+
+CMixerOutput*
+CAdvancedMixer::UnlinkOutput(CMixerOutput* pOutput)
+{
+	CMixerOutput** ppCurrent = &pFirstOutput;
+	while (*ppCurrent) {
+		if (*ppCurrent == pOutput) {
+			*ppCurrent = pOutput->pNext;
+			pOutput->pNext = nullptr;
+			return pOutput;
+		}
+
+		ppCurrent = &(*ppCurrent)->pNext;
+	}
+
+	return nullptr;
+}
+
+void
+CAdvancedMixer::WriteOutputs(fr_i32 Frames, fr_i32 Channels)
+{
+	CMixerOutput* pOutput = pFirstOutput;
+	if (RenderMode.load(std::memory_order_relaxed) == eOfflineRenderMode || !MixFormat.SampleRate) return;
+
+	while (pOutput) {
+		pOutput->Write(mixBuffer.GetBuffers(), Frames, Channels, MixFormat.SampleRate);
+		pOutput = pOutput->pNext;
+	}
+}
+
+void
+CAdvancedMixer::SetDeviceDelay(fr_i32 DelayFrames)
+{
+	DeviceDelay.store(std::max(DelayFrames, 0), std::memory_order_relaxed);
+}
+
+bool
+CAdvancedMixer::GetLatency(MixerLatency& Latency)
+{
+	fr_i32 Channels = MixFormat.Channels;
+	fr_i64 QueuedSamples = 0;
+	if (!Channels) return false;
+
+	QueuedSamples = AheadRing.GetReadAvailable() + OutputFifo.GetReadAvailable();
+	Latency.Clock = MixerClock.load(std::memory_order_acquire);
+	Latency.QueuedFrames = (fr_i32)(QueuedSamples / Channels);
+	Latency.ResamplerFrames = ResamplerDelay.load(std::memory_order_relaxed);
+	Latency.DeviceFrames = DeviceDelay.load(std::memory_order_relaxed);
+	Latency.TotalFrames = Latency.QueuedFrames + Latency.DeviceFrames;
+	Latency.AudibleClock = std::max(Latency.Clock - Latency.TotalFrames, (fr_i64)0);
+	return true;
+}
+
+MixerBus*
+CAdvancedMixer::GetBus(fr_i32 Bus)
+{
+	if (Bus == eMasterBus) return &MasterBus;
+	if (Bus < 0 || Bus >= eAllBusesCount) return nullptr;
+	return &Buses[Bus];
+}
+
+bool
+CAdvancedMixer::AddBusEffect(fr_i32 Bus, IBaseEffect* pEffect)
+{
+	MixerCommand Command = {};
+	CollectGarbage();
+	if (!pEffect || !GetBus(Bus)) return false;
+
+	/* Node is created here, render thread only links it to the chain */
+	Command.Type = eAddBusEffectCommand;
+	Command.Bus = Bus;
+	Command.pEffectNode = new EffectNodeStruct;
+	memset(Command.pEffectNode, 0, sizeof(EffectNodeStruct));
+	pEffect->Clone((void**)&Command.pEffectNode->pEffect);
+	if (MixFormat.Channels) pEffect->SetFormat(&MixFormat);
+	if (!PushCommand(Command)) {
+		_RELEASE(Command.pEffectNode->pEffect);
+		delete Command.pEffectNode;
+		return false;
+	}
+
+	return true;
+}
+
+bool
+CAdvancedMixer::DeleteBusEffect(fr_i32 Bus, IBaseEffect* pEffect)
+{
+	MixerCommand Command = {};
+	CollectGarbage();
+	if (!pEffect || !GetBus(Bus)) return false;
+
+	Command.Type = eDeleteBusEffectCommand;
+	Command.Bus = Bus;
+	Command.pEffect = pEffect;
+	return PushCommand(Command);
+}
+
+bool
+CAdvancedMixer::SetBusVolume(fr_i32 Bus, fr_f32 Volume)
+{
+	MixerBus* pBus = GetBus(Bus);
+	if (!pBus) return false;
+	pBus->Volume = Volume;
+	return true;
+}
+
+fr_f32
+CAdvancedMixer::GetBusVolume(fr_i32 Bus)
+{
+	MixerBus* pBus = GetBus(Bus);
+	if (!pBus) return 0.f;
+	return pBus->Volume;
+}
+
+void
+CAdvancedMixer::LinkBusEffect(MixerBus& Bus, EffectNodeStruct* pNode)
+{
+	fr_i32 EffectType = UnknownEffectType;
+	pNode->pEffect->GetEffectType(EffectType);
+
+	/* New spectral stage must not play signal which was left from previous effects */
+	if (EffectType == FFTEffectType && !Bus.pFirstSpectralEffect) Bus.SpectralChain.Reset();
+
+	EffectNodeStruct*& pFirstNode = EffectType == FFTEffectType ? Bus.pFirstSpectralEffect : Bus.pFirstEffect;
+	EffectNodeStruct* pLastNode = pFirstNode;
+	while (pLastNode && pLastNode->pNext) {
+		pLastNode = pLastNode->pNext;
+	}
+
+	pNode->pNext = nullptr;
+	pNode->pPrev = pLastNode;
+	if (pLastNode) pLastNode->pNext = pNode;
+	else pFirstNode = pNode;
+}
+
+EffectNodeStruct*
+CAdvancedMixer::UnlinkEffectNode(EffectNodeStruct*& pFirstNode, IBaseEffect* pEffect)
+{
+	EffectNodeStruct* pNode = pFirstNode;
+	while (pNode) {
+		if (pNode->pEffect == pEffect) {
+			if (pNode == pFirstNode) pFirstNode = pNode->pNext;
+			if (pNode->pPrev) pNode->pPrev->pNext = pNode->pNext;
+			if (pNode->pNext) pNode->pNext->pPrev = pNode->pPrev;
+			pNode->pNext = nullptr;
+			pNode->pPrev = nullptr;
+			return pNode;
+		}
+
+		pNode = pNode->pNext;
+	}
+
+	return nullptr;
+}
+
+EffectNodeStruct*
+CAdvancedMixer::UnlinkBusEffect(MixerBus& Bus, IBaseEffect* pEffect)
+{
+	EffectNodeStruct* pNode = UnlinkEffectNode(Bus.pFirstEffect, pEffect);
+	if (!pNode) pNode = UnlinkEffectNode(Bus.pFirstSpectralEffect, pEffect);
+	return pNode;
+}
+
+bool
+CAdvancedMixer::ProcessBus(MixerBus& Bus, C2DFloatBuffer& Buffer, bool IsActive, fr_i32 Frames, fr_i32 Channels)
+{
+	fr_i32 TailLength = 0;
+	EffectNodeStruct* pNode = Bus.pFirstEffect;
+
+	/* 
+		Spectral stage is owned by render thread, so it's allocated here for 
+		the first FFT effect of bus and reallocated when channels are changed.
+	*/
+	if (Bus.pFirstSpectralEffect && Bus.SpectralChain.GetChannels() != Channels) Bus.SpectralChain.SetFormat(Channels);
+	bool IsSpectral = Bus.pFirstSpectralEffect && Bus.SpectralChain.IsInitialized();
+
+	/* Silent bus is processed only while effects have some tail */
+	if (!IsActive) {
+		if (Bus.TailFramesLeft <= 0 || (!pNode && !IsSpectral)) {
+			Bus.TailFramesLeft = 0;
+			return false;
+		}
+
+		Buffer.Clear();
+		Bus.TailFramesLeft -= Frames;
+	}
+
+	/* All FFT effects of bus share one forward and one inverse transform */
+	if (IsSpectral) {
+		EffectNodeStruct* pSpectralNode = Bus.pFirstSpectralEffect;
+		Bus.SpectralChain.Process(Buffer.GetBuffers(), Frames, pSpectralNode);
+		while (pSpectralNode) {
+			TailLength = std::max(TailLength, pSpectralNode->pEffect->GetTailLength());
+			pSpectralNode = pSpectralNode->pNext;
+		}
+
+		TailLength += Bus.SpectralChain.GetLatency();
+	}
+
+	while (pNode) {
+		pNode->pEffect->Process(Buffer.GetBuffers(), Frames);
+		TailLength = std::max(TailLength, pNode->pEffect->GetTailLength());
+		pNode = pNode->pNext;
+	}
+
+	if (IsActive) Bus.TailFramesLeft = TailLength;
+	return true;
+}
+
+void
+CAdvancedMixer::MixBuses(fr_i32 Frames, fr_i32 Channels)
+{
+	/* Aux returns are summed to master in the same way as submix buses */
+	IsMixSilent = true;
+	for (fr_i32 i = 0; i < eAllBusesCount; i++) {
+		MixerBus& Bus = Buses[i];
+		fr_f32 Volume = Bus.Volume;
+		if (!ProcessBus(Bus, BusesTarget.Buffers[i], BusesTarget.IsActive[i], Frames, Channels)) {
+			Bus.LastVolume = Volume;
+			continue;
+		}
+
+		/* Bus volume is ramped in the same pass as summing to master */
+		for (fr_i32 o = 0; o < Channels; o++) {
+			MixerAddToBufferRamp(mixBuffer.GetBufferData(o), BusesTarget.Buffers[i].GetBufferData(o), Frames, Bus.LastVolume, Volume);
+		}
+
+		Bus.LastVolume = Volume;
+		IsMixSilent = false;
+	}
+
+	if (ProcessBus(MasterBus, mixBuffer, !IsMixSilent, Frames, Channels)) IsMixSilent = false;
+	fr_f32 MasterVolume = MasterBus.Volume;
+	if (!IsMixSilent && (MasterVolume != 1.f || MasterBus.LastVolume != 1.f)) {
+		for (fr_i32 o = 0; o < Channels; o++) {
+			ScaleBufferRamp(mixBuffer.GetBufferData(o), Frames, MasterBus.LastVolume, MasterVolume);
+		}
+	}
+
+	MasterBus.LastVolume = MasterVolume;
+}
+
+void
+CAdvancedMixer::UpdateVirtualVoices()
+{
+	fr_i32 Budget = VoicesBudget;
+	fr_i32 PlayingCount = 0;
+	fr_i32 VoicesCount = Voices.GetCount();
+	IBaseEmitter** ppEmitters = Voices.GetEmitters();
+	fr_i32* pStates = Voices.GetStates();
+	fr_f32* pGains = Voices.GetGains();
+	fr_i32* pPriorities = Voices.GetPriorities();
+	fr_f32* pAudibilities = Voices.GetAudibilities();
+	fr_i32* pFlags = Voices.GetFlags();
+	fr_i32* pOrder = Voices.GetOrder();
+
+	for (fr_i32 i = 0; i < VoicesCount; i++) {
+		pFlags[i] = eVoiceRealFlag;
+		pStates[i] = ppEmitters[i]->GetState();
+		if (pStates[i] == eStopState || pStates[i] == ePauseState) continue;
+
+		/* Simple inverse distance law with 1 meter reference distance */
+		pGains[i] = ppEmitters[i]->GetVolume();
+		pPriorities[i] = ppEmitters[i]->GetPriority();
+		pAudibilities[i] = fabsf(pGains[i]) / std::max(ppEmitters[i]->GetDistance(), 1.f);
+		pOrder[PlayingCount++] = i;
+	}
+
+	if (!Budget || PlayingCount <= Budget) {
+		VirtualVoicesCount = 0;
+		return;
+	}
+
+	/* Move the most important voices to the begin of order list, and make other ones virtual */
+	std::nth_element(pOrder, pOrder + Budget, pOrder + PlayingCount, [pPriorities, pAudibilities](fr_i32 First, fr_i32 Second) {
+		if (pPriorities[First] != pPriorities[Second]) return pPriorities[First] > pPriorities[Second];
+		if (pAudibilities[First] != pAudibilities[Second]) return pAudibilities[First] > pAudibilities[Second];
+		return First < Second;
+	});
+
+	for (fr_i32 i = Budget; i < PlayingCount; i++) {
+		pFlags[pOrder[i]] = eVoiceVirtualFlag;
+	}
+
+	VirtualVoicesCount = PlayingCount - Budget;
+}
+
+void
+CAdvancedMixer::ProcessVirtualVoice(fr_i32 VoiceIndex, fr_i32 Frames)
+{
+	IBaseEmitter* pEmitter = Voices.GetEmitters()[VoiceIndex];
+	IMediaListener* pListener = Voices.GetListeners()[VoiceIndex]->pListener;
+	fr_i64 FullFrames = pListener->GetFullFrames();
+	fr_i64 Position = pEmitter->GetPosition() + Frames;
+
+	/* 
+		Advance only playback cursor. Real voice sets this position to listener
+		by itself, so promoted voice continues from the right place. 
+	*/
+	if (Position >= FullFrames) {
+		if (pEmitter->GetState() == ePlayState) {
+			pEmitter->SetState(eStopState);
+			Position = 0;
+		} else {
+			Position = FullFrames > 0 ? Position % FullFrames : 0;
+		}
+	}
+
+	pEmitter->SetPosition(Position);
+	Voices.GetStates()[VoiceIndex] = pEmitter->GetState();
+	Voices.GetPositions()[VoiceIndex] = Position;
+}
+
+bool
+CAdvancedMixer::MixVoice(fr_i32 VoiceIndex, C2DFloatBuffer& TempBuffer, BusesMixTarget& Target, fr_i32 Frames, fr_i32 Channels)
+{
+	IBaseEmitter* pEmitter = Voices.GetEmitters()[VoiceIndex];
+	fr_i64& StartTime = Voices.GetStartTimes()[VoiceIndex];
+	fr_i64& StopTime = Voices.GetStopTimes()[VoiceIndex];
+	fr_i32 StartOffset = 0;
+	fr_i32 EndOffset = Frames;
+	bool IsStopping = false;
+	bool IsProcessed = false;
+	fr_f32* ppOutput[MAX_CHANNELS] = {};
+
+	/* Scheduled start and stop are applied at exact sample offset inside block */
+	if (StartTime != NO_SCHEDULED_TIME && StartTime < RenderClock + Frames) {
+		StartOffset = (fr_i32)std::max(StartTime - RenderClock, (fr_i64)0);
+		StartTime = NO_SCHEDULED_TIME;
+		pEmitter->SetState(ePlayState);
+	}
+
+	if (StopTime != NO_SCHEDULED_TIME && StopTime < RenderClock + Frames) {
+		EndOffset = (fr_i32)std::max(StopTime - RenderClock, (fr_i64)StartOffset);
+		StopTime = NO_SCHEDULED_TIME;
+		IsStopping = true;
+	}
+
+	/* Stopped voice can be processed only if effects have some tail */
+	fr_i32 EmitterState = pEmitter->GetState();
+	Voices.GetStates()[VoiceIndex] = EmitterState;
+	if ((EmitterState == eStopState || EmitterState == ePauseState) && !pEmitter->HasTail()) return false;
+	if (Voices.GetFlags()[VoiceIndex] & eVoiceVirtualFlag) {
+		ProcessVirtualVoice(VoiceIndex, EndOffset - StartOffset);
+		if (IsStopping) {
+			pEmitter->SetState(eStopState);
+			Voices.GetStates()[VoiceIndex] = eStopState;
+		}
+
+		return false;
+	}
+
+	/* Emitter adds own output to bus buffer by itself */
+	C2DFloatBuffer& BusBuffer = Target.GetBuffer(pEmitter->GetBus());
+	for (fr_i32 i = 0; i < Channels; i++) {
+		ppOutput[i] = BusBuffer.GetBufferData(i) + StartOffset;
+	}
+
+	if (EndOffset > StartOffset) {
+		IsProcessed = pEmitter->ProcessAdd(TempBuffer.GetBuffers(), ppOutput, EndOffset - StartOffset, Channels);
+		if (IsProcessed) MixVoiceSends(pEmitter, TempBuffer, Target, StartOffset, EndOffset - StartOffset, Channels);
+	}
+
+	if (IsStopping) pEmitter->SetState(eStopState);
+	Voices.GetStates()[VoiceIndex] = pEmitter->GetState();
+	Voices.GetPositions()[VoiceIndex] = pEmitter->GetPosition();
+	return IsProcessed;
+}
+
+void
+CAdvancedMixer::MixVoiceSends(IBaseEmitter* pEmitter, C2DFloatBuffer& TempBuffer, BusesMixTarget& Target, fr_i32 Offset, fr_i32 Frames, fr_i32 Channels)
+{
+	fr_f32 StartGains[MAX_CHANNELS] = {};
+	fr_f32 EndGains[MAX_CHANNELS] = {};
+	bool IsFaderGains = false;
+
+	/* Temp buffer still has emitter output before volume and pan */
+	for (fr_i32 SendIndex = 0; SendIndex < AUX_BUSES_COUNT; SendIndex++) {
+		fr_f32 StartLevel = 0.f;
+		fr_f32 EndLevel = 0.f;
+		if (!pEmitter->GetSendRamp(SendIndex, StartLevel, EndLevel)) continue;
+
+		C2DFloatBuffer& AuxBuffer = Target.GetBuffer(eFirstAuxBus + SendIndex);
+		bool IsPreFader = pEmitter->IsPreFaderSend(eFirstAuxBus + SendIndex);
+		if (!IsPreFader && !IsFaderGains) {
+			pEmitter->GetFaderGains(StartGains, EndGains, Channels);
+			IsFaderGains = true;
+		}
+
+		for (fr_i32 i = 0; i < Channels; i++) {
+			MixerAddToBufferRamp(
+				AuxBuffer.GetBufferData(i) + Offset, 
+				TempBuffer.GetBufferData(i), 
+				Frames,
+				IsPreFader ? StartLevel : StartLevel * StartGains[i],
+				IsPreFader ? EndLevel : EndLevel * EndGains[i]
+			);
+		}
+	}
+}
+
+bool
+CAdvancedMixer::MixVoices(fr_i32 Frames, fr_i32 Channels)
+{
+	for (fr_i32 i = 0; i < Voices.GetCount(); i++) {
+		MixVoice(i, tempBuffer, BusesTarget, Frames, Channels);
+	}
+
+	return true;
+}
+
+bool
+CAdvancedMixer::RenderBlock(fr_f32* pOutput, fr_i32 Frames, fr_i32 Channels)
+{
 	tempBuffer.Resize(Channels, Frames);
 	mixBuffer.Resize(Channels, Frames);
+	mixBuffer.Clear();
+	BusesTarget.Reset(Channels, Frames);
+	ProcessCommands();
+	UpdateVirtualVoices();
+	if (!MixVoices(Frames, Channels)) return false;
+	RecycleOneShots();
+	MixBuses(Frames, Channels);
+	WriteOutputs(Frames, Channels);
+	UpdateResamplerDelay();
+	RenderClock += Frames;
+	MixerClock.store(RenderClock, std::memory_order_release);
 
-	for (size_t i = 0; i < RING_BUFFERS_COUNT; i++) {
-		tempBuffer.Clear();
-		mixBuffer.Clear();
-		pListNode = pFirstListener;
-		while (pListNode) {
-			/* Source restart issue  */
-			EmittersNode* pEmittersNode = nullptr;
-			if (!pListNode->pListener) break;
-			pListNode->pListener->GetFirstEmitter(&pEmittersNode);
-			while (pEmittersNode) {
-				tempBuffer.Clear();
-				pEmittersNode->pEmitter->Process(tempBuffer.GetBuffers(), Frames);
-				for (size_t o = 0; o < Channels; o++) {
-					MixerAddToBuffer(mixBuffer.GetBufferData((fr_i32)o), tempBuffer.GetBufferData((fr_i32)o), Frames);
-				}
-
-				pEmittersNode = pEmittersNode->pNext;
-			}
+	/* No voices were mixed, so we don't need to interleave zeros */
+	if (IsMixSilent) {
+		memset(pOutput, 0, sizeof(fr_f32) * Frames * Channels);
+		return true;
+	}
 
-			pListNode = pListNode->pNext;
-		}
+	PlanarToLinear(mixBuffer.GetBuffers(), pOutput, Frames * Channels, Channels);
+	return true;
+}
+
+bool
+CAdvancedMixer::Render(fr_i32 Frames, fr_i32 Channels, fr_i32 SampleRate)
+{
+	bool IsRendered = true;
 
-		/* Update ring buffer state for pushing new data */
-		PlanarToLinear(mixBuffer.GetBuffers(), OutputBuffer.Data(), Frames * Channels, Channels);
-		RingBuffer.PushBuffer(OutputBuffer.Data(), Frames * Channels);
-		RingBuffer.NextBuffer();
+	/* Producer thread or offline render renders data by itself */
+	if (EnterEndpoint() == eEndpointRenderMode) IsRendered = RenderQuantum(Frames, Channels);
+	LeaveEndpoint();
+	return IsRendered;
+}
+
+bool
+CAdvancedMixer::RenderQuantum(fr_i32 Frames, fr_i32 Channels)
+{
+	fr_i64 BlockSamples = (fr_i64)Frames * Channels;
+
+	FRESPONZE_BEGIN_TEST
+	ProcessCommands();
+
+	/* FIFO is recreated only if output endpoint changes format */
+	if (FifoChannels != Channels || OutputFifo.GetCapacity() < BlockSamples * OUTPUT_FIFO_BLOCKS) {
+		OutputFifo.Resize(BlockSamples * OUTPUT_FIFO_BLOCKS);
+		FifoChannels = Channels;
 	}
+
+	/* Render one quantum, only if FIFO has space for it */
+	if (OutputFifo.GetWriteAvailable() < BlockSamples) return true;
+	OutputBuffer.Resize((fr_i32)BlockSamples);
+	if (!RenderBlock(OutputBuffer.Data(), Frames, Channels)) return false;
+	OutputFifo.Write(OutputBuffer.Data(), BlockSamples);
 	FRESPONZE_END_TEST("Audio render")
 
 	return true;
 }
 
+void
+CAdvancedMixer::UpdateResamplerDelay()
+{
+	fr_i32 MaxDelay = 0;
+	ListenersNode* pNode = pFirstListener;
+	while (pNode) {
+		if (pNode->VoicesCount && pNode->pListener) MaxDelay = std::max(MaxDelay, pNode->pListener->GetDelay());
+		pNode = pNode->pNext;
+	}
+
+	ResamplerDelay.store(MaxDelay, std::memory_order_relaxed);
+}
+
+bool
+CAdvancedMixer::IsVoicesFinished()
+{
+	for (fr_i32 i = 0; i < Voices.GetCount(); i++) {
+		fr_i32 State = Voices.GetStates()[i];
+		if (State != eStopState && State != ePauseState) return false;
+
+		/* Stopped voice with scheduled start will play later */
+		if (Voices.GetStartTimes()[i] != NO_SCHEDULED_TIME) return false;
+		if (Voices.GetEmitters()[i]->HasTail()) return false;
+	}
+
+	return true;
+}
+
+bool
+CAdvancedMixer::RenderToFile(const fr_utf8* pFilePath, fr_i64 FramesCount, bool IsFloat)
+{
+	bool IsRendered = true;
+	bool IsProducerEnabled = !!hProducerThread;
+	fr_i32 Frames = BufferedSamples ? BufferedSamples : MixFormat.Frames;
+	fr_i32 Channels = MixFormat.Channels;
+	fr_i64 RenderedFrames = 0;
+	fr_i64 MaxFrames = FramesCount > 0 ? FramesCount : (fr_i64)MixFormat.SampleRate * OFFLINE_MAX_SILENT_RENDER_SECONDS;
+	CRIFFWriter* pWriter = nullptr;
+	PcmFormat FileFormat = MixFormat;
+	CFloatBuffer BlockBuffer = {};
+
+	CollectGarbage();
+	if (Frames <= 0 || !Channels || !MixFormat.SampleRate) return false;
+	if (pFilePath) {
+		FileFormat.IsFloat = IsFloat;
+		pWriter = new CRIFFWriter;
+		if (!pWriter->Open(pFilePath, FileFormat)) {
+			_RELEASE(pWriter);
+			return false;
+		}
+	}
+
+	/* Offline render uses mixer exclusively, secondary outputs get nothing */
+	StopProducer();
+	SwitchRenderMode(eOfflineRenderMode);
+	BlockBuffer.Resize(Frames * Channels);
+	while (RenderedFrames < MaxFrames) {
+		/* Mixer always renders full blocks, only the last one is cutted */
+		fr_i64 BlockFrames = std::min((fr_i64)Frames, MaxFrames - RenderedFrames);
+		if (!RenderBlock(BlockBuffer.Data(), Frames, Channels)) {
+			IsRendered = false;
+			break;
+		}
+
+		CollectGarbage();
+		if (FramesCount <= 0 && IsMixSilent && IsVoicesFinished()) break;
+		if (pWriter && !pWriter->Write(BlockBuffer.Data(), BlockFrames)) {
+			IsRendered = false;
+			break;
+		}
+
+		RenderedFrames += BlockFrames;
+	}
+
+	/* Looping emitters never finish, so render until silence is limited */
+	if (FramesCount <= 0 && RenderedFrames >= MaxFrames) {
+		TypeToLog("Mixer: offline render reached maximum length, emitters are still playing");
+	}
+
+	if (pWriter) {
+		if (!pWriter->Close()) IsRendered = false;
+		_RELEASE(pWriter);
+	}
+
+	SwitchRenderMode(eEndpointRenderMode);
+	if (IsProducerEnabled) StartProducer();
+	return IsRendered;
+}
+
 bool 
 CAdvancedMixer::Flush()
 {
@@ -0,0 +1,470 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2019-2020. All rights reserved.
+* Copyright (C) Suirless, 2020. All rights reserved.
+* Fresponze - fast, simple and modern multimedia sound library
+* Apache-2 License
+**********************************************************************
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*****************************************************************/
+#include "FresponzeConvolution.h"
+#include "FresponzeSoundBank.h"
+
+IBaseEffect*
+GetConvolutionReverb(CImpulseResponse* pResponse)
+{
+	return new CConvolutionReverb(pResponse);
+}
+
+CImpulseResponse::CImpulseResponse()
+{
+	AddRef();
+}
+
+bool
+CImpulseResponse::SetData(fr_f32** ppData, fr_i32 ChannelsCount, fr_i32 FramesCount, fr_i32 DataSampleRate, bool Normalize)
+{
+	fr_f64 Energy = 0.;
+	fr_f32 Scale = 1.f;
+	fr_i32 BlockSize = CONVOLUTION_HEAD_LENGTH;
+	CFloatBuffer SegmentBuffer = {};
+	CFloatBuffer FFTBuffer = {};
+
+	if (!ppData || ChannelsCount <= 0 || ChannelsCount > MAX_CHANNELS || FramesCount <= 0 || DataSampleRate <= 0) return false;
+
+	SampleRate = DataSampleRate;
+	Channels = ChannelsCount;
+	Frames = FramesCount;
+
+	if (Normalize) {
+		for (fr_i32 c = 0; c < Channels; c++) {
+			for (fr_i32 i = 0; i < Frames; i++) {
+				Energy += (fr_f64)ppData[c][i] * ppData[c][i];
+			}
+		}
+
+		Energy /= Channels;
+		if (Energy > 0.) Scale = (fr_f32)(1. / sqrt(Energy));
+	}
+
+	HeadLength = std::min(Frames, CONVOLUTION_HEAD_LENGTH);
+	HeadTaps.Resize(Channels * CONVOLUTION_HEAD_LENGTH);
+	HeadTaps.Clear();
+	for (fr_i32 c = 0; c < Channels; c++) {
+		for (fr_i32 i = 0; i < HeadLength; i++) {
+			GetHeadTaps(c)[i] = ppData[c][i] * Scale;
+		}
+	}
+
+	/* Every stage starts at offset equal to its block size */
+	StagesCount = 0;
+	for (fr_i32 Stage = 0; Stage < CONVOLUTION_STAGES_COUNT; Stage++) {
+		ConvolutionStage& StageData = Stages[Stage];
+		fr_i32 Offset = BlockSize;
+		fr_i32 End = Stage == CONVOLUTION_STAGES_COUNT - 1 ? Frames : std::min(Frames, BlockSize * CONVOLUTION_BLOCK_RATIO);
+		if (Offset >= Frames) break;
+
+		StagesFFT[Stage].Initialize(BlockSize * 2);
+		StageData.BlockSize = BlockSize;
+		StageData.BinsCount = BlockSize + 1;
+		StageData.PartitionsCount = (End - Offset + BlockSize - 1) / BlockSize;
+		StageData.Spectra.Resize(Channels * StageData.PartitionsCount * StageData.BinsCount * 2);
+		SegmentBuffer.Resize(BlockSize * 2);
+		FFTBuffer.Resize(BlockSize * 2);
+
+		/* Partition is padded by zeros to FFT size, so circular convolution is linear for the last block */
+		for (fr_i32 c = 0; c < Channels; c++) {
+			for (fr_i32 Partition = 0; Partition < StageData.PartitionsCount; Partition++) {
+				fr_i32 First = Offset + Partition * BlockSize;
+				fr_i32 Count = std::min(BlockSize, End - First);
+				fr_f32* pSpectrum = GetPartition(Stage, c, Partition);
+
+				SegmentBuffer.Clear();
+				for (fr_i32 i = 0; i < Count; i++) {
+					SegmentBuffer[i] = ppData[c][First + i] * Scale;
+				}
+
+				StagesFFT[Stage].Forward(SegmentBuffer.Data(), pSpectrum, pSpectrum + StageData.BinsCount, FFTBuffer.Data());
+			}
+		}
+
+		StagesCount++;
+		BlockSize *= CONVOLUTION_BLOCK_RATIO;
+	}
+
+	return true;
+}
+
+bool
+CImpulseResponse::Load(IMediaResource* pResource, fr_i32 OutputSampleRate, bool Normalize)
+{
+	PcmFormat DecodeFormat = {};
+	PcmFormat ResponseFormat = {};
+	bool IsLoaded = false;
+
+	if (!pResource || OutputSampleRate <= 0) return false;
+
+	/* PCM resource does decoding and resampling by resource cursor */
+	CPcmMediaResource* pPcmResource = new CPcmMediaResource;
+	DecodeFormat.SampleRate = OutputSampleRate;
+	if (pPcmResource->Decode(pResource, DecodeFormat)) {
+		C2DFloatBuffer ResponseData = {};
+		pPcmResource->GetFormat(ResponseFormat);
+		ResponseData.Resize(ResponseFormat.Channels, ResponseFormat.Frames);
+		pPcmResource->ReadRawAt(0, ResponseFormat.Frames, ResponseData.GetBuffers());
+		IsLoaded = SetData(ResponseData.GetBuffers(), ResponseFormat.Channels, ResponseFormat.Frames, OutputSampleRate, Normalize);
+	}
+
+	_RELEASE(pPcmResource);
+	return IsLoaded;
+}
+
+bool
+CImpulseResponse::LoadFile(const fr_utf8* pPath, fr_i32 OutputSampleRate, bool Normalize)
+{
+	bool IsLoaded = false;
+	if (!pPath) return false;
+
+	IMediaResource* pFileResource = (IMediaResource*)GetFormatListener((char*)pPath);
+	if (!pFileResource) return false;
+	if (pFileResource->OpenResource((void*)pPath)) {
+		IsLoaded = Load(pFileResource, OutputSampleRate, Normalize);
+	}
+
+	_RELEASE(pFileResource);
+	return IsLoaded;
+}
+
+CConvolutionReverb::CConvolutionReverb(CImpulseResponse* pResponse)
+{
+	AddRef();
+	if (pResponse) pResponse->Clone((void**)&pImpulseResponse);
+}
+
+CConvolutionReverb::~CConvolutionReverb()
+{
+	FreeState();
+	_RELEASE(pImpulseResponse);
+}
+
+void
+CConvolutionReverb::SetImpulseResponse(CImpulseResponse* pResponse)
+{
+	_RELEASE(pImpulseResponse);
+	if (pResponse) pResponse->Clone((void**)&pImpulseResponse);
+	AllocateState();
+}
+
+void
+CConvolutionReverb::FreeState()
+{
+	for (fr_i32 c = 0; c < MAX_CHANNELS; c++) {
+		HeadHistory[c].Free();
+		for (fr_i32 Stage = 0; Stage < CONVOLUTION_STAGES_COUNT; Stage++) {
+			ConvolutionStageState& State = States[c][Stage];
+			State.Input.Free();
+			State.History.Free();
+			State.Accumulator.Free();
+			State.Output.Free();
+		}
+	}
+}
+
+void
+CConvolutionReverb::AllocateState()
+{
+	FreeState();
+	BlockPhase = 0;
+	IsGainsValid = false;
+	if (!pImpulseResponse || !ReverbFormat.Channels) return;
+
+	if (pImpulseResponse->GetSampleRate() != ReverbFormat.SampleRate) {
+		TypeToLog("Convolution: impulse response sample rate doesn't match effect format");
+	}
+
+	/* Direct part keeps the last (CONVOLUTION_HEAD_LENGTH - 1) frames before current input */
+	for (fr_i32 c = 0; c < ReverbFormat.Channels; c++) {
+		HeadHistory[c].Resize(CONVOLUTION_HEAD_LENGTH * 2);
+		HeadHistory[c].Clear();
+		for (fr_i32 Stage = 0; Stage < pImpulseResponse->GetStagesCount(); Stage++) {
+			ConvolutionStage& StageData = pImpulseResponse->GetStage(Stage);
+			ConvolutionStageState& State = States[c][Stage];
+			State.Input.Resize(StageData.BlockSize * 2);
+			State.History.Resize(StageData.PartitionsCount * StageData.BinsCount * 2);
+			State.Accumulator.Resize(StageData.BinsCount * 2);
+			State.Output.Resize(StageData.BlockSize);
+			State.Input.Clear();
+			State.History.Clear();
+			State.Accumulator.Clear();
+			State.Output.Clear();
+			State.HistoryHead = 0;
+			State.PartitionsDone = 0;
+		}
+	}
+
+	WetBuffer.Resize(CONVOLUTION_HEAD_LENGTH);
+	TimeBuffer.Resize(CONVOLUTION_MAX_BLOCK * 2);
+	TempBuffer.Resize(CONVOLUTION_MAX_BLOCK * 2);
+}
+
+void
+CConvolutionReverb::ProcessHead(fr_i32 Channel, fr_f32* pInput, fr_f32* pWet, fr_i32 Frames)
+{
+	fr_i32 ResponseChannel = std::min(Channel, pImpulseResponse->GetChannels() - 1);
+	fr_f32* pTaps = pImpulseResponse->GetHeadTaps(ResponseChannel);
+	fr_f32* pHistory = HeadHistory[Channel].Data();
+	fr_f32* pCurrent = pHistory + CONVOLUTION_HEAD_LENGTH - 1;
+
+	/* Every tap adds delayed input, so inner loop is vectorized by add kernel */
+	memcpy(pCurrent, pInput, sizeof(fr_f32) * Frames);
+	for (fr_i32 Tap = 0; Tap < pImpulseResponse->GetHeadLength(); Tap++) {
+		MixerAddToBufferRamp(pWet, pCurrent - Tap, Frames, pTaps[Tap], pTaps[Tap]);
+	}
+
+	memmove(pHistory, pHistory + Frames, sizeof(fr_f32) * (CONVOLUTION_HEAD_LENGTH - 1));
+}
+
+void
+CConvolutionReverb::AccumulatePartitions(fr_i32 Channel, fr_i32 Stage, fr_i32 LastPartition)
+{
+	ConvolutionStage& StageData = pImpulseResponse->GetStage(Stage);
+	ConvolutionStageState& State = States[Channel][Stage];
+	fr_i32 ResponseChannel = std::min(Channel, pImpulseResponse->GetChannels() - 1);
+	fr_i32 BinsCount = StageData.BinsCount;
+	fr_f32* pAccumulator = State.Accumulator.Data();
+
+	/* Partition N of the next block is multiplied by input block which was N - 1 blocks before the newest one */
+	for (fr_i32 Partition = State.PartitionsDone + 1; Partition <= LastPartition; Partition++) {
+		fr_i32 Slot = (State.HistoryHead + 1 - Partition + StageData.PartitionsCount) % StageData.PartitionsCount;
+		fr_f32* pInputSpectrum = State.History.Data() + Slot * BinsCount * 2;
+		fr_f32* pResponseSpectrum = pImpulseResponse->GetPartition(Stage, ResponseChannel, Partition);
+		ComplexMultiplyAdd(
+			pAccumulator, pAccumulator + BinsCount,
+			pInputSpectrum, pInputSpectrum + BinsCount,
+			pResponseSpectrum, pResponseSpectrum + BinsCount,
+			BinsCount
+		);
+	}
+
+	State.PartitionsDone = std::max(State.PartitionsDone, LastPartition);
+}
+
+void
+CConvolutionReverb::CompleteBlock(fr_i32 Channel, fr_i32 Stage)
+{
+	ConvolutionStage& StageData = pImpulseResponse->GetStage(Stage);
+	ConvolutionStageState& State = States[Channel][Stage];
+	CRealFFT& StageFFT = pImpulseResponse->GetStageFFT(Stage);
+	fr_i32 BlockSize = StageData.BlockSize;
+	fr_i32 BinsCount = StageData.BinsCount;
+	fr_f32* pAccumulator = State.Accumulator.Data();
+
+	/* Old partitions must be finished before the newest spectrum replaces the oldest one */
+	AccumulatePartitions(Channel, Stage, StageData.PartitionsCount - 1);
+
+	State.HistoryHead = (State.HistoryHead + 1) % StageData.PartitionsCount;
+	fr_f32* pInputSpectrum = State.History.Data() + State.HistoryHead * BinsCount * 2;
+	StageFFT.Forward(State.Input.Data(), pInputSpectrum, pInputSpectrum + BinsCount, TempBuffer.Data());
+	memcpy(State.Input.Data(), State.Input.Data() + BlockSize, sizeof(fr_f32) * BlockSize);
+
+	fr_f32* pResponseSpectrum = pImpulseResponse->GetPartition(Stage, std::min(Channel, pImpulseResponse->GetChannels() - 1), 0);
+	ComplexMultiplyAdd(
+		pAccumulator, pAccumulator + BinsCount,
+		pInputSpectrum, pInputSpectrum + BinsCount,
+		pResponseSpectrum, pResponseSpectrum + BinsCount,
+		BinsCount
+	);
+
+	/* Overlap-save: only the second half of block is linear convolution */
+	StageFFT.Inverse(pAccumulator, pAccumulator + BinsCount, TimeBuffer.Data(), TempBuffer.Data());
+	memcpy(State.Output.Data(), TimeBuffer.Data() + BlockSize, sizeof(fr_f32) * BlockSize);
+
+	State.Accumulator.Clear();
+	State.PartitionsDone = 0;
+}
+
+bool
+CConvolutionReverb::Process(fr_f32** ppData, fr_i32 Frames)
+{
+	fr_i32 Position = 0;
+	fr_f32 DryTarget = DryGain;
+	fr_f32 WetTarget = WetGain;
+	if (!pImpulseResponse || !ReverbFormat.Channels || Frames <= 0) return false;
+	if (!IsGainsValid) {
+		LastDryGain = DryTarget;
+		LastWetGain = WetTarget;
+		IsGainsValid = true;
+	}
+
+	fr_i32 StagesCount = pImpulseResponse->GetStagesCount();
+	while (Position < Frames) {
+		fr_i32 ChunkFrames = std::min(Frames - Position, CONVOLUTION_HEAD_LENGTH - BlockPhase % CONVOLUTION_HEAD_LENGTH);
+		fr_f32 DryStart = LastDryGain + (DryTarget - LastDryGain) * Position / Frames;
+		fr_f32 DryEnd = LastDryGain + (DryTarget - LastDryGain) * (Position + ChunkFrames) / Frames;
+		fr_f32 WetStart = LastWetGain + (WetTarget - LastWetGain) * Position / Frames;
+		fr_f32 WetEnd = LastWetGain + (WetTarget - LastWetGain) * (Position + ChunkFrames) / Frames;
+		fr_f32 DryStep = (DryEnd - DryStart) / ChunkFrames;
+
+		for (fr_i32 c = 0; c < ReverbFormat.Channels; c++) {
+			fr_f32* pData = ppData[c] + Position;
+			fr_f32* pWet = WetBuffer.Data();
+
+			memset(pWet, 0, sizeof(fr_f32) * ChunkFrames);
+			ProcessHead(c, pData, pWet, ChunkFrames);
+			for (fr_i32 Stage = 0; Stage < StagesCount; Stage++) {
+				ConvolutionStageState& State = States[c][Stage];
+				fr_i32 BlockSize = pImpulseResponse->GetStage(Stage).BlockSize;
+				fr_i32 StagePhase = BlockPhase % BlockSize;
+				memcpy(State.Input.Data() + BlockSize + StagePhase, pData, sizeof(fr_f32) * ChunkFrames);
+				MixerAddToBuffer(pWet, State.Output.Data() + StagePhase, ChunkFrames);
+			}
+
+			for (fr_i32 i = 0; i < ChunkFrames; i++) {
+				pData[i] *= DryStart + DryStep * i;
+			}
+
+			MixerAddToBufferRamp(pData, pWet, ChunkFrames, WetStart, WetEnd);
+		}
+
+		Position += ChunkFrames;
+		BlockPhase += ChunkFrames;
+
+		/* Long blocks accumulate old partitions proportionally to collected input */
+		for (fr_i32 Stage = 0; Stage < StagesCount; Stage++) {
+			ConvolutionStage& StageData = pImpulseResponse->GetStage(Stage);
+			fr_i32 StagePhase = BlockPhase % StageData.BlockSize;
+			for (fr_i32 c = 0; c < ReverbFormat.Channels; c++) {
+				if (!StagePhase) CompleteBlock(c, Stage);
+				else AccumulatePartitions(c, Stage, (StageData.PartitionsCount - 1) * StagePhase / StageData.BlockSize);
+			}
+		}
+
+		BlockPhase %= CONVOLUTION_MAX_BLOCK;
+	}
+
+	LastDryGain = DryTarget;
+	LastWetGain = WetTarget;
+	return true;
+}
+
+bool
+CConvolutionReverb::GetEffectCategory(fr_i32& EffectCategory)
+{
+	EffectCategory = CategoryRoomFx;
+	return true;
+}
+
+bool
+CConvolutionReverb::GetEffectType(fr_i32& EffectType)
+{
+	EffectType = SoundEffectType;
+	return true;
+}
+
+bool
+CConvolutionReverb::GetPluginName(fr_string64& DescriptionString)
+{
+	strcpy(DescriptionString, "Convolution Reverb");
+	return true;
+}
+
+bool
+CConvolutionReverb::GetPluginVendor(fr_string64& DescriptionString)
+{
+	strcpy(DescriptionString, "Fresponze");
+	return true;
+}
+
+bool
+CConvolutionReverb::GetPluginDescription(fr_string256& DescriptionString)
+{
+	strcpy(DescriptionString, "Zero latency partitioned convolution with shared impulse responses");
+	return true;
+}
+
+bool
+CConvolutionReverb::GetVariablesCount(fr_i32& CountOfVariables)
+{
+	CountOfVariables = eConvolutionParametersCount;
+	return true;
+}
+
+bool
+CConvolutionReverb::GetVariableDescription(fr_i32 VariableIndex, fr_string128& DescriptionString)
+{
+	switch (VariableIndex)
+	{
+	case eConvolutionDryParameter: strcpy(DescriptionString, "Dry signal gain"); break;
+	case eConvolutionWetParameter: strcpy(DescriptionString, "Reverberated signal gain"); break;
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+bool
+CConvolutionReverb::GetVariableKnob(fr_i32 VariableIndex, fr_i32& KnobType)
+{
+	if (VariableIndex < 0 || VariableIndex >= eConvolutionParametersCount) return false;
+	KnobType = CircleKnob;
+	return true;
+}
+
+void
+CConvolutionReverb::SetOption(fr_i32 Option, fr_f32* pData, fr_i32 DataSize)
+{
+	if (!pData || DataSize != sizeof(fr_f32)) return;
+
+	switch (Option)
+	{
+	case eConvolutionDryParameter: DryGain = std::max(*pData, 0.f); break;
+	case eConvolutionWetParameter: WetGain = std::max(*pData, 0.f); break;
+	default:
+		break;
+	}
+}
+
+void
+CConvolutionReverb::GetOption(fr_i32 Option, fr_f32* pData, fr_i32 DataSize)
+{
+	if (!pData || DataSize != sizeof(fr_f32)) return;
+
+	switch (Option)
+	{
+	case eConvolutionDryParameter: *pData = DryGain; break;
+	case eConvolutionWetParameter: *pData = WetGain; break;
+	default:
+		break;
+	}
+}
+
+void
+CConvolutionReverb::SetFormat(PcmFormat* pFormat)
+{
+	if (!pFormat || !pFormat->Channels || pFormat->Channels > MAX_CHANNELS) return;
+
+	ReverbFormat = *pFormat;
+	AllocateState();
+}
+
+void
+CConvolutionReverb::GetFormat(PcmFormat* pFormat)
+{
+	*pFormat = ReverbFormat;
+}
+
+fr_i32
+CConvolutionReverb::GetTailLength()
+{
+	return pImpulseResponse ? pImpulseResponse->GetFrames() : 0;
+}
@@ -51,16 +51,17 @@ CAdvancedEmitter::FreeStuff()
 void
 CAdvancedEmitter::AddEffect(IBaseEffect* pNewEffect)
 {
+	EffectNodeStruct* pTemp = new EffectNodeStruct;
+	memset(pTemp, 0, sizeof(EffectNodeStruct));
+	pNewEffect->Clone((void**)&pTemp->pEffect);
+
+	/* Effect added after linking to listener must get format too */
+	if (ListenerFormat.Channels) pTemp->pEffect->SetFormat(&ListenerFormat);
 	if (!pLastEffect) {
-		pFirstEffect = new EffectNodeStruct;
-		memset(pFirstEffect, 0, sizeof(EffectNodeStruct));
-		pLastEffect = pFirstEffect;
-		pNewEffect->Clone((void**)&pLastEffect->pEffect);
+		pFirstEffect = pTemp;
+		pLastEffect = pTemp;
 	}
 	else {
-		EffectNodeStruct* pTemp = new EffectNodeStruct;
-		memset(pFirstEffect, 0, sizeof(EffectNodeStruct));
-		pNewEffect->Clone((void**)&pTemp->pEffect);
 		pLastEffect->pNext = pTemp;
 		pTemp->pPrev = pLastEffect;
 		pLastEffect = pTemp;
@@ -75,12 +76,14 @@ CAdvancedEmitter::DeleteEffect(IBaseEffect* pNewEffect)
 		if (pNode->pEffect == pNewEffect) {
 			if (pNode == pFirstEffect) pFirstEffect = pFirstEffect->pNext;
 			if (pNode == pLastEffect) pLastEffect = pLastEffect->pPrev;
-			pNode->pPrev->pNext = pNode->pNext;
-			pNode->pNext->pPrev = pNode->pPrev;
+			if (pNode->pPrev) pNode->pPrev->pNext = pNode->pNext;
+			if (pNode->pNext) pNode->pNext->pPrev = pNode->pPrev;
 			_RELEASE(pNode->pEffect);
 			delete pNode;
 			return;
 		}
+
+		pNode = pNode->pNext;
 	}
 }
 
@@ -111,7 +114,13 @@ void
 CAdvancedEmitter::SetListener(void* pListener)
 {
 	IMediaListener* pTemp = (IMediaListener*)pListener;
-	pTemp->Clone(&pParentListener);
+	IMediaListener* pOldListener = (IMediaListener*)pParentListener;
+	pParentListener = nullptr;
+	_RELEASE(pOldListener);
+	if (pTemp) pTemp->Clone(&pParentListener);
+
+	/* New source must not be ramped from gains of previous one */
+	IsGainsValid = false;
 }
 
 void*
@@ -238,47 +247,36 @@ CAdvancedEmitter::GetOption(fr_i32 Option, fr_f32* pData, fr_i32 DataSize)
 }
 
 void
-CAdvancedEmitter::ProcessInternal(fr_f32** ppData, fr_i32 Frames, fr_i32 Channels, fr_i32 SampleRate)
+CAdvancedEmitter::GetChannelGains(fr_f32* pGains, fr_i32 Channels)
 {
-	/* Apple angle to signal */
-	if (Channels >= 2) {
-		fr_f32 leftcoeff = cosf(Angle) - sinf(Angle);
-		fr_f32 rightcoeff = cosf(Angle) + sinf(Angle);
-		for (size_t o = 0; o < Frames; o++) {
-			ppData[0][o] *= leftcoeff;
-			ppData[1][o] *= rightcoeff;
-		}
+	for (fr_i32 i = 0; i < Channels; i++) {
+		pGains[i] = VolumeLevel;
 	}
 
-	for (size_t i = 0; i < Channels; i++) {
-		for (size_t o = 0; o < Frames; o++) {
-			ppData[i][o] *= VolumeLevel;
-		}
+	/* Apply angle to signal */
+	if (Channels >= 2) {
+		pGains[0] *= cosf(Angle) - sinf(Angle);
+		pGains[1] *= cosf(Angle) + sinf(Angle);
 	}
 }
 
-bool 
-CAdvancedEmitter::Process(fr_f32** ppData, fr_i32 Frames) 
+fr_i32
+CAdvancedEmitter::ReadSource(fr_f32** ppData, fr_i32 Frames)
 {
-	if (!pParentListener || (EmittersState == eStopState || EmittersState == ePauseState)) return false;
 	fr_i32 BaseEmitterPosition = 0;
-	fr_i32 BaseListenerPosition = 0;
 	fr_i32 FramesReaded = 0;
 	IMediaListener* ThisListener = (IMediaListener*)pParentListener;
 
-	/* Get current position of listener and emitter to reset old state */
+	/* Get current position of emitter to reset old listener state */
 	BaseEmitterPosition = (fr_i32)GetPosition();
-	BaseListenerPosition = (fr_i32)ThisListener->GetPosition();
-
 	fr_i64 FullFileSize = ThisListener->GetFullFrames();
 	if (BaseEmitterPosition > FullFileSize) {
 		BaseEmitterPosition = 0;
 	}
 
 	/* Set emitter position to listener and read data */
-	fr_i64 SettedListenerPosition = ThisListener->SetPosition((fr_i64)BaseEmitterPosition);
+	ThisListener->SetPosition((fr_i64)BaseEmitterPosition);
 	FramesReaded = ThisListener->Process(ppData, Frames);
-	fr_i64 CurrentListPosition = ThisListener->GetPosition();
 
 	if (FramesReaded < Frames) {
 		BaseEmitterPosition = 0;
@@ -303,15 +301,90 @@ CAdvancedEmitter::Process(fr_f32** ppData, fr_i32 Frames)
 		BaseEmitterPosition += FramesReaded;
 	}
 
-	/* Process by emitter effect */
-	ProcessInternal(ppData, Frames, ListenerFormat.Channels, ListenerFormat.SampleRate);
+	SetPosition(BaseEmitterPosition);
+	return FramesReaded;
+}
+
+bool
+CAdvancedEmitter::ProcessSource(fr_f32** ppData, fr_i32 Frames, fr_i32 Channels)
+{
+	fr_i32 FramesReaded = 0;
+
+	/* Only part of block which wasn't filled by source must be cleared */
+	if (EmittersState != eStopState && EmittersState != ePauseState) {
+		FramesReaded = ReadSource(ppData, Frames);
+	}
+
+	if (FramesReaded < Frames) {
+		for (fr_i32 i = 0; i < Channels; i++) {
+			memset(&ppData[i][FramesReaded], 0, sizeof(fr_f32) * (Frames - FramesReaded));
+		}
+	}
+
+	/* Source is silent in this block, so only effects tail can be heard */
+	if (!FramesReaded) return ProcessTail(ppData, Frames);
+
 	EffectNodeStruct* pEffectToProcess = pFirstEffect;
 	while (pEffectToProcess) {
 		pEffectToProcess->pEffect->Process(ppData, Frames);
 		pEffectToProcess = pEffectToProcess->pNext;
 	}
 
-	SetPosition(BaseEmitterPosition);
+	TailFramesLeft = GetEffectsTailLength();
 	return true;
 }
 
+void
+CAdvancedEmitter::UpdateFaderGains(fr_i32 Channels)
+{
+	fr_f32 Gains[MAX_CHANNELS] = {};
+	GetChannelGains(Gains, Channels);
+	for (fr_i32 i = 0; i < Channels; i++) {
+		FaderStartGains[i] = IsGainsValid ? LastGains[i] : Gains[i];
+		LastGains[i] = Gains[i];
+	}
+
+	IsGainsValid = true;
+}
+
+/* 
+	Volume and pan are applied after effects chain in both process paths.
+	Gain is ramped from previous block values to avoid zipper noise.
+*/
+bool 
+CAdvancedEmitter::Process(fr_f32** ppData, fr_i32 Frames) 
+{
+	fr_i32 Channels = ListenerFormat.Channels;
+	if (!pParentListener) return false;
+	if (!ProcessSource(ppData, Frames, Channels)) return false;
+
+	UpdateFaderGains(Channels);
+	for (fr_i32 i = 0; i < Channels; i++) {
+		ScaleBufferRamp(ppData[i], Frames, FaderStartGains[i], LastGains[i]);
+	}
+
+	return true;
+}
+
+bool
+CAdvancedEmitter::ProcessAdd(fr_f32** ppTemp, fr_f32** ppOutput, fr_i32 Frames, fr_i32 Channels)
+{
+	if (!pParentListener) return false;
+	if (!ProcessSource(ppTemp, Frames, Channels)) return false;
+
+	UpdateFaderGains(Channels);
+	for (fr_i32 i = 0; i < Channels; i++) {
+		MixerAddToBufferRamp(ppOutput[i], ppTemp[i], Frames, FaderStartGains[i], LastGains[i]);
+	}
+
+	return true;
+}
+
+void
+CAdvancedEmitter::GetFaderGains(fr_f32* pStartGains, fr_f32* pEndGains, fr_i32 Channels)
+{
+	for (fr_i32 i = 0; i < Channels; i++) {
+		pStartGains[i] = FaderStartGains[i];
+		pEndGains[i] = LastGains[i];
+	}
+}
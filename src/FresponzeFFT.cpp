@@ -0,0 +1,195 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2019-2020. All rights reserved.
+* Copyright (C) Suirless, 2020. All rights reserved.
+* Fresponze - fast, simple and modern multimedia sound library
+* Apache-2 License
+**********************************************************************
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*****************************************************************/
+#include "FresponzeFFT.h"
+
+bool
+CRealFFT::Initialize(fr_i32 Size)
+{
+	if (Size < 4 || (Size & (Size - 1))) return false;
+
+	FFTSize = Size;
+	ComplexSize = Size / 2;
+
+	fr_i32 Bits = 0;
+	while ((1 << Bits) < ComplexSize) Bits++;
+
+	BitReverse.Resize(ComplexSize);
+	for (fr_i32 i = 0; i < ComplexSize; i++) {
+		fr_i32 Reversed = 0;
+		for (fr_i32 j = 0; j < Bits; j++) {
+			if (i & (1 << j)) Reversed |= 1 << (Bits - 1 - j);
+		}
+
+		BitReverse[i] = Reversed;
+	}
+
+	/* 
+		Twiddles are stored by stages (1 + 2 + 4 + ... + ComplexSize / 2),
+		so butterfly loop of every stage reads them sequentially.
+	*/
+	StageCos.Resize(std::max(ComplexSize - 1, 1));
+	StageSin.Resize(std::max(ComplexSize - 1, 1));
+	StageSinInverse.Resize(std::max(ComplexSize - 1, 1));
+	fr_i32 Offset = 0;
+	for (fr_i32 Half = 1; Half < ComplexSize; Half <<= 1) {
+		for (fr_i32 j = 0; j < Half; j++) {
+			fr_f64 Angle = -M_PI * j / Half;
+			StageCos[Offset + j] = (fr_f32)cos(Angle);
+			StageSin[Offset + j] = (fr_f32)sin(Angle);
+			StageSinInverse[Offset + j] = (fr_f32)-sin(Angle);
+		}
+
+		Offset += Half;
+	}
+
+	PackCos.Resize(ComplexSize + 1);
+	PackSin.Resize(ComplexSize + 1);
+	for (fr_i32 k = 0; k <= ComplexSize; k++) {
+		fr_f64 Angle = -2. * M_PI * k / FFTSize;
+		PackCos[k] = (fr_f32)cos(Angle);
+		PackSin[k] = (fr_f32)sin(Angle);
+	}
+
+	return true;
+}
+
+void
+CRealFFT::ComplexTransform(fr_f32* pReal, fr_f32* pImag, bool IsInverse)
+{
+	fr_i32* pReverse = BitReverse.Data();
+	fr_f32* pCos = StageCos.Data();
+	fr_f32* pSin = IsInverse ? StageSinInverse.Data() : StageSin.Data();
+	fr_f32 Direction = IsInverse ? 1.f : -1.f;
+
+	for (fr_i32 i = 0; i < ComplexSize; i++) {
+		fr_i32 j = pReverse[i];
+		if (j > i) {
+			std::swap(pReal[i], pReal[j]);
+			std::swap(pImag[i], pImag[j]);
+		}
+	}
+
+	/* The first two stages have trivial twiddles (1 and -i), so they are done together as radix-4 */
+	if (ComplexSize >= 4) {
+		for (fr_i32 i = 0; i < ComplexSize; i += 4) {
+			fr_f32 Real0 = pReal[i] + pReal[i + 1];
+			fr_f32 Imag0 = pImag[i] + pImag[i + 1];
+			fr_f32 Real1 = pReal[i] - pReal[i + 1];
+			fr_f32 Imag1 = pImag[i] - pImag[i + 1];
+			fr_f32 Real2 = pReal[i + 2] + pReal[i + 3];
+			fr_f32 Imag2 = pImag[i + 2] + pImag[i + 3];
+			fr_f32 Real3 = pReal[i + 2] - pReal[i + 3];
+			fr_f32 Imag3 = pImag[i + 2] - pImag[i + 3];
+
+			/* Multiplication of the 4th value by -i (or i for inverse transform) */
+			fr_f32 RotatedReal = -Imag3 * Direction;
+			fr_f32 RotatedImag = Real3 * Direction;
+
+			pReal[i] = Real0 + Real2;
+			pImag[i] = Imag0 + Imag2;
+			pReal[i + 2] = Real0 - Real2;
+			pImag[i + 2] = Imag0 - Imag2;
+			pReal[i + 1] = Real1 + RotatedReal;
+			pImag[i + 1] = Imag1 + RotatedImag;
+			pReal[i + 3] = Real1 - RotatedReal;
+			pImag[i + 3] = Imag1 - RotatedImag;
+		}
+	} else {
+		ComplexButterflies(pReal, pImag, pReal + 1, pImag + 1, pCos, pSin, 1);
+	}
+
+	for (fr_i32 Half = 4; Half < ComplexSize; Half <<= 1) {
+		fr_i32 Offset = Half - 1;
+		for (fr_i32 Block = 0; Block < ComplexSize; Block += Half * 2) {
+			ComplexButterflies(
+				pReal + Block, pImag + Block,
+				pReal + Block + Half, pImag + Block + Half,
+				pCos + Offset, pSin + Offset,
+				Half
+			);
+		}
+	}
+}
+
+/*
+	Real signal of size N is transformed as complex signal of size N / 2
+	(even samples are real part, odd samples are imaginary part), and then
+	spectra of even and odd samples are separated and combined.
+*/
+void
+CRealFFT::Forward(const fr_f32* pInput, fr_f32* pReal, fr_f32* pImag, fr_f32* pTemp)
+{
+	fr_f32* pPackCos = PackCos.Data();
+	fr_f32* pPackSin = PackSin.Data();
+	fr_f32* pZReal = pTemp;
+	fr_f32* pZImag = pTemp + ComplexSize;
+
+	for (fr_i32 i = 0; i < ComplexSize; i++) {
+		pZReal[i] = pInput[i * 2];
+		pZImag[i] = pInput[i * 2 + 1];
+	}
+
+	ComplexTransform(pZReal, pZImag, false);
+
+	pReal[0] = pZReal[0] + pZImag[0];
+	pImag[0] = 0.f;
+	pReal[ComplexSize] = pZReal[0] - pZImag[0];
+	pImag[ComplexSize] = 0.f;
+
+	for (fr_i32 k = 1; k < ComplexSize; k++) {
+		fr_i32 m = ComplexSize - k;
+		fr_f32 EvenReal = 0.5f * (pZReal[k] + pZReal[m]);
+		fr_f32 EvenImag = 0.5f * (pZImag[k] - pZImag[m]);
+		fr_f32 OddReal = 0.5f * (pZImag[k] + pZImag[m]);
+		fr_f32 OddImag = -0.5f * (pZReal[k] - pZReal[m]);
+		pReal[k] = EvenReal + OddReal * pPackCos[k] - OddImag * pPackSin[k];
+		pImag[k] = EvenImag + OddReal * pPackSin[k] + OddImag * pPackCos[k];
+	}
+}
+
+void
+CRealFFT::Inverse(const fr_f32* pReal, const fr_f32* pImag, fr_f32* pOutput, fr_f32* pTemp)
+{
+	fr_f32* pPackCos = PackCos.Data();
+	fr_f32* pPackSin = PackSin.Data();
+	fr_f32* pZReal = pTemp;
+	fr_f32* pZImag = pTemp + ComplexSize;
+	fr_f32 Scale = 1.f / FFTSize;
+
+	for (fr_i32 k = 0; k < ComplexSize; k++) {
+		fr_i32 m = ComplexSize - k;
+		fr_f32 EvenReal = pReal[k] + pReal[m];
+		fr_f32 EvenImag = pImag[k] - pImag[m];
+		fr_f32 DiffReal = pReal[k] - pReal[m];
+		fr_f32 DiffImag = pImag[k] + pImag[m];
+
+		/* Odd spectrum is difference divided by twiddle (multiplied by conjugate) */
+		fr_f32 OddReal = DiffReal * pPackCos[k] + DiffImag * pPackSin[k];
+		fr_f32 OddImag = DiffImag * pPackCos[k] - DiffReal * pPackSin[k];
+		pZReal[k] = (EvenReal - OddImag) * Scale;
+		pZImag[k] = (EvenImag + OddReal) * Scale;
+	}
+
+	ComplexTransform(pZReal, pZImag, true);
+
+	for (fr_i32 i = 0; i < ComplexSize; i++) {
+		pOutput[i * 2] = pZReal[i];
+		pOutput[i * 2 + 1] = pZImag[i];
+	}
+}
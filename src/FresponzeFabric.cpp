@@ -24,6 +24,7 @@
 #include <stdarg.h>
 #endif
 #include "FresponzeAdvancedMixer.h"
+#include "new_render/FresponzeFuriousMixer.h"
 
 void* hModule = nullptr;
 
@@ -150,6 +151,9 @@ CFresponze::GetMixerInterface(
 		break;
 	case eMixerCustomType:
 		break;
+	case eMixerFuriousType:
+		*ppMixerInterface = new CFuriousMixer();
+		break;
 	default:
 		break;
 	}
@@ -0,0 +1,424 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2019-2020. All rights reserved.
+* Copyright (C) Suirless, 2020. All rights reserved.
+* Fresponze - fast, simple and modern multimedia sound library
+* Apache-2 License
+**********************************************************************
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*****************************************************************/
+#include "FresponzeFdnReverb.h"
+
+#define FDN_SHORTEST_RATIO 0.3f			// the shortest line relative to the longest one
+#define FDN_MIN_ROOM_RATIO 0.2f			// the longest line with room size 0
+#define FDN_DAMPING_FREQUENCY 4000.		// crossover of low and high frequencies decay
+#define FDN_DENORMAL_OFFSET 1e-18f
+
+IBaseEffect*
+GetFdnReverb()
+{
+	return new CFdnReverb;
+}
+
+static
+bool
+IsPrimeNumber(fr_i32 Number)
+{
+	if (Number < 2) return false;
+	for (fr_i32 i = 2; i * i <= Number; i++) {
+		if (!(Number % i)) return false;
+	}
+
+	return true;
+}
+
+CFdnReverb::CFdnReverb()
+{
+	AddRef();
+}
+
+CFdnReverb::~CFdnReverb()
+{
+	LinesBuffer.Free();
+	ChunkBuffer.Free();
+	WetBuffer.Free();
+}
+
+bool
+CFdnReverb::IsParametersChanged()
+{
+	fr_i32 Version = ParametersVersion.load(std::memory_order_acquire);
+	if (Version == AppliedVersion) return false;
+
+	AppliedVersion = Version;
+	return true;
+}
+
+void
+CFdnReverb::AllocateState()
+{
+	fr_f32 MaxModulation = FDN_MAX_MODULATION_MS * ReverbFormat.SampleRate / 1000.f;
+	fr_i32 MaxDelay = (fr_i32)(FDN_MAX_ROOM_SIZE_MS * ReverbFormat.SampleRate / 1000.f);
+
+	/* Primes after the longest delay are searched up to FDN_MAX_LINES numbers later */
+	LineLength = MaxDelay + FDN_MAX_LINES * 64 + (fr_i32)ceilf(MaxModulation) + FDN_MAX_CHUNK + 2;
+	LinesBuffer.Resize(FDN_MAX_LINES, LineLength);
+	ChunkBuffer.Resize(FDN_MAX_LINES, FDN_MAX_CHUNK);
+	WetBuffer.Resize(ReverbFormat.Channels * FDN_MAX_CHUNK);
+	LinesBuffer.Clear();
+	memset(Lanes, 0, sizeof(Lanes));
+	WritePosition = 0;
+	ModulationPhase = 0.;
+	ActiveLines = 0;
+	IsGainsValid = false;
+	OnParametersChanged();
+}
+
+void
+CFdnReverb::UpdateParameters()
+{
+	fr_f64 SampleRate = (fr_f64)ReverbFormat.SampleRate;
+	fr_f64 Pole = exp(-2. * M_PI * FDN_DAMPING_FREQUENCY / SampleRate);
+	fr_f64 HighDecayTime = std::max(DecayTime * (1. - 0.9 * Damping), 0.01);
+	fr_i32 Lines = LinesCount;
+	fr_f64 MatrixScale = 1. / sqrt((fr_f64)Lines);
+	fr_f32 LongestDelay = FDN_MAX_ROOM_SIZE_MS * (FDN_MIN_ROOM_RATIO + (1.f - FDN_MIN_ROOM_RATIO) * RoomSize) * ReverbFormat.SampleRate / 1000.f;
+	fr_i32 LastDelay = 0;
+
+	/* New lines count starts with silent network */
+	if (ActiveLines != Lines) {
+		LinesBuffer.Clear();
+		memset(Lanes, 0, sizeof(Lanes));
+		ActiveLines = Lines;
+	}
+
+	ModulationDepth = Modulation * FDN_MAX_MODULATION_MS * ReverbFormat.SampleRate / 1000.f;
+	ModulationStep = 2. * M_PI * ModulationRate / SampleRate;
+
+	/* Geometric spread of lengths, primes have no common echoes */
+	fr_i32 MaxDelay = LineLength - FDN_MAX_CHUNK - (fr_i32)ceilf(ModulationDepth) - 2;
+	for (fr_i32 i = 0; i < Lines; i++) {
+		fr_f32 Ratio = powf(FDN_SHORTEST_RATIO, (fr_f32)(Lines - 1 - i) / (Lines - 1));
+		fr_i32 Delay = std::max((fr_i32)(LongestDelay * Ratio), LastDelay + 1);
+		while (!IsPrimeNumber(Delay)) Delay++;
+		Delays[i] = std::min(Delay, MaxDelay);
+		LastDelay = Delay;
+	}
+
+	/* Read of modulated line must not reach frames of current chunk */
+	ChunkFrames = std::min(std::max(Delays[0] - (fr_i32)ceilf(ModulationDepth) - 2, 1), FDN_MAX_CHUNK);
+
+	/* 
+		Line decay is shelving filter with gain of 60 dB decay for line length
+		at DC and with shorter decay time at Nyquist. Matrix normalization is 
+		included to filter gain.
+	*/
+	for (fr_i32 i = 0; i < FDN_MAX_LINES; i++) {
+		BiquadLanes& GroupLanes = Lanes[i / FILTER_LANES];
+		fr_i32 Lane = i % FILTER_LANES;
+		fr_f64 LowGain = 0.;
+		fr_f64 HighGain = 0.;
+		if (i < Lines) {
+			LowGain = pow(10., -3. * Delays[i] / (DecayTime * SampleRate)) * MatrixScale;
+			HighGain = pow(10., -3. * Delays[i] / (HighDecayTime * SampleRate)) * MatrixScale;
+		}
+
+		GroupLanes.B0[Lane] = (fr_f32)((LowGain * (1. - Pole) + HighGain * (1. + Pole)) * 0.5);
+		GroupLanes.B1[Lane] = (fr_f32)((LowGain * (1. - Pole) - HighGain * (1. + Pole)) * 0.5);
+		GroupLanes.B2[Lane] = 0.f;
+		GroupLanes.A1[Lane] = (fr_f32)-Pole;
+		GroupLanes.A2[Lane] = 0.f;
+	}
+
+	/* Different sign patterns decorrelate output channels, filter gain is compensated */
+	fr_f32 TapGain = (fr_f32)(0.5 / MatrixScale);
+	for (fr_i32 i = 0; i < Lines; i++) {
+		OutputTaps[0][i] = ((i >> 1) & 1) ? -TapGain : TapGain;
+		OutputTaps[1][i] = (i & 1) ? -TapGain : TapGain;
+	}
+}
+
+void
+CFdnReverb::ReadLines(fr_i32 Frames)
+{
+	fr_f32 StartPhase = (fr_f32)ModulationPhase;
+	fr_f32 EndPhase = (fr_f32)(ModulationPhase + ModulationStep * Frames);
+
+	for (fr_i32 i = 0; i < ActiveLines; i++) {
+		fr_f32* pLine = LinesBuffer[i];
+		fr_f32* pChunk = ChunkBuffer[i];
+		fr_i32 ReadPosition = WritePosition - Delays[i];
+		if (ReadPosition < 0) ReadPosition += LineLength;
+
+		if (ModulationDepth <= 0.f) {
+			fr_i32 FirstPart = std::min(Frames, LineLength - ReadPosition);
+			memcpy(pChunk, pLine + ReadPosition, sizeof(fr_f32) * FirstPart);
+			memcpy(pChunk + FirstPart, pLine, sizeof(fr_f32) * (Frames - FirstPart));
+			continue;
+		}
+
+		/* Lines have shifted LFO phases, offset is linear inside chunk */
+		fr_f32 LineShift = 2.f * (fr_f32)M_PI * i / ActiveLines;
+		fr_f32 StartOffset = ModulationDepth * 0.5f * (1.f + sinf(StartPhase + LineShift));
+		fr_f32 EndOffset = ModulationDepth * 0.5f * (1.f + sinf(EndPhase + LineShift));
+		fr_f32 OffsetStep = (EndOffset - StartOffset) / Frames;
+		fr_f32 Position = (fr_f32)(ReadPosition + LineLength) - StartOffset;
+		for (fr_i32 j = 0; j < Frames; j++) {
+			fr_i32 First = (fr_i32)Position;
+			fr_f32 Fraction = Position - First;
+			while (First >= LineLength) First -= LineLength;
+			fr_i32 Second = First + 1 < LineLength ? First + 1 : 0;
+			pChunk[j] = pLine[First] + (pLine[Second] - pLine[First]) * Fraction;
+			Position += 1.f - OffsetStep;
+		}
+	}
+
+	ModulationPhase = fmod(ModulationPhase + ModulationStep * Frames, 2. * M_PI);
+}
+
+void
+CFdnReverb::WriteLines(fr_i32 Frames)
+{
+	fr_i32 FirstPart = std::min(Frames, LineLength - WritePosition);
+	for (fr_i32 i = 0; i < ActiveLines; i++) {
+		memcpy(LinesBuffer[i] + WritePosition, ChunkBuffer[i], sizeof(fr_f32) * FirstPart);
+		memcpy(LinesBuffer[i], ChunkBuffer[i] + FirstPart, sizeof(fr_f32) * (Frames - FirstPart));
+	}
+
+	WritePosition += Frames;
+	if (WritePosition >= LineLength) WritePosition -= LineLength;
+}
+
+void
+CFdnReverb::ProcessChunk(fr_f32** ppData, fr_i32 Position, fr_i32 Frames, fr_f32** ppWet)
+{
+	fr_f32** ppLines = ChunkBuffer.GetBuffers();
+	fr_f32 InputGain = 1.f / sqrtf((fr_f32)ActiveLines);
+
+	ReadLines(Frames);
+	for (fr_i32 Group = 0; Group < ActiveLines / FILTER_LANES; Group++) {
+		ProcessBiquadLanes(&Lanes[Group], &ppLines[Group * FILTER_LANES], Frames, FILTER_LANES);
+	}
+
+	/* Mono output takes the first taps pattern */
+	for (fr_i32 c = 0; c < ReverbFormat.Channels; c++) {
+		fr_f32* pTaps = OutputTaps[c & 1];
+		memset(ppWet[c], 0, sizeof(fr_f32) * Frames);
+		for (fr_i32 i = 0; i < ActiveLines; i++) {
+			MixerAddToBufferRamp(ppWet[c], ppLines[i], Frames, pTaps[i], pTaps[i]);
+		}
+	}
+
+	/* Fast Hadamard transform */
+	for (fr_i32 Half = 1; Half < ActiveLines; Half <<= 1) {
+		for (fr_i32 i = 0; i < ActiveLines; i += Half * 2) {
+			for (fr_i32 j = i; j < i + Half; j++) {
+				SumDifference(ppLines[j], ppLines[j + Half], Frames);
+			}
+		}
+	}
+
+	/* Input channels are distributed between lines */
+	for (fr_i32 i = 0; i < ActiveLines; i++) {
+		fr_f32 LineGain = (i / ReverbFormat.Channels) & 1 ? -InputGain : InputGain;
+		MixerAddToBufferRamp(ppLines[i], ppData[i % ReverbFormat.Channels] + Position, Frames, LineGain, LineGain);
+	}
+
+	WriteLines(Frames);
+
+	/* Offset with changing sign keeps decaying network away from denormals */
+	fr_f32 Offset = WritePosition & FDN_MAX_CHUNK ? FDN_DENORMAL_OFFSET : -FDN_DENORMAL_OFFSET;
+	for (fr_i32 Group = 0; Group < ActiveLines / FILTER_LANES; Group++) {
+		for (fr_i32 Lane = 0; Lane < FILTER_LANES; Lane++) {
+			Lanes[Group].Z1[Lane] += Offset;
+		}
+	}
+}
+
+bool
+CFdnReverb::Process(fr_f32** ppData, fr_i32 Frames)
+{
+	fr_f32* ppWet[MAX_CHANNELS] = {};
+	fr_i32 Position = 0;
+	fr_f32 DryTarget = DryGain;
+	fr_f32 WetTarget = WetGain;
+	if (!ReverbFormat.Channels || !LineLength || Frames <= 0) return false;
+	if (IsParametersChanged()) UpdateParameters();
+	if (!IsGainsValid) {
+		LastDryGain = DryTarget;
+		LastWetGain = WetTarget;
+		IsGainsValid = true;
+	}
+
+	for (fr_i32 c = 0; c < ReverbFormat.Channels; c++) {
+		ppWet[c] = WetBuffer.Data() + c * FDN_MAX_CHUNK;
+	}
+
+	while (Position < Frames) {
+		fr_i32 CurrentFrames = std::min(Frames - Position, ChunkFrames);
+		fr_f32 DryStart = LastDryGain + (DryTarget - LastDryGain) * Position / Frames;
+		fr_f32 DryEnd = LastDryGain + (DryTarget - LastDryGain) * (Position + CurrentFrames) / Frames;
+		fr_f32 WetStart = LastWetGain + (WetTarget - LastWetGain) * Position / Frames;
+		fr_f32 WetEnd = LastWetGain + (WetTarget - LastWetGain) * (Position + CurrentFrames) / Frames;
+		fr_f32 DryStep = (DryEnd - DryStart) / CurrentFrames;
+
+		ProcessChunk(ppData, Position, CurrentFrames, ppWet);
+		for (fr_i32 c = 0; c < ReverbFormat.Channels; c++) {
+			fr_f32* pData = ppData[c] + Position;
+			for (fr_i32 i = 0; i < CurrentFrames; i++) {
+				pData[i] *= DryStart + DryStep * i;
+			}
+
+			MixerAddToBufferRamp(pData, ppWet[c], CurrentFrames, WetStart, WetEnd);
+		}
+
+		Position += CurrentFrames;
+	}
+
+	LastDryGain = DryTarget;
+	LastWetGain = WetTarget;
+	return true;
+}
+
+bool
+CFdnReverb::GetEffectCategory(fr_i32& EffectCategory)
+{
+	EffectCategory = CategoryRoomFx;
+	return true;
+}
+
+bool
+CFdnReverb::GetEffectType(fr_i32& EffectType)
+{
+	EffectType = SoundEffectType;
+	return true;
+}
+
+bool
+CFdnReverb::GetPluginName(fr_string64& DescriptionString)
+{
+	strcpy(DescriptionString, "FDN Reverb");
+	return true;
+}
+
+bool
+CFdnReverb::GetPluginVendor(fr_string64& DescriptionString)
+{
+	strcpy(DescriptionString, "Fresponze");
+	return true;
+}
+
+bool
+CFdnReverb::GetPluginDescription(fr_string256& DescriptionString)
+{
+	strcpy(DescriptionString, "Feedback delay network reverb with modulated and damped lines");
+	return true;
+}
+
+bool
+CFdnReverb::GetVariablesCount(fr_i32& CountOfVariables)
+{
+	CountOfVariables = eFdnParametersCount;
+	return true;
+}
+
+bool
+CFdnReverb::GetVariableDescription(fr_i32 VariableIndex, fr_string128& DescriptionString)
+{
+	switch (VariableIndex)
+	{
+	case eFdnRoomSizeParameter: strcpy(DescriptionString, "Room size"); break;
+	case eFdnDecayTimeParameter: strcpy(DescriptionString, "Decay time (seconds)"); break;
+	case eFdnDampingParameter: strcpy(DescriptionString, "High frequencies damping"); break;
+	case eFdnModulationParameter: strcpy(DescriptionString, "Modulation depth"); break;
+	case eFdnModulationRateParameter: strcpy(DescriptionString, "Modulation rate (Hz)"); break;
+	case eFdnLinesParameter: strcpy(DescriptionString, "Delay lines count (8 or 16)"); break;
+	case eFdnDryParameter: strcpy(DescriptionString, "Dry signal gain"); break;
+	case eFdnWetParameter: strcpy(DescriptionString, "Reverberated signal gain"); break;
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+bool
+CFdnReverb::GetVariableKnob(fr_i32 VariableIndex, fr_i32& KnobType)
+{
+	if (VariableIndex < 0 || VariableIndex >= eFdnParametersCount) return false;
+	KnobType = VariableIndex == eFdnLinesParameter ? LineKnob : CircleKnob;
+	return true;
+}
+
+void
+CFdnReverb::SetOption(fr_i32 Option, fr_f32* pData, fr_i32 DataSize)
+{
+	if (!pData || DataSize != sizeof(fr_f32)) return;
+
+	switch (Option)
+	{
+	case eFdnRoomSizeParameter: RoomSize = std::min(std::max(*pData, 0.f), 1.f); break;
+	case eFdnDecayTimeParameter: DecayTime = std::min(std::max(*pData, 0.05f), FDN_MAX_DECAY_TIME); break;
+	case eFdnDampingParameter: Damping = std::min(std::max(*pData, 0.f), 1.f); break;
+	case eFdnModulationParameter: Modulation = std::min(std::max(*pData, 0.f), 1.f); break;
+	case eFdnModulationRateParameter: ModulationRate = std::min(std::max(*pData, 0.f), 10.f); break;
+	case eFdnLinesParameter: LinesCount = *pData > (FDN_MIN_LINES + FDN_MAX_LINES) * 0.5f ? FDN_MAX_LINES : FDN_MIN_LINES; break;
+	case eFdnDryParameter: DryGain = std::max(*pData, 0.f); return;
+	case eFdnWetParameter: WetGain = std::max(*pData, 0.f); return;
+	default:
+		return;
+	}
+
+	OnParametersChanged();
+}
+
+void
+CFdnReverb::GetOption(fr_i32 Option, fr_f32* pData, fr_i32 DataSize)
+{
+	if (!pData || DataSize != sizeof(fr_f32)) return;
+
+	switch (Option)
+	{
+	case eFdnRoomSizeParameter: *pData = RoomSize; break;
+	case eFdnDecayTimeParameter: *pData = DecayTime; break;
+	case eFdnDampingParameter: *pData = Damping; break;
+	case eFdnModulationParameter: *pData = Modulation; break;
+	case eFdnModulationRateParameter: *pData = ModulationRate; break;
+	case eFdnLinesParameter: *pData = (fr_f32)LinesCount; break;
+	case eFdnDryParameter: *pData = DryGain; break;
+	case eFdnWetParameter: *pData = WetGain; break;
+	default:
+		break;
+	}
+}
+
+void
+CFdnReverb::SetFormat(PcmFormat* pFormat)
+{
+	if (!pFormat || !pFormat->Channels || pFormat->Channels > MAX_CHANNELS || pFormat->SampleRate <= 0) return;
+
+	ReverbFormat = *pFormat;
+	AllocateState();
+}
+
+void
+CFdnReverb::GetFormat(PcmFormat* pFormat)
+{
+	*pFormat = ReverbFormat;
+}
+
+fr_i32
+CFdnReverb::GetTailLength()
+{
+	if (!ReverbFormat.SampleRate) return 0;
+	return (fr_i32)(DecayTime * ReverbFormat.SampleRate) + (ActiveLines ? Delays[ActiveLines - 1] : 0);
+}
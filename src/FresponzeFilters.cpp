@@ -0,0 +1,491 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2019-2020. All rights reserved.
+* Copyright (C) Suirless, 2020. All rights reserved.
+* Fresponze - fast, simple and modern multimedia sound library
+* Apache-2 License
+**********************************************************************
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*****************************************************************/
+#include "FresponzeFilters.h"
+
+/* Lower values are flushed to zero, so silent tail doesn't produce denormals */
+#define FILTER_DENORMAL_LEVEL 1e-15f
+
+IBaseEffect*
+GetBiquadFilter()
+{
+	return new CBiquadFilterEffect;
+}
+
+IBaseEffect*
+GetSvfFilter()
+{
+	return new CSvfFilterEffect;
+}
+
+inline
+void
+FlushDenormals(fr_f32* pData, fr_i32 Count)
+{
+	for (fr_i32 i = 0; i < Count; i++) {
+		if (fabsf(pData[i]) < FILTER_DENORMAL_LEVEL) pData[i] = 0.f;
+	}
+}
+
+/* Base filter code (lanes layout, format, section parameters) */
+bool
+CBaseFilterEffect::GetEffectCategory(fr_i32& EffectCategory)
+{
+	EffectCategory = CategoryEffect;
+	return true;
+}
+
+bool
+CBaseFilterEffect::GetEffectType(fr_i32& EffectType)
+{
+	EffectType = SoundEffectType;
+	return true;
+}
+
+bool
+CBaseFilterEffect::GetPluginName(fr_string64& DescriptionString)
+{
+	strcpy(DescriptionString, FilterName);
+	return true;
+}
+
+bool
+CBaseFilterEffect::GetPluginVendor(fr_string64& DescriptionString)
+{
+	strcpy(DescriptionString, "Fresponze");
+	return true;
+}
+
+bool
+CBaseFilterEffect::GetPluginDescription(fr_string256& DescriptionString)
+{
+	strcpy(DescriptionString, FilterDescription);
+	return true;
+}
+
+void
+CBaseFilterEffect::SetFormat(PcmFormat* pFormat)
+{
+	if (!pFormat || !pFormat->Channels || pFormat->Channels > MAX_CHANNELS) return;
+
+	FilterFormat = *pFormat;
+	LaneChannels = FilterFormat.Channels == 1 ? 1 : (FilterFormat.Channels == 2 ? 2 : FILTER_LANES);
+	ChannelGroups = (FilterFormat.Channels + LaneChannels - 1) / LaneChannels;
+	SectionsPerLanes = FILTER_LANES / LaneChannels;
+	AppliedVersion = -1;
+	ResetState();
+}
+
+void
+CBaseFilterEffect::GetFormat(PcmFormat* pFormat)
+{
+	*pFormat = FilterFormat;
+}
+
+bool
+CBaseFilterEffect::IsParametersChanged()
+{
+	fr_i32 Version = ParametersVersion.load(std::memory_order_acquire);
+	if (Version == AppliedVersion) return false;
+
+	AppliedVersion = Version;
+	return true;
+}
+
+void
+CBaseFilterEffect::GetGroupChannels(fr_f32** ppData, fr_i32 Group, fr_i32 Frames, fr_f32** ppGroupData)
+{
+	for (fr_i32 i = 0; i < LaneChannels; i++) {
+		fr_i32 Channel = Group * LaneChannels + i;
+		if (Channel < FilterFormat.Channels) {
+			ppGroupData[i] = ppData[Channel];
+			continue;
+		}
+
+		/* Padding lanes filter silence, so buffer stays silent */
+		if (PaddingBuffer.Size() < Frames) {
+			PaddingBuffer.Resize(Frames);
+			PaddingBuffer.Clear();
+		}
+
+		ppGroupData[i] = PaddingBuffer.Data();
+	}
+}
+
+bool
+CBaseFilterEffect::SetSectionOption(FilterSection& Section, fr_i32 Option, fr_f32 Value)
+{
+	switch (Option)
+	{
+	case eFilterTypeParameter:		Section.Type = std::clamp(floorf(Value), 0.f, (fr_f32)(eFilterTypesCount - 1)); break;
+	case eFilterFrequencyParameter:	Section.Frequency = std::max(Value, FILTER_MIN_FREQUENCY); break;
+	case eFilterQParameter:			Section.Q = std::max(Value, 0.01f); break;
+	case eFilterGainParameter:		Section.Gain = Value; break;
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+bool
+CBaseFilterEffect::GetSectionOption(FilterSection& Section, fr_i32 Option, fr_f32& Value)
+{
+	switch (Option)
+	{
+	case eFilterTypeParameter:		Value = Section.Type; break;
+	case eFilterFrequencyParameter:	Value = Section.Frequency; break;
+	case eFilterQParameter:			Value = Section.Q; break;
+	case eFilterGainParameter:		Value = Section.Gain; break;
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+void
+CBaseFilterEffect::GetSectionDescription(fr_i32 Option, fr_string128& DescriptionString)
+{
+	static const char* SectionDescriptions[eFilterParametersCount] = {
+		"Filter type (see EFilterType)",
+		"Cutoff or center frequency in Hz",
+		"Quality factor",
+		"Gain in dB for peak and shelf filters"
+	};
+
+	strcpy(DescriptionString, SectionDescriptions[Option]);
+}
+
+/* Biquad coefficients by RBJ Audio EQ Cookbook */
+static
+void
+GetBiquadCoefficients(FilterSection& Section, fr_f64 SampleRate, fr_f64* pCoefficients)
+{
+	fr_f64 Frequency = std::min((fr_f64)Section.Frequency, SampleRate * 0.49);
+	fr_f64 Omega = 2. * M_PI * Frequency / SampleRate;
+	fr_f64 Cos = cos(Omega);
+	fr_f64 Alpha = sin(Omega) / (2. * Section.Q);
+	fr_f64 A = pow(10., Section.Gain / 40.);
+	fr_f64 SqrtA2Alpha = 2. * sqrt(A) * Alpha;
+	fr_f64 B0 = 1., B1 = 0., B2 = 0., A0 = 1., A1 = 0., A2 = 0.;
+
+	switch ((fr_i32)Section.Type)
+	{
+	case eLowPassFilter:
+		B0 = (1. - Cos) / 2.; B1 = 1. - Cos; B2 = B0;
+		A0 = 1. + Alpha; A1 = -2. * Cos; A2 = 1. - Alpha;
+		break;
+	case eHighPassFilter:
+		B0 = (1. + Cos) / 2.; B1 = -(1. + Cos); B2 = B0;
+		A0 = 1. + Alpha; A1 = -2. * Cos; A2 = 1. - Alpha;
+		break;
+	case eBandPassFilter:
+		B0 = Alpha; B1 = 0.; B2 = -Alpha;
+		A0 = 1. + Alpha; A1 = -2. * Cos; A2 = 1. - Alpha;
+		break;
+	case eNotchFilter:
+		B0 = 1.; B1 = -2. * Cos; B2 = 1.;
+		A0 = 1. + Alpha; A1 = -2. * Cos; A2 = 1. - Alpha;
+		break;
+	case ePeakFilter:
+		B0 = 1. + Alpha * A; B1 = -2. * Cos; B2 = 1. - Alpha * A;
+		A0 = 1. + Alpha / A; A1 = -2. * Cos; A2 = 1. - Alpha / A;
+		break;
+	case eLowShelfFilter:
+		B0 = A * ((A + 1.) - (A - 1.) * Cos + SqrtA2Alpha);
+		B1 = 2. * A * ((A - 1.) - (A + 1.) * Cos);
+		B2 = A * ((A + 1.) - (A - 1.) * Cos - SqrtA2Alpha);
+		A0 = (A + 1.) + (A - 1.) * Cos + SqrtA2Alpha;
+		A1 = -2. * ((A - 1.) + (A + 1.) * Cos);
+		A2 = (A + 1.) + (A - 1.) * Cos - SqrtA2Alpha;
+		break;
+	case eHighShelfFilter:
+		B0 = A * ((A + 1.) + (A - 1.) * Cos + SqrtA2Alpha);
+		B1 = -2. * A * ((A - 1.) + (A + 1.) * Cos);
+		B2 = A * ((A + 1.) + (A - 1.) * Cos - SqrtA2Alpha);
+		A0 = (A + 1.) - (A - 1.) * Cos + SqrtA2Alpha;
+		A1 = 2. * ((A - 1.) - (A + 1.) * Cos);
+		A2 = (A + 1.) - (A - 1.) * Cos - SqrtA2Alpha;
+		break;
+	default:
+		break;
+	}
+
+	pCoefficients[0] = B0 / A0;
+	pCoefficients[1] = B1 / A0;
+	pCoefficients[2] = B2 / A0;
+	pCoefficients[3] = A1 / A0;
+	pCoefficients[4] = A2 / A0;
+}
+
+/* Biquad cascade code */
+CBiquadFilterEffect::CBiquadFilterEffect()
+{
+	AddRef();
+	FilterName = "Biquad Filter";
+	FilterDescription = "Cascade of biquad filters: low-pass, high-pass, band-pass, notch, peak and shelves";
+}
+
+void
+CBiquadFilterEffect::ResetState()
+{
+	memset(Lanes, 0, sizeof(Lanes));
+}
+
+void
+CBiquadFilterEffect::UpdateCoefficients()
+{
+	fr_i32 SectionGroups = (SectionsCount + SectionsPerLanes - 1) / SectionsPerLanes;
+
+	/* New sections must not continue old state */
+	if (SectionsCount != AppliedSectionsCount) {
+		ResetState();
+		AppliedSectionsCount = SectionsCount;
+	}
+
+	for (fr_i32 Section = 0; Section < SectionGroups * SectionsPerLanes; Section++) {
+		fr_f64 Coefficients[5] = { 1., 0., 0., 0., 0. };
+		fr_i32 SectionGroup = Section / SectionsPerLanes;
+		fr_i32 FirstLane = (Section % SectionsPerLanes) * LaneChannels;
+
+		/* Unused sections of the last group just pass signal */
+		if (Section < SectionsCount) GetBiquadCoefficients(Sections[Section], (fr_f64)FilterFormat.SampleRate, Coefficients);
+		for (fr_i32 Group = 0; Group < ChannelGroups; Group++) {
+			BiquadLanes& GroupLanes = Lanes[Group * MAX_FILTER_SECTIONS + SectionGroup];
+			for (fr_i32 Lane = FirstLane; Lane < FirstLane + LaneChannels; Lane++) {
+				GroupLanes.B0[Lane] = (fr_f32)Coefficients[0];
+				GroupLanes.B1[Lane] = (fr_f32)Coefficients[1];
+				GroupLanes.B2[Lane] = (fr_f32)Coefficients[2];
+				GroupLanes.A1[Lane] = (fr_f32)Coefficients[3];
+				GroupLanes.A2[Lane] = (fr_f32)Coefficients[4];
+			}
+		}
+	}
+}
+
+bool
+CBiquadFilterEffect::Process(fr_f32** ppData, fr_i32 Frames)
+{
+	fr_f32* ppGroupData[FILTER_LANES] = {};
+	if (!LaneChannels || !SectionsCount) return false;
+	if (IsParametersChanged()) UpdateCoefficients();
+
+	fr_i32 SectionGroups = (SectionsCount + SectionsPerLanes - 1) / SectionsPerLanes;
+	for (fr_i32 Group = 0; Group < ChannelGroups; Group++) {
+		GetGroupChannels(ppData, Group, Frames, ppGroupData);
+		for (fr_i32 SectionGroup = 0; SectionGroup < SectionGroups; SectionGroup++) {
+			BiquadLanes& GroupLanes = Lanes[Group * MAX_FILTER_SECTIONS + SectionGroup];
+			ProcessBiquadLanes(&GroupLanes, ppGroupData, Frames, LaneChannels);
+			FlushDenormals(GroupLanes.Z1, FILTER_LANES * 2);
+		}
+	}
+
+	return true;
+}
+
+bool
+CBiquadFilterEffect::GetVariablesCount(fr_i32& CountOfVariables)
+{
+	CountOfVariables = BIQUAD_SECTIONS_OPTION + 1;
+	return true;
+}
+
+bool
+CBiquadFilterEffect::GetVariableDescription(fr_i32 VariableIndex, fr_string128& DescriptionString)
+{
+	if (VariableIndex < 0 || VariableIndex > BIQUAD_SECTIONS_OPTION) return false;
+	if (VariableIndex == BIQUAD_SECTIONS_OPTION) strcpy(DescriptionString, "Count of active sections");
+	else GetSectionDescription(VariableIndex % eFilterParametersCount, DescriptionString);
+	return true;
+}
+
+bool
+CBiquadFilterEffect::GetVariableKnob(fr_i32 VariableIndex, fr_i32& KnobType)
+{
+	if (VariableIndex < 0 || VariableIndex > BIQUAD_SECTIONS_OPTION) return false;
+	KnobType = (VariableIndex == BIQUAD_SECTIONS_OPTION || VariableIndex % eFilterParametersCount == eFilterTypeParameter) ? LineKnob : CircleKnob;
+	return true;
+}
+
+void
+CBiquadFilterEffect::SetOption(fr_i32 Option, fr_f32* pData, fr_i32 DataSize)
+{
+	if (!pData || DataSize != sizeof(fr_f32)) return;
+	if (Option < 0 || Option > BIQUAD_SECTIONS_OPTION) return;
+
+	if (Option == BIQUAD_SECTIONS_OPTION) {
+		SectionsCount = std::clamp((fr_i32)*pData, 1, MAX_FILTER_SECTIONS);
+	} else if (!SetSectionOption(Sections[Option / eFilterParametersCount], Option % eFilterParametersCount, *pData)) {
+		return;
+	}
+
+	OnParametersChanged();
+}
+
+void
+CBiquadFilterEffect::GetOption(fr_i32 Option, fr_f32* pData, fr_i32 DataSize)
+{
+	if (!pData || DataSize != sizeof(fr_f32)) return;
+	if (Option < 0 || Option > BIQUAD_SECTIONS_OPTION) return;
+
+	if (Option == BIQUAD_SECTIONS_OPTION) *pData = (fr_f32)SectionsCount;
+	else GetSectionOption(Sections[Option / eFilterParametersCount], Option % eFilterParametersCount, *pData);
+}
+
+/* State variable filter code (Andrew Simper, "Linear trapezoidal integrated SVF") */
+CSvfFilterEffect::CSvfFilterEffect()
+{
+	AddRef();
+	FilterName = "State Variable Filter";
+	FilterDescription = "Trapezoidal state variable filter: low-pass, high-pass, band-pass, notch, peak and shelves";
+}
+
+void
+CSvfFilterEffect::ResetState()
+{
+	memset(Lanes, 0, sizeof(Lanes));
+}
+
+void
+CSvfFilterEffect::UpdateCoefficients()
+{
+	fr_f64 SampleRate = (fr_f64)FilterFormat.SampleRate;
+	fr_f64 Frequency = std::min((fr_f64)Section.Frequency, SampleRate * 0.49);
+	fr_f64 G = tan(M_PI * Frequency / SampleRate);
+	fr_f64 K = 1. / Section.Q;
+	fr_f64 A = pow(10., Section.Gain / 40.);
+	fr_f64 M0 = 0., M1 = 0., M2 = 0.;
+	fr_i32 StageGroups = (StagesCount + SectionsPerLanes - 1) / SectionsPerLanes;
+
+	if (StagesCount != AppliedStagesCount) {
+		ResetState();
+		AppliedStagesCount = StagesCount;
+	}
+
+	switch ((fr_i32)Section.Type)
+	{
+	case eLowPassFilter:	M2 = 1.; break;
+	case eHighPassFilter:	M0 = 1.; M1 = -K; M2 = -1.; break;
+	case eBandPassFilter:	M1 = 1.; break;
+	case eNotchFilter:		M0 = 1.; M1 = -K; break;
+	case ePeakFilter:
+		K = 1. / (Section.Q * A);
+		M0 = 1.; M1 = K * (A * A - 1.);
+		break;
+	case eLowShelfFilter:
+		G /= sqrt(A);
+		M0 = 1.; M1 = K * (A - 1.); M2 = A * A - 1.;
+		break;
+	case eHighShelfFilter:
+		G *= sqrt(A);
+		M0 = A * A; M1 = K * (1. - A) * A; M2 = 1. - A * A;
+		break;
+	default:
+		break;
+	}
+
+	fr_f64 A1 = 1. / (1. + G * (G + K));
+	fr_f64 A2 = G * A1;
+	fr_f64 A3 = G * A2;
+	for (fr_i32 Stage = 0; Stage < StageGroups * SectionsPerLanes; Stage++) {
+		fr_i32 FirstLane = (Stage % SectionsPerLanes) * LaneChannels;
+		bool IsUsed = Stage < StagesCount;
+		for (fr_i32 Group = 0; Group < ChannelGroups; Group++) {
+			SvfLanes& GroupLanes = Lanes[Group * MAX_FILTER_SECTIONS + Stage / SectionsPerLanes];
+			for (fr_i32 Lane = FirstLane; Lane < FirstLane + LaneChannels; Lane++) {
+				/* Unused stages of the last group just pass signal */
+				GroupLanes.A1[Lane] = IsUsed ? (fr_f32)A1 : 0.f;
+				GroupLanes.A2[Lane] = IsUsed ? (fr_f32)A2 : 0.f;
+				GroupLanes.A3[Lane] = IsUsed ? (fr_f32)A3 : 0.f;
+				GroupLanes.M0[Lane] = IsUsed ? (fr_f32)M0 : 1.f;
+				GroupLanes.M1[Lane] = IsUsed ? (fr_f32)M1 : 0.f;
+				GroupLanes.M2[Lane] = IsUsed ? (fr_f32)M2 : 0.f;
+			}
+		}
+	}
+}
+
+bool
+CSvfFilterEffect::Process(fr_f32** ppData, fr_i32 Frames)
+{
+	fr_f32* ppGroupData[FILTER_LANES] = {};
+	if (!LaneChannels) return false;
+	if (IsParametersChanged()) UpdateCoefficients();
+
+	fr_i32 StageGroups = (StagesCount + SectionsPerLanes - 1) / SectionsPerLanes;
+	for (fr_i32 Group = 0; Group < ChannelGroups; Group++) {
+		GetGroupChannels(ppData, Group, Frames, ppGroupData);
+		for (fr_i32 StageGroup = 0; StageGroup < StageGroups; StageGroup++) {
+			SvfLanes& GroupLanes = Lanes[Group * MAX_FILTER_SECTIONS + StageGroup];
+			ProcessSvfLanes(&GroupLanes, ppGroupData, Frames, LaneChannels);
+			FlushDenormals(GroupLanes.Ic1, FILTER_LANES * 2);
+		}
+	}
+
+	return true;
+}
+
+bool
+CSvfFilterEffect::GetVariablesCount(fr_i32& CountOfVariables)
+{
+	CountOfVariables = SVF_STAGES_OPTION + 1;
+	return true;
+}
+
+bool
+CSvfFilterEffect::GetVariableDescription(fr_i32 VariableIndex, fr_string128& DescriptionString)
+{
+	if (VariableIndex < 0 || VariableIndex > SVF_STAGES_OPTION) return false;
+	if (VariableIndex == SVF_STAGES_OPTION) strcpy(DescriptionString, "Count of stages, 12 dB/oct each");
+	else GetSectionDescription(VariableIndex, DescriptionString);
+	return true;
+}
+
+bool
+CSvfFilterEffect::GetVariableKnob(fr_i32 VariableIndex, fr_i32& KnobType)
+{
+	if (VariableIndex < 0 || VariableIndex > SVF_STAGES_OPTION) return false;
+	KnobType = (VariableIndex == SVF_STAGES_OPTION || VariableIndex == eFilterTypeParameter) ? LineKnob : CircleKnob;
+	return true;
+}
+
+void
+CSvfFilterEffect::SetOption(fr_i32 Option, fr_f32* pData, fr_i32 DataSize)
+{
+	if (!pData || DataSize != sizeof(fr_f32)) return;
+	if (Option < 0 || Option > SVF_STAGES_OPTION) return;
+
+	if (Option == SVF_STAGES_OPTION) {
+		StagesCount = std::clamp((fr_i32)*pData, 1, MAX_SVF_STAGES);
+	} else if (!SetSectionOption(Section, Option, *pData)) {
+		return;
+	}
+
+	OnParametersChanged();
+}
+
+void
+CSvfFilterEffect::GetOption(fr_i32 Option, fr_f32* pData, fr_i32 DataSize)
+{
+	if (!pData || DataSize != sizeof(fr_f32)) return;
+	if (Option < 0 || Option > SVF_STAGES_OPTION) return;
+
+	if (Option == SVF_STAGES_OPTION) *pData = (fr_f32)StagesCount;
+	else GetSectionOption(Section, Option, *pData);
+}
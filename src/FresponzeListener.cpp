@@ -20,80 +20,30 @@
 CMediaListener::CMediaListener(IMediaResource* pInitialResource)
 {
 	AddRef();
-	pInitialResource->Clone((void**)&pLocalResource);
-	pLocalResource->GetFormat(ResourceFormat);
-	ListenerFormat = ResourceFormat;
+	SetResource(pInitialResource);
 }
 
 CMediaListener::~CMediaListener()
 {
+	_RELEASE(pCursor);
 	_RELEASE(pLocalResource);
-	FreeStuff();
-}
-
-void
-CMediaListener::FreeStuff()
-{
-	EmittersNode* pNode = pFirstEmitter;
-	EmittersNode* pThisNode = nullptr;
-	while (pNode) {
-		pThisNode = pNode->pNext;
-		_RELEASE(pNode->pEmitter);
-		delete pNode;
-		pNode = pThisNode;
-	}
-}
-
-bool
-CMediaListener::AddEmitter(IBaseEmitter* pNewEmitter)
-{
-	if (!pLastEmitter) {
-		pFirstEmitter = new EmittersNode;
-		memset(pFirstEmitter, 0, sizeof(EmittersNode));
-		pLastEmitter = pFirstEmitter;
-		pNewEmitter->Clone((void**)&pLastEmitter->pEmitter);
-	} else {
-		EmittersNode* pTemp = new EmittersNode;
-		memset(pFirstEmitter, 0, sizeof(EmittersNode));
-		pNewEmitter->Clone((void**)&pTemp->pEmitter);
-		pLastEmitter->pNext = pTemp;
-		pTemp->pPrev = pLastEmitter;
-		pLastEmitter = pTemp;
-	}
-
-	return true;
-}
-
-bool 
-CMediaListener::DeleteEmitter(IBaseEmitter* pEmitter)
-{
-	EmittersNode* pNode = nullptr;
-	GetFirstEmitter(&pNode);
-	while (pNode) {
-		if (pNode->pEmitter == pEmitter) {
-			pNode->pPrev->pNext = pNode->pNext;
-			pNode->pNext->pPrev = pNode->pPrev;
-			_RELEASE(pNode->pEmitter);
-			delete pNode;
-			return true;
-		}
-	}
-
-	return false;
-}
-
-bool 
-CMediaListener::GetFirstEmitter(EmittersNode** pFirstEmitter)
-{
-	*pFirstEmitter = this->pFirstEmitter;
-	return true;
 }
 
 bool	
 CMediaListener::SetResource(IMediaResource* pInitialResource)
 {
+	_RELEASE(pCursor);
 	_RELEASE(pLocalResource);
-	return pInitialResource->Clone((void**)&pLocalResource);
+	if (!pInitialResource->Clone((void**)&pLocalResource)) return false;
+
+	/* New resource keeps listener format, if it was set before */
+	pLocalResource->GetFormat(ResourceFormat);
+	if (!ListenerFormat.SampleRate) ListenerFormat = ResourceFormat;
+	ResetCache();
+	if (!pLocalResource->CreateCursor(pCursor)) return false;
+
+	pCursor->SetFormat(ListenerFormat);
+	return true;
 }
 
 fr_i32	
@@ -105,19 +55,15 @@ CMediaListener::SetPosition(fr_f32 FloatPosition)
 fr_i32	
 CMediaListener::SetPosition(fr_i64 FramePosition)
 {
-	fr_i64 outputFrames = 0;
-	CalculateFrames64(FramePosition, ListenerFormat.SampleRate, ResourceFormat.SampleRate, outputFrames);
-	fr_i32 ret = pLocalResource->SetPosition(outputFrames);
-	CalculateFrames64(ret, ResourceFormat.SampleRate, ListenerFormat.SampleRate, outputFrames);
-	return outputFrames;
+	/* Resource is sought only on cache miss */
+	framesPos = std::max(std::min(FramePosition, (fr_i64)GetFullFrames()), (fr_i64)0);
+	return (fr_i32)framesPos;
 }
 
 fr_i64
 CMediaListener::GetPosition()
 {
-	fr_i64 outputFrames = pLocalResource->GetPosition();
-	CalculateFrames64(outputFrames, ResourceFormat.SampleRate, ListenerFormat.SampleRate, outputFrames);
-	return outputFrames;
+	return framesPos;
 }
 
 fr_i32 
@@ -128,6 +74,13 @@ CMediaListener::GetFullFrames()
 	return (fr_i32)outputFrames;
 }
 
+fr_i32
+CMediaListener::GetDelay()
+{
+	if (!pCursor) return 0;
+	return pCursor->GetDelay();
+}
+
 fr_i32	
 CMediaListener::GetFormat(PcmFormat& fmt)
 {
@@ -138,22 +91,84 @@ CMediaListener::GetFormat(PcmFormat& fmt)
 fr_i32
 CMediaListener::SetFormat(PcmFormat fmt)
 {
-	EmittersNode* pProcessEmitter = pFirstEmitter;
 	ListenerFormat = fmt;
-	pLocalResource->SetFormat(ListenerFormat);
+	if (pCursor) pCursor->SetFormat(ListenerFormat);
 	pLocalResource->GetFormat(ResourceFormat);
-	while (pProcessEmitter) {
-		pProcessEmitter->pEmitter->SetFormat(&ListenerFormat);
-		pProcessEmitter = pProcessEmitter->pNext;
-	}
+	ResetCache();
 	return 0;
 }
 
+void
+CMediaListener::ResetCache()
+{
+	for (auto& Block : CacheBlocks) {
+		Block.BlockIndex = -1;
+		Block.LastUse = 0;
+		Block.FramesCount = 0;
+		Block.IsEnd = false;
+	}
+
+	/* Block is equal to mix block, so resource never reads more than it expects */
+	CacheBlockFrames = ListenerFormat.Frames > 0 ? ListenerFormat.Frames : LISTENER_CACHE_DEFAULT_FRAMES;
+	CacheUseCounter = 0;
+}
+
+ListenerCacheBlock*
+CMediaListener::GetCacheBlock(fr_i64 BlockIndex)
+{
+	ListenerCacheBlock* pOldestBlock = &CacheBlocks[0];
+	for (auto& Block : CacheBlocks) {
+		if (Block.BlockIndex == BlockIndex) {
+			Block.LastUse = ++CacheUseCounter;
+			return &Block;
+		}
+
+		if (Block.LastUse < pOldestBlock->LastUse) pOldestBlock = &Block;
+	}
+
+	/* Cursor seeks only if block doesn't follow the last decoded one, so resampler state stays valid */
+	pOldestBlock->Data.Resize(ListenerFormat.Channels, CacheBlockFrames);
+	pOldestBlock->FramesCount = 0;
+	pOldestBlock->IsEnd = !pCursor;
+	while (!pOldestBlock->IsEnd && pOldestBlock->FramesCount < CacheBlockFrames) {
+		fr_f32* ppBlockData[MAX_CHANNELS] = {};
+		for (fr_i32 i = 0; i < ListenerFormat.Channels; i++) {
+			ppBlockData[i] = &pOldestBlock->Data.GetBufferData(i)[pOldestBlock->FramesCount];
+		}
+
+		fr_i32 FramesToRead = CacheBlockFrames - pOldestBlock->FramesCount;
+		fr_i32 ReadedFrames = (fr_i32)pCursor->ReadAt(BlockIndex * CacheBlockFrames + pOldestBlock->FramesCount, FramesToRead, ppBlockData, &pOldestBlock->IsEnd);
+
+		/* Cursor without progress and without end gives silence, it's not the end of resource */
+		if (ReadedFrames <= 0 && !pOldestBlock->IsEnd) ReadedFrames = FramesToRead;
+		pOldestBlock->FramesCount += ReadedFrames;
+	}
+
+	pOldestBlock->BlockIndex = BlockIndex;
+	pOldestBlock->LastUse = ++CacheUseCounter;
+	return pOldestBlock;
+}
+
 fr_i32	
 CMediaListener::Process(fr_f32** ppOutputFloatData, fr_i32 frames)
 {
 	fr_i32 inFrames = 0;
-	inFrames = (fr_i32)pLocalResource->Read(frames, ppOutputFloatData);
-	framesPos = pLocalResource->GetPosition();
+	while (inFrames < frames) {
+		fr_i64 BlockIndex = framesPos / CacheBlockFrames;
+		fr_i32 BlockOffset = (fr_i32)(framesPos - BlockIndex * CacheBlockFrames);
+		ListenerCacheBlock* pBlock = GetCacheBlock(BlockIndex);
+
+		/* Only the last block of resource can be shorter than cache block */
+		if (BlockOffset >= pBlock->FramesCount) break;
+
+		fr_i32 FramesToCopy = std::min(frames - inFrames, pBlock->FramesCount - BlockOffset);
+		for (fr_i32 i = 0; i < ListenerFormat.Channels; i++) {
+			memcpy(&ppOutputFloatData[i][inFrames], &pBlock->Data.GetBufferData(i)[BlockOffset], FramesToCopy * sizeof(fr_f32));
+		}
+
+		inFrames += FramesToCopy;
+		framesPos += FramesToCopy;
+	}
+
 	return inFrames;
 }
@@ -173,6 +173,11 @@ void
 CSteamAudioEmitter::SetListener(void* pListener) 
 {
 	IMediaListener* pMediaListener = (IMediaListener*)pListener;
+	IMediaListener* pOldListener = (IMediaListener*)pParentListener;
+	pParentListener = nullptr;
+	_RELEASE(pOldListener);
+	if (!pMediaListener) return;
+
 	pMediaListener->Clone(&pParentListener);
 	pMediaListener->GetFormat(outputFormat);
 	Create();
@@ -307,7 +312,7 @@ CSteamAudioEmitter::Process(fr_f32** ppData, fr_i32 Frames)
 	fr_i32 FramesReaded = 0;
 	IMediaListener* ThisListener = (IMediaListener*)pParentListener;
 
-	if (EmittersState == eStopState || EmittersState == ePauseState) return false;
+	if (EmittersState == eStopState || EmittersState == ePauseState) return ProcessTail(ppData, Frames);
 
 	BaseEmitterPosition = (fr_i32)GetPosition();
 	BaseListenerPosition = (fr_i32)ThisListener->GetPosition();
@@ -351,6 +356,7 @@ CSteamAudioEmitter::Process(fr_f32** ppData, fr_i32 Frames)
 		pEffectToProcess = pEffectToProcess->pNext;
 	}
 
+	TailFramesLeft = GetEffectsTailLength();
 	SetPosition(BaseEmitterPosition);
 	ThisListener->SetPosition((fr_i64)BaseListenerPosition);
 	return true;
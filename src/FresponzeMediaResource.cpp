@@ -0,0 +1,145 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2019-2020. All rights reserved.
+* Copyright (C) Suirless, 2020. All rights reserved.
+* Fresponze - fast, simple and modern multimedia sound library
+* Apache-2 License
+**********************************************************************
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*****************************************************************/
+#include "FresponzeMediaResource.h"
+
+CBaseMediaCursor::~CBaseMediaCursor()
+{
+	if (resampler) delete resampler;
+}
+
+void
+CBaseMediaCursor::GetFormat(PcmFormat& format)
+{
+	format = fileFormat;
+}
+
+void
+CBaseMediaCursor::SetFormat(PcmFormat outputFormat)
+{
+	this->outputFormat = outputFormat;
+	if (outputFormat.SampleRate != fileFormat.SampleRate) {
+		/* Resampler is created for the longest decoded block, so reads don't reallocate it */
+		CalculateFrames64(outputFormat.Frames, outputFormat.SampleRate, fileFormat.SampleRate, MaxDecodeFrames);
+		MaxDecodeFrames = std::max(MaxDecodeFrames + 1, (fr_i64)CURSOR_MIN_DECODE_FRAMES);
+		if (!resampler) resampler = GetCurrentResampler();
+		resampler->Reset((fr_i32)MaxDecodeFrames, fileFormat.SampleRate, outputFormat.SampleRate, fileFormat.Channels, !!outputFormat.Index);
+	}
+
+	NextPosition = -1;
+}
+
+void
+CBaseMediaCursor::CopyToOutput(fr_f32** ppFloatData, fr_i64 Offset, fr_f32** ppSourceData, fr_i64 SourceOffset, fr_i64 FramesCount)
+{
+	/* if mono - set middle channels mode for stereo */
+	fr_i32 ChannelsToCopy = std::min(fileFormat.Channels, outputFormat.Channels);
+	if (fileFormat.Channels == 1 && outputFormat.Channels >= 2) ChannelsToCopy = 2;
+	for (fr_i32 i = 0; i < ChannelsToCopy; i++) {
+		memcpy(&ppFloatData[i][Offset], &ppSourceData[fileFormat.Channels == 1 ? 0 : i][SourceOffset], FramesCount * sizeof(fr_f32));
+	}
+}
+
+fr_i64
+CBaseMediaCursor::ReadAt(fr_i64 Position, fr_i64 FramesCount, fr_f32** ppFloatData, bool* pIsEnd)
+{
+	fr_i64 OutputFrames = 0;
+	bool IsEnd = false;
+	if (pIsEnd) *pIsEnd = false;
+	if (!ppFloatData || !outputFormat.Channels || !outputFormat.SampleRate || FramesCount <= 0) return 0;
+
+	/* Seek decoder and clear resampler history only for random access */
+	if (Position != NextPosition) {
+		CalculateFrames64(Position, outputFormat.SampleRate, fileFormat.SampleRate, DecodePosition);
+		if (resampler) resampler->Flush();
+		ResampledFrames = 0;
+		ResampledOffset = 0;
+		EndPosition = -1;
+	}
+
+	for (fr_i32 i = 0; i < outputFormat.Channels; i++) {
+		memset(ppFloatData[i], 0, FramesCount * sizeof(fr_f32));
+	}
+
+	if (outputFormat.SampleRate == fileFormat.SampleRate) {
+		transferBuffers.Resize(fileFormat.Channels, (fr_i32)FramesCount);
+		OutputFrames = std::max(Decode(DecodePosition, FramesCount, transferBuffers.GetBuffers()), (fr_i64)0);
+		CopyToOutput(ppFloatData, 0, transferBuffers.GetBuffers(), 0, OutputFrames);
+		DecodePosition += OutputFrames;
+		IsEnd = OutputFrames < FramesCount;
+	} else {
+		/*
+			Resampler returns a bit different frames count for every block, so
+			output which wasn't requested is kept for the next read. Resampler
+			tail after the end of decoder is flushed by silence and trimmed to
+			resource length in output frames.
+		*/
+		fr_i32 FlushBlocks = 0;
+		while (OutputFrames < FramesCount) {
+			if (ResampledFrames > 0) {
+				fr_i64 FramesToCopy = std::min(ResampledFrames, FramesCount - OutputFrames);
+				CopyToOutput(ppFloatData, OutputFrames, resampledBuffers.GetBuffers(), ResampledOffset, FramesToCopy);
+				ResampledOffset += FramesToCopy;
+				ResampledFrames -= FramesToCopy;
+				OutputFrames += FramesToCopy;
+				continue;
+			}
+
+			if (EndPosition >= 0 && (Position + OutputFrames >= EndPosition || FlushBlocks++ >= CURSOR_MAX_FLUSH_BLOCKS)) {
+				IsEnd = true;
+				break;
+			}
+
+			fr_i64 InputFrames = 0;
+			CalculateFrames64(FramesCount - OutputFrames, outputFormat.SampleRate, fileFormat.SampleRate, InputFrames);
+			InputFrames = std::min(std::max(InputFrames + 1, (fr_i64)CURSOR_MIN_DECODE_FRAMES), MaxDecodeFrames);
+
+			fr_i64 MaxResampledFrames = 0;
+			CalculateFrames64(InputFrames, fileFormat.SampleRate, outputFormat.SampleRate, MaxResampledFrames);
+			MaxResampledFrames += CURSOR_MIN_DECODE_FRAMES;
+			transferBuffers.Resize(fileFormat.Channels, (fr_i32)InputFrames);
+			resampledBuffers.Resize(fileFormat.Channels, (fr_i32)MaxResampledFrames);
+			transferBuffers.Clear();
+
+			if (EndPosition < 0) {
+				fr_i64 DecodedFrames = std::max(Decode(DecodePosition, InputFrames, transferBuffers.GetBuffers()), (fr_i64)0);
+				DecodePosition += DecodedFrames;
+				if (DecodedFrames < InputFrames) CalculateFrames64(DecodePosition, fileFormat.SampleRate, outputFormat.SampleRate, EndPosition);
+			}
+
+			ResampledOffset = 0;
+			ResampledFrames = resampler->ResampleCounted((fr_i32)InputFrames, transferBuffers.GetBuffers(), resampledBuffers.GetBuffers(), (fr_i32)MaxResampledFrames);
+
+			/* Silence after the end isn't part of resource */
+			if (EndPosition >= 0) ResampledFrames = std::max(std::min(ResampledFrames, EndPosition - Position - OutputFrames), (fr_i64)0);
+		}
+	}
+
+	if (pIsEnd) *pIsEnd = IsEnd;
+	NextPosition = Position + OutputFrames;
+	return OutputFrames;
+}
+
+fr_i32
+CBaseMediaCursor::GetDelay()
+{
+	fr_i64 Delay = 0;
+	if (!resampler || !outputFormat.SampleRate || outputFormat.SampleRate == fileFormat.SampleRate) return 0;
+	CalculateFrames64(resampler->GetDelayTime(), fileFormat.SampleRate, outputFormat.SampleRate, Delay);
+	return (fr_i32)Delay;
+}
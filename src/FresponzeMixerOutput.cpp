@@ -0,0 +1,218 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2019-2020. All rights reserved.
+* Copyright (C) Suirless, 2020. All rights reserved.
+* Fresponze - fast, simple and modern multimedia sound library
+* Apache-2 License
+**********************************************************************
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*****************************************************************/
+#include "FresponzeMixerOutput.h"
+
+CMixerOutput::CMixerOutput()
+{
+	AddRef();
+}
+
+CMixerOutput::~CMixerOutput()
+{
+	if (pResampler) delete pResampler;
+}
+
+fr_err
+CMixerOutput::FlushCallback()
+{
+	return 0;
+}
+
+fr_err
+CMixerOutput::FormatCallback(PcmFormat* fmtToSwitch)
+{
+	if (!fmtToSwitch) return -1;
+
+	/* Endpoint stops reading FIFO until render thread recreates it for new format */
+	RequestedChannels.store(fmtToSwitch->Channels, std::memory_order_relaxed);
+	RequestedSampleRate.store(fmtToSwitch->SampleRate, std::memory_order_relaxed);
+	RequestedFrames.store(fmtToSwitch->Frames, std::memory_order_relaxed);
+	FormatVersion.fetch_add(1, std::memory_order_release);
+	IsPrimed = false;
+	return 0;
+}
+
+fr_err
+CMixerOutput::EndpointCallback(fr_f32* pData, fr_i32 Frames, fr_i32 Channels, fr_i32 SampleRate, fr_i32 CurrentEndpointType)
+{
+	fr_i64 SamplesCount = (fr_i64)Frames * Channels;
+	fr_i64 ReadedSamples = 0;
+	if (CurrentEndpointType != RenderType) return -2;
+
+	if (ReadyVersion.load(std::memory_order_acquire) == FormatVersion.load(std::memory_order_relaxed) && Channels == OutputChannels) {
+		/* Wait for half of FIFO after start or underrun, so jitter of primary endpoint is hidden */
+		if (!IsPrimed) IsPrimed = Fifo.GetReadAvailable() >= Fifo.GetCapacity() / 2;
+		if (IsPrimed) ReadedSamples = Fifo.Read(pData, SamplesCount);
+	}
+
+	if (ReadedSamples < SamplesCount) {
+		memset(&pData[ReadedSamples], 0, (SamplesCount - ReadedSamples) * sizeof(fr_f32));
+		if (IsPrimed) {
+			UnderrunsCount.fetch_add(1, std::memory_order_relaxed);
+			IsPrimed = false;
+		}
+	}
+
+	return 0;
+}
+
+fr_err
+CMixerOutput::RenderCallback(fr_i32 Frames, fr_i32 Channels, fr_i32 SampleRate)
+{
+	/* Mixer is rendered by primary endpoint only */
+	return 0;
+}
+
+void
+CMixerOutput::Configure(fr_i32 MixFrames, fr_i32 MixSampleRate)
+{
+	InputFrames = MixFrames;
+	InputSampleRate = MixSampleRate;
+
+	/* Resampler can return a few extra frames for some blocks */
+	CalculateFrames(MixFrames, MixSampleRate, OutputSampleRate, MaxOutputFrames);
+	MaxOutputFrames += 16;
+	if (OutputSampleRate != MixSampleRate) {
+		if (!pResampler) pResampler = GetCurrentResampler();
+		pResampler->Reset(MixFrames, MixSampleRate, OutputSampleRate, OutputChannels, false);
+	}
+
+	/* Drift stage can return a bit more frames than resampler */
+	MaxDriftFrames = (fr_i32)(MaxOutputFrames * (1. + MIXER_OUTPUT_MAX_DRIFT * 2.)) + 2;
+	ChannelsBuffer.Resize(OutputChannels, MixFrames);
+	ResampledBuffer.Resize(OutputChannels, MaxOutputFrames);
+	DriftInput.Resize(OutputChannels, MaxOutputFrames + MIXER_OUTPUT_DRIFT_HISTORY);
+	DriftOutput.Resize(OutputChannels, MaxDriftFrames);
+	LinearBuffer.Resize(MaxDriftFrames * OutputChannels);
+	DriftInput.Clear();
+	DriftPosition = 1.;
+	SmoothedLevel = -1.;
+}
+
+void
+CMixerOutput::MapChannels(fr_f32** ppMix, fr_i32 Frames, fr_i32 MixChannels)
+{
+	fr_f32** ppOutput = ChannelsBuffer.GetBuffers();
+	if (MixChannels == 1 || OutputChannels >= MixChannels) {
+		for (fr_i32 i = 0; i < OutputChannels; i++) {
+			if (MixChannels == 1 || i < MixChannels) memcpy(ppOutput[i], ppMix[MixChannels == 1 ? 0 : i], sizeof(fr_f32) * Frames);
+			else memset(ppOutput[i], 0, sizeof(fr_f32) * Frames);
+		}
+
+		return;
+	}
+
+	/* Fold extra channels of mix to channels of endpoint */
+	fr_f32 Scale = (fr_f32)OutputChannels / (fr_f32)MixChannels;
+	for (fr_i32 i = 0; i < OutputChannels; i++) {
+		memset(ppOutput[i], 0, sizeof(fr_f32) * Frames);
+	}
+
+	for (fr_i32 i = 0; i < MixChannels; i++) {
+		MixerAddToBufferRamp(ppOutput[i % OutputChannels], ppMix[i], Frames, Scale, Scale);
+	}
+}
+
+fr_i32
+CMixerOutput::CorrectDrift(fr_f32** ppInput, fr_i32 Frames)
+{
+	fr_i32 OutputFrames = 0;
+	fr_i32 AvailableFrames = Frames + MIXER_OUTPUT_DRIFT_HISTORY;
+	fr_f64 TargetLevel = (fr_f64)Fifo.GetCapacity() / 2.;
+	fr_f64 Level = (fr_f64)Fifo.GetReadAvailable();
+
+	/* 
+		Fuller FIFO means that device is slower than mixer, so stage reads 
+		input faster and returns less frames. Correction is proportional 
+		to distance from half of FIFO.
+	*/
+	if (SmoothedLevel < 0.) SmoothedLevel = TargetLevel;
+	SmoothedLevel += (Level - SmoothedLevel) * MIXER_OUTPUT_DRIFT_SMOOTHING;
+	fr_f64 Error = (SmoothedLevel - TargetLevel) / (TargetLevel * MIXER_OUTPUT_DRIFT_RANGE);
+	Error = std::min(std::max(Error, -1.), 1.);
+	fr_f64 Step = 1. + Error * MIXER_OUTPUT_MAX_DRIFT;
+
+	for (fr_i32 i = 0; i < OutputChannels; i++) {
+		memcpy(&DriftInput[i][MIXER_OUTPUT_DRIFT_HISTORY], ppInput[i], sizeof(fr_f32) * Frames);
+	}
+
+	/* 4-point Hermite interpolation, so slowly changing phase doesn't color the signal */
+	fr_f64 Position = DriftPosition;
+	while ((fr_i32)Position + 2 < AvailableFrames && OutputFrames < MaxDriftFrames) {
+		fr_i32 Index = (fr_i32)Position;
+		fr_f32 Frac = (fr_f32)(Position - Index);
+		for (fr_i32 i = 0; i < OutputChannels; i++) {
+			const fr_f32* pData = &DriftInput[i][Index - 1];
+			fr_f32 C1 = 0.5f * (pData[2] - pData[0]);
+			fr_f32 C2 = pData[0] - 2.5f * pData[1] + 2.f * pData[2] - 0.5f * pData[3];
+			fr_f32 C3 = 0.5f * (pData[3] - pData[0]) + 1.5f * (pData[1] - pData[2]);
+			DriftOutput[i][OutputFrames] = ((C3 * Frac + C2) * Frac + C1) * Frac + pData[1];
+		}
+
+		OutputFrames++;
+		Position += Step;
+	}
+
+	/* The last frames are history of next block */
+	DriftPosition = std::max(Position - Frames, 1.);
+	for (fr_i32 i = 0; i < OutputChannels; i++) {
+		memmove(DriftInput[i], &DriftInput[i][Frames], sizeof(fr_f32) * MIXER_OUTPUT_DRIFT_HISTORY);
+	}
+
+	return OutputFrames;
+}
+
+void
+CMixerOutput::Write(fr_f32** ppMix, fr_i32 Frames, fr_i32 MixChannels, fr_i32 MixSampleRate)
+{
+	fr_i32 OutputFrames = Frames;
+	fr_i32 NewVersion = FormatVersion.load(std::memory_order_acquire);
+	fr_f32** ppOutput = nullptr;
+
+	/* Endpoint doesn't read FIFO now, so we can recreate it */
+	if (NewVersion != ConfiguredVersion) {
+		OutputChannels = RequestedChannels.load(std::memory_order_relaxed);
+		OutputSampleRate = RequestedSampleRate.load(std::memory_order_relaxed);
+		ConfiguredVersion = NewVersion;
+		InputSampleRate = 0;
+		if (!OutputChannels || !OutputSampleRate) return;
+
+		Configure(Frames, MixSampleRate);
+		Fifo.Resize((fr_i64)std::max(RequestedFrames.load(std::memory_order_relaxed), MaxOutputFrames) * OutputChannels * MIXER_OUTPUT_FIFO_BLOCKS);
+		ReadyVersion.store(NewVersion, std::memory_order_release);
+	}
+
+	if (!OutputChannels || !OutputSampleRate) return;
+	if (InputFrames != Frames || InputSampleRate != MixSampleRate) Configure(Frames, MixSampleRate);
+
+	MapChannels(ppMix, Frames, MixChannels);
+	ppOutput = ChannelsBuffer.GetBuffers();
+	if (OutputSampleRate != MixSampleRate) {
+		OutputFrames = pResampler->ResampleCounted(Frames, ppOutput, ResampledBuffer.GetBuffers(), MaxOutputFrames);
+		ppOutput = ResampledBuffer.GetBuffers();
+	}
+
+	if (OutputFrames <= 0) return;
+	OutputFrames = CorrectDrift(ppOutput, OutputFrames);
+	ppOutput = DriftOutput.GetBuffers();
+
+	/* FIFO can be overflowed only if device stalls, then newest data is dropped */
+	PlanarToLinear(ppOutput, LinearBuffer.Data(), OutputFrames * OutputChannels, OutputChannels);
+	Fifo.Write(LinearBuffer.Data(), (fr_i64)OutputFrames * OutputChannels);
+}
@@ -237,4 +237,77 @@ COpusMediaResource::GetPosition()
 {
 	return FSeek;	//#TODO:
 }
+
+fr_i32
+COpusMediaResource::GetDelay()
+{
+	fr_i64 Delay = 0;
+	if (!resampler || !outputFormat.SampleRate || outputFormat.SampleRate == formatOfFile.SampleRate) return 0;
+	CalculateFrames64(resampler->GetDelayTime(), formatOfFile.SampleRate, outputFormat.SampleRate, Delay);
+	return (fr_i32)Delay;
+}
+
+bool
+COpusMediaResource::CreateCursor(IMediaCursor*& pCursor)
+{
+	if (!of || !FilePtr) return false;
+
+	COpusMediaCursor* pNewCursor = new COpusMediaCursor(this);
+	if (!pNewCursor->IsOpened()) {
+		_RELEASE(pNewCursor);
+		return false;
+	}
+
+	pCursor = pNewCursor;
+	return true;
+}
+
+COpusMediaCursor::COpusMediaCursor(COpusMediaResource* pParentResource)
+{
+	fr_i32 ret = 0;
+	fr_ptr pFileData = nullptr;
+	fr_i64 FileSize = 0;
+
+	AddRef();
+	pParentResource->Clone((void**)&pResource);
+	pResource->GetFormat(fileFormat);
+	pResource->GetFileMemory(pFileData, FileSize);
+	outputFormat = fileFormat;
+	of = op_open_memory((fr_u8*)pFileData, FileSize, &ret);
+}
+
+COpusMediaCursor::~COpusMediaCursor()
+{
+	if (of) op_free(of);
+	_RELEASE(pResource);
+}
+
+fr_i64
+COpusMediaCursor::Decode(fr_i64 Position, fr_i64 FramesCount, fr_f32** ppFloatData)
+{
+	fr_i32 li = 0;
+	fr_i32 ret = 0;
+	fr_i32 Channels = fileFormat.Channels;
+	fr_i64 ReadedFrames = 0;
+
+	if (Position != DecoderPosition) {
+		if (!op_seekable(of) || op_pcm_seek(of, Position)) return 0;
+		DecoderPosition = Position;
+	}
+
+	tempBuffer.Resize((fr_i32)(FramesCount * Channels));
+	while (ReadedFrames < FramesCount) {
+		ret = op_read_float(of, tempBuffer.Data() + ReadedFrames * Channels, (fr_i32)((FramesCount - ReadedFrames) * Channels), &li);
+		if (ret == OP_HOLE) continue;
+		if (ret <= 0) break;		// the end is here
+
+		/* Chained streams with other channels count are not supported by cursor */
+		if (op_head(of, li)->channel_count != Channels) break;
+		ReadedFrames += ret;
+	}
+
+	LinearToPlanar(ppFloatData, tempBuffer.Data(), (fr_i32)(ReadedFrames * Channels), Channels);
+	DecoderPosition += ReadedFrames;
+	return ReadedFrames;
+}
 #endif
\ No newline at end of file
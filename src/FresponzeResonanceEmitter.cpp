@@ -129,7 +129,10 @@ void
 CResonanceEmitter::SetListener(void* pListener)
 {
     IMediaListener* pTemp = (IMediaListener*)pListener;
-    pTemp->Clone(&pParentListener);
+    IMediaListener* pOldListener = (IMediaListener*)pParentListener;
+    pParentListener = nullptr;
+    _RELEASE(pOldListener);
+    if (pTemp) pTemp->Clone(&pParentListener);
 }
 
 void*
@@ -268,7 +271,7 @@ CResonanceEmitter::Process(fr_f32** ppData, fr_i32 Frames)
     fr_i32 FramesReaded = 0;
     IMediaListener* ThisListener = (IMediaListener*)pParentListener;
 
-    if (EmittersState == eStopState || EmittersState == ePauseState) return false;
+    if (EmittersState == eStopState || EmittersState == ePauseState) return ProcessTail(ppData, Frames);
 
     /* Get current position of listener and emitter to reset old state */
     BaseEmitterPosition = (fr_i32)GetPosition();
@@ -307,6 +310,12 @@ CResonanceEmitter::Process(fr_f32** ppData, fr_i32 Frames)
         BaseEmitterPosition += FramesReaded;
     }
 
+    /* Source is silent in this block, so only effects tail can be heard */
+    if (!FramesReaded) {
+        SetPosition(BaseEmitterPosition);
+        return ProcessTail(ppData, Frames);
+    }
+
     /* Process by emitter effect */
     ProcessInternal(ppData, Frames, ListenerFormat.Channels, ListenerFormat.SampleRate);
     EffectNodeStruct* pEffectToProcess = pFirstEffect;
@@ -315,6 +324,7 @@ CResonanceEmitter::Process(fr_f32** ppData, fr_i32 Frames)
         pEffectToProcess = pEffectToProcess->pNext;
     }
 
+    TailFramesLeft = GetEffectsTailLength();
     SetPosition(BaseEmitterPosition);
     return true;
 }
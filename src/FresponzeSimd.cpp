@@ -0,0 +1,952 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2019-2020. All rights reserved.
+* Copyright (C) Suirless, 2020. All rights reserved.
+* Fresponze - fast, simple and modern multimedia sound library
+* Apache-2 License
+**********************************************************************
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*****************************************************************/
+#include "FresponzeTypes.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define FRESPONZE_X86_SIMD
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+#define FRESPONZE_NEON_SIMD
+#include <arm_neon.h>
+#endif
+
+#ifdef _MSC_VER
+#define FR_TARGET(x)
+#else
+#define FR_TARGET(x) __attribute__((target(x)))
+#endif
+
+/* Scalar kernels, used as fallback and for block tails */
+static
+void
+ScalarMixerAddToBuffer(fr_f32* pFirstBuffer, fr_f32* pSecondBuffer, fr_i64 Samples)
+{
+	for (fr_i64 i = 0; i < Samples; i++) {
+		pFirstBuffer[i] += pSecondBuffer[i];
+	}
+}
+
+static
+void
+ScalarMixerAddToBufferRamp(fr_f32* pFirstBuffer, fr_f32* pSecondBuffer, fr_i64 Samples, fr_f32 StartGain, fr_f32 EndGain)
+{
+	if (Samples <= 0) return;
+	fr_f32 GainStep = (EndGain - StartGain) / (fr_f32)Samples;
+	for (fr_i64 i = 0; i < Samples; i++) {
+		pFirstBuffer[i] += pSecondBuffer[i] * (StartGain + GainStep * (fr_f32)i);
+	}
+}
+
+static
+void
+ScalarScaleBufferRamp(fr_f32* pBuffer, fr_i64 Samples, fr_f32 StartGain, fr_f32 EndGain)
+{
+	if (Samples <= 0) return;
+	fr_f32 GainStep = (EndGain - StartGain) / (fr_f32)Samples;
+	for (fr_i64 i = 0; i < Samples; i++) {
+		pBuffer[i] *= StartGain + GainStep * (fr_f32)i;
+	}
+}
+
+static
+void
+ScalarPlanarToLinearFrames(fr_f32** pPlanar, fr_f32* pLinear, fr_i32 FirstFrame, fr_i32 Frames, fr_i32 Channels)
+{
+	for (fr_i32 c = 0; c < Channels; c++) {
+		fr_f32* pChannel = pPlanar[c];
+		for (fr_i32 i = FirstFrame; i < Frames; i++) {
+			pLinear[i * Channels + c] = pChannel[i];
+		}
+	}
+}
+
+template<bool Accumulate>
+static
+void
+ScalarLinearToPlanarFrames(fr_f32** pPlanar, fr_f32* pLinear, fr_i32 FirstFrame, fr_i32 Frames, fr_i32 Channels)
+{
+	for (fr_i32 c = 0; c < Channels; c++) {
+		fr_f32* pChannel = pPlanar[c];
+		for (fr_i32 i = FirstFrame; i < Frames; i++) {
+			if (Accumulate) pChannel[i] += pLinear[i * Channels + c];
+			else pChannel[i] = pLinear[i * Channels + c];
+		}
+	}
+}
+
+static
+void
+ScalarPlanarToLinear(fr_f32** pPlanar, fr_f32* pLinear, fr_i32 SamplesCount, fr_i32 Channels)
+{
+	ScalarPlanarToLinearFrames(pPlanar, pLinear, 0, SamplesCount / Channels, Channels);
+}
+
+static
+void
+ScalarLinearToPlanar(fr_f32** pPlanar, fr_f32* pLinear, fr_i32 SamplesCount, fr_i32 Channels)
+{
+	ScalarLinearToPlanarFrames<false>(pPlanar, pLinear, 0, SamplesCount / Channels, Channels);
+}
+
+static
+void
+ScalarMixLinearToPlanar(fr_f32** pPlanar, fr_f32* pLinear, fr_i32 SamplesCount, fr_i32 Channels)
+{
+	ScalarLinearToPlanarFrames<true>(pPlanar, pLinear, 0, SamplesCount / Channels, Channels);
+}
+
+static
+void
+ScalarFloatToDoubleSingle(fr_f32* pFloat, fr_f64* pDouble, fr_i32 FramesCount)
+{
+	for (fr_i32 i = 0; i < FramesCount; i++) {
+		pDouble[i] = pFloat[i];
+	}
+}
+
+static
+void
+ScalarDoubleToFloatSingle(fr_f32* pFloat, fr_f64* pDouble, fr_i32 FramesCount)
+{
+	for (fr_i32 i = 0; i < FramesCount; i++) {
+		pFloat[i] = (fr_f32)pDouble[i];
+	}
+}
+
+static
+void
+ScalarBiquadLanes(BiquadLanes* pLanes, fr_f32** ppData, fr_i32 Frames, fr_i32 LaneChannels)
+{
+	/* Sections are applied one by one, it's equal to pipelined processing */
+	for (fr_i32 Lane = 0; Lane < FILTER_LANES; Lane++) {
+		fr_f32* pChannel = ppData[Lane % LaneChannels];
+		fr_f32 Z1 = pLanes->Z1[Lane];
+		fr_f32 Z2 = pLanes->Z2[Lane];
+		for (fr_i32 i = 0; i < Frames; i++) {
+			fr_f32 Input = pChannel[i];
+			fr_f32 Output = pLanes->B0[Lane] * Input + Z1;
+			Z1 = pLanes->B1[Lane] * Input + Z2 - pLanes->A1[Lane] * Output;
+			Z2 = pLanes->B2[Lane] * Input - pLanes->A2[Lane] * Output;
+			pChannel[i] = Output;
+		}
+
+		pLanes->Z1[Lane] = Z1;
+		pLanes->Z2[Lane] = Z2;
+	}
+}
+
+static
+void
+ScalarSvfLanes(SvfLanes* pLanes, fr_f32** ppData, fr_i32 Frames, fr_i32 LaneChannels)
+{
+	for (fr_i32 Lane = 0; Lane < FILTER_LANES; Lane++) {
+		fr_f32* pChannel = ppData[Lane % LaneChannels];
+		fr_f32 Ic1 = pLanes->Ic1[Lane];
+		fr_f32 Ic2 = pLanes->Ic2[Lane];
+		for (fr_i32 i = 0; i < Frames; i++) {
+			fr_f32 Input = pChannel[i];
+			fr_f32 V3 = Input - Ic2;
+			fr_f32 V1 = pLanes->A1[Lane] * Ic1 + pLanes->A2[Lane] * V3;
+			fr_f32 V2 = Ic2 + pLanes->A2[Lane] * Ic1 + pLanes->A3[Lane] * V3;
+			Ic1 = 2.f * V1 - Ic1;
+			Ic2 = 2.f * V2 - Ic2;
+			pChannel[i] = pLanes->M0[Lane] * Input + pLanes->M1[Lane] * V1 + pLanes->M2[Lane] * V2;
+		}
+
+		pLanes->Ic1[Lane] = Ic1;
+		pLanes->Ic2[Lane] = Ic2;
+	}
+}
+
+static
+void
+ScalarComplexMultiplyAdd(fr_f32* pOutReal, fr_f32* pOutImag, fr_f32* pFirstReal, fr_f32* pFirstImag, fr_f32* pSecondReal, fr_f32* pSecondImag, fr_i32 Count)
+{
+	for (fr_i32 i = 0; i < Count; i++) {
+		pOutReal[i] += pFirstReal[i] * pSecondReal[i] - pFirstImag[i] * pSecondImag[i];
+		pOutImag[i] += pFirstReal[i] * pSecondImag[i] + pFirstImag[i] * pSecondReal[i];
+	}
+}
+
+static
+void
+ScalarComplexButterflies(fr_f32* pFirstReal, fr_f32* pFirstImag, fr_f32* pSecondReal, fr_f32* pSecondImag, fr_f32* pTwiddleReal, fr_f32* pTwiddleImag, fr_i32 Count)
+{
+	for (fr_i32 i = 0; i < Count; i++) {
+		fr_f32 Real = pSecondReal[i] * pTwiddleReal[i] - pSecondImag[i] * pTwiddleImag[i];
+		fr_f32 Imag = pSecondReal[i] * pTwiddleImag[i] + pSecondImag[i] * pTwiddleReal[i];
+		pSecondReal[i] = pFirstReal[i] - Real;
+		pSecondImag[i] = pFirstImag[i] - Imag;
+		pFirstReal[i] += Real;
+		pFirstImag[i] += Imag;
+	}
+}
+
+static
+void
+ScalarSumDifference(fr_f32* pFirstBuffer, fr_f32* pSecondBuffer, fr_i32 Count)
+{
+	for (fr_i32 i = 0; i < Count; i++) {
+		fr_f32 First = pFirstBuffer[i];
+		pFirstBuffer[i] = First + pSecondBuffer[i];
+		pSecondBuffer[i] = First - pSecondBuffer[i];
+	}
+}
+
+/* 
+	Generic 4-wide kernels. Channels are processed by groups of 4 with 4x4 
+	transpose, so any channels count is supported: stereo has own path, 
+	and the rest of group (1-3 channels) is processed by scalar code.
+*/
+template<typename OPS>
+static
+void
+VecMixerAddToBuffer(fr_f32* pFirstBuffer, fr_f32* pSecondBuffer, fr_i64 Samples)
+{
+	fr_i64 i = 0;
+	for (; i + 4 <= Samples; i += 4) {
+		OPS::Store(&pFirstBuffer[i], OPS::Add(OPS::Load(&pFirstBuffer[i]), OPS::Load(&pSecondBuffer[i])));
+	}
+
+	ScalarMixerAddToBuffer(&pFirstBuffer[i], &pSecondBuffer[i], Samples - i);
+}
+
+template<typename OPS>
+static
+void
+VecMixerAddToBufferRamp(fr_f32* pFirstBuffer, fr_f32* pSecondBuffer, fr_i64 Samples, fr_f32 StartGain, fr_f32 EndGain)
+{
+	if (Samples <= 0) return;
+	fr_f32 GainStep = (EndGain - StartGain) / (fr_f32)Samples;
+	typename OPS::Vec Gain = OPS::Ramp(StartGain, GainStep);
+	typename OPS::Vec VecStep = OPS::Splat(GainStep * 4.f);
+	fr_i64 i = 0;
+	for (; i + 4 <= Samples; i += 4) {
+		OPS::Store(&pFirstBuffer[i], OPS::Add(OPS::Load(&pFirstBuffer[i]), OPS::Mul(OPS::Load(&pSecondBuffer[i]), Gain)));
+		Gain = OPS::Add(Gain, VecStep);
+	}
+
+	ScalarMixerAddToBufferRamp(&pFirstBuffer[i], &pSecondBuffer[i], Samples - i, StartGain + GainStep * (fr_f32)i, EndGain);
+}
+
+template<typename OPS>
+static
+void
+VecScaleBufferRamp(fr_f32* pBuffer, fr_i64 Samples, fr_f32 StartGain, fr_f32 EndGain)
+{
+	if (Samples <= 0) return;
+	fr_f32 GainStep = (EndGain - StartGain) / (fr_f32)Samples;
+	typename OPS::Vec Gain = OPS::Ramp(StartGain, GainStep);
+	typename OPS::Vec VecStep = OPS::Splat(GainStep * 4.f);
+	fr_i64 i = 0;
+	for (; i + 4 <= Samples; i += 4) {
+		OPS::Store(&pBuffer[i], OPS::Mul(OPS::Load(&pBuffer[i]), Gain));
+		Gain = OPS::Add(Gain, VecStep);
+	}
+
+	ScalarScaleBufferRamp(&pBuffer[i], Samples - i, StartGain + GainStep * (fr_f32)i, EndGain);
+}
+
+template<typename OPS>
+static
+void
+VecPlanarToLinear(fr_f32** pPlanar, fr_f32* pLinear, fr_i32 SamplesCount, fr_i32 Channels)
+{
+	fr_i32 Frames = SamplesCount / Channels;
+	fr_i32 Frame = 0;
+
+	if (Channels == 1) {
+		memcpy(pLinear, pPlanar[0], sizeof(fr_f32) * Frames);
+		return;
+	}
+
+	if (Channels == 2) {
+		for (; Frame + 4 <= Frames; Frame += 4) {
+			OPS::Interleave2(OPS::Load(&pPlanar[0][Frame]), OPS::Load(&pPlanar[1][Frame]), &pLinear[Frame * 2]);
+		}
+	} else if (Channels >= 4) {
+		for (; Frame + 4 <= Frames; Frame += 4) {
+			fr_i32 c = 0;
+			for (; c + 4 <= Channels; c += 4) {
+				typename OPS::Vec A = OPS::Load(&pPlanar[c][Frame]);
+				typename OPS::Vec B = OPS::Load(&pPlanar[c + 1][Frame]);
+				typename OPS::Vec C = OPS::Load(&pPlanar[c + 2][Frame]);
+				typename OPS::Vec D = OPS::Load(&pPlanar[c + 3][Frame]);
+				OPS::Transpose(A, B, C, D);
+				OPS::Store(&pLinear[Frame * Channels + c], A);
+				OPS::Store(&pLinear[(Frame + 1) * Channels + c], B);
+				OPS::Store(&pLinear[(Frame + 2) * Channels + c], C);
+				OPS::Store(&pLinear[(Frame + 3) * Channels + c], D);
+			}
+
+			for (; c < Channels; c++) {
+				for (fr_i32 i = Frame; i < Frame + 4; i++) {
+					pLinear[i * Channels + c] = pPlanar[c][i];
+				}
+			}
+		}
+	}
+
+	ScalarPlanarToLinearFrames(pPlanar, pLinear, Frame, Frames, Channels);
+}
+
+template<typename OPS, bool Accumulate>
+static
+void
+VecLinearToPlanar(fr_f32** pPlanar, fr_f32* pLinear, fr_i32 SamplesCount, fr_i32 Channels)
+{
+	fr_i32 Frames = SamplesCount / Channels;
+	fr_i32 Frame = 0;
+
+	if (Channels == 1) {
+		if (Accumulate) VecMixerAddToBuffer<OPS>(pPlanar[0], pLinear, Frames);
+		else memcpy(pPlanar[0], pLinear, sizeof(fr_f32) * Frames);
+		return;
+	}
+
+	if (Channels == 2) {
+		for (; Frame + 4 <= Frames; Frame += 4) {
+			typename OPS::Vec L, R;
+			OPS::Deinterleave2(&pLinear[Frame * 2], L, R);
+			OPS::template StorePlanar<Accumulate>(&pPlanar[0][Frame], L);
+			OPS::template StorePlanar<Accumulate>(&pPlanar[1][Frame], R);
+		}
+	} else if (Channels >= 4) {
+		for (; Frame + 4 <= Frames; Frame += 4) {
+			fr_i32 c = 0;
+			for (; c + 4 <= Channels; c += 4) {
+				typename OPS::Vec A = OPS::Load(&pLinear[Frame * Channels + c]);
+				typename OPS::Vec B = OPS::Load(&pLinear[(Frame + 1) * Channels + c]);
+				typename OPS::Vec C = OPS::Load(&pLinear[(Frame + 2) * Channels + c]);
+				typename OPS::Vec D = OPS::Load(&pLinear[(Frame + 3) * Channels + c]);
+				OPS::Transpose(A, B, C, D);
+				OPS::template StorePlanar<Accumulate>(&pPlanar[c][Frame], A);
+				OPS::template StorePlanar<Accumulate>(&pPlanar[c + 1][Frame], B);
+				OPS::template StorePlanar<Accumulate>(&pPlanar[c + 2][Frame], C);
+				OPS::template StorePlanar<Accumulate>(&pPlanar[c + 3][Frame], D);
+			}
+
+			for (; c < Channels; c++) {
+				for (fr_i32 i = Frame; i < Frame + 4; i++) {
+					if (Accumulate) pPlanar[c][i] += pLinear[i * Channels + c];
+					else pPlanar[c][i] = pLinear[i * Channels + c];
+				}
+			}
+		}
+	}
+
+	ScalarLinearToPlanarFrames<Accumulate>(pPlanar, pLinear, Frame, Frames, Channels);
+}
+
+/* One step of 4 biquads, masked lanes keep their state */
+template<typename OPS>
+struct VecBiquadStep
+{
+	typedef BiquadLanes State;
+	typename OPS::Vec B0, B1, B2, A1, A2, Z1, Z2;
+
+	void Load(State* pState)
+	{
+		B0 = OPS::Load(pState->B0);
+		B1 = OPS::Load(pState->B1);
+		B2 = OPS::Load(pState->B2);
+		A1 = OPS::Load(pState->A1);
+		A2 = OPS::Load(pState->A2);
+		Z1 = OPS::Load(pState->Z1);
+		Z2 = OPS::Load(pState->Z2);
+	}
+
+	void Save(State* pState)
+	{
+		OPS::Store(pState->Z1, Z1);
+		OPS::Store(pState->Z2, Z2);
+	}
+
+	template<bool Masked>
+	typename OPS::Vec Step(typename OPS::Vec Input, typename OPS::Vec Mask)
+	{
+		typename OPS::Vec Output = OPS::Add(OPS::Mul(B0, Input), Z1);
+		typename OPS::Vec NewZ1 = OPS::Sub(OPS::Add(OPS::Mul(B1, Input), Z2), OPS::Mul(A1, Output));
+		typename OPS::Vec NewZ2 = OPS::Sub(OPS::Mul(B2, Input), OPS::Mul(A2, Output));
+		Z1 = Masked ? OPS::Select(Mask, NewZ1, Z1) : NewZ1;
+		Z2 = Masked ? OPS::Select(Mask, NewZ2, Z2) : NewZ2;
+		return Output;
+	}
+};
+
+template<typename OPS>
+struct VecSvfStep
+{
+	typedef SvfLanes State;
+	typename OPS::Vec A1, A2, A3, M0, M1, M2, Ic1, Ic2;
+
+	void Load(State* pState)
+	{
+		A1 = OPS::Load(pState->A1);
+		A2 = OPS::Load(pState->A2);
+		A3 = OPS::Load(pState->A3);
+		M0 = OPS::Load(pState->M0);
+		M1 = OPS::Load(pState->M1);
+		M2 = OPS::Load(pState->M2);
+		Ic1 = OPS::Load(pState->Ic1);
+		Ic2 = OPS::Load(pState->Ic2);
+	}
+
+	void Save(State* pState)
+	{
+		OPS::Store(pState->Ic1, Ic1);
+		OPS::Store(pState->Ic2, Ic2);
+	}
+
+	template<bool Masked>
+	typename OPS::Vec Step(typename OPS::Vec Input, typename OPS::Vec Mask)
+	{
+		typename OPS::Vec V3 = OPS::Sub(Input, Ic2);
+		typename OPS::Vec V1 = OPS::Add(OPS::Mul(A1, Ic1), OPS::Mul(A2, V3));
+		typename OPS::Vec V2 = OPS::Add(OPS::Add(Ic2, OPS::Mul(A2, Ic1)), OPS::Mul(A3, V3));
+		typename OPS::Vec NewIc1 = OPS::Sub(OPS::Add(V1, V1), Ic1);
+		typename OPS::Vec NewIc2 = OPS::Sub(OPS::Add(V2, V2), Ic2);
+		Ic1 = Masked ? OPS::Select(Mask, NewIc1, Ic1) : NewIc1;
+		Ic2 = Masked ? OPS::Select(Mask, NewIc2, Ic2) : NewIc2;
+		return OPS::Add(OPS::Add(OPS::Mul(M0, Input), OPS::Mul(M1, V1)), OPS::Mul(M2, V2));
+	}
+};
+
+/*
+	Pipelined lanes: on step N the first section gets frame N, and other
+	sections get output of previous section from step N - 1. So the last 
+	section outputs frame N - (Sections - 1), and only the first and the 
+	last steps of block have inactive lanes, which must keep their state.
+*/
+template<typename OPS, typename FILTER, fr_i32 LaneChannels>
+static
+void
+VecFilterLanes(typename FILTER::State* pState, fr_f32** ppData, fr_i32 Frames)
+{
+	constexpr fr_i32 Latency = FILTER_LANES / LaneChannels - 1;
+	alignas(16) fr_f32 Output[FILTER_LANES] = {};
+	alignas(16) fr_u32 MaskBits[FILTER_LANES] = {};
+	typename OPS::Vec Mask = OPS::Splat(0.f);
+	typename OPS::Vec Result = OPS::Splat(0.f);
+	FILTER Filter;
+
+	Filter.Load(pState);
+	for (fr_i32 Frame = 0; Frame < Frames + Latency; Frame++) {
+		fr_i32 InputFrame = std::min(Frame, Frames - 1);
+		typename OPS::Vec Input = OPS::template ShiftIn<LaneChannels>(Result, ppData, InputFrame);
+		if (Frame >= Latency && Frame < Frames) {
+			Result = Filter.template Step<false>(Input, Mask);
+		} else {
+			for (fr_i32 Lane = 0; Lane < FILTER_LANES; Lane++) {
+				fr_i32 SectionFrame = Frame - Lane / LaneChannels;
+				MaskBits[Lane] = (SectionFrame >= 0 && SectionFrame < Frames) ? 0xFFFFFFFF : 0;
+			}
+
+			Mask = OPS::LoadMask(MaskBits);
+			Result = Filter.template Step<true>(Input, Mask);
+		}
+
+		if (Frame >= Latency) {
+			OPS::Store(Output, Result);
+			for (fr_i32 c = 0; c < LaneChannels; c++) {
+				ppData[c][Frame - Latency] = Output[Latency * LaneChannels + c];
+			}
+		}
+	}
+
+	Filter.Save(pState);
+}
+
+template<typename OPS>
+static
+void
+VecBiquadLanes(BiquadLanes* pLanes, fr_f32** ppData, fr_i32 Frames, fr_i32 LaneChannels)
+{
+	if (Frames <= 0) return;
+	switch (LaneChannels)
+	{
+	case 1: VecFilterLanes<OPS, VecBiquadStep<OPS>, 1>(pLanes, ppData, Frames); break;
+	case 2: VecFilterLanes<OPS, VecBiquadStep<OPS>, 2>(pLanes, ppData, Frames); break;
+	case 4: VecFilterLanes<OPS, VecBiquadStep<OPS>, 4>(pLanes, ppData, Frames); break;
+	default:
+		ScalarBiquadLanes(pLanes, ppData, Frames, LaneChannels);
+		break;
+	}
+}
+
+template<typename OPS>
+static
+void
+VecSvfLanes(SvfLanes* pLanes, fr_f32** ppData, fr_i32 Frames, fr_i32 LaneChannels)
+{
+	if (Frames <= 0) return;
+	switch (LaneChannels)
+	{
+	case 1: VecFilterLanes<OPS, VecSvfStep<OPS>, 1>(pLanes, ppData, Frames); break;
+	case 2: VecFilterLanes<OPS, VecSvfStep<OPS>, 2>(pLanes, ppData, Frames); break;
+	case 4: VecFilterLanes<OPS, VecSvfStep<OPS>, 4>(pLanes, ppData, Frames); break;
+	default:
+		ScalarSvfLanes(pLanes, ppData, Frames, LaneChannels);
+		break;
+	}
+}
+
+template<typename OPS>
+static
+void
+VecComplexMultiplyAdd(fr_f32* pOutReal, fr_f32* pOutImag, fr_f32* pFirstReal, fr_f32* pFirstImag, fr_f32* pSecondReal, fr_f32* pSecondImag, fr_i32 Count)
+{
+	fr_i32 i = 0;
+	for (; i + 4 <= Count; i += 4) {
+		typename OPS::Vec FirstReal = OPS::Load(&pFirstReal[i]);
+		typename OPS::Vec FirstImag = OPS::Load(&pFirstImag[i]);
+		typename OPS::Vec SecondReal = OPS::Load(&pSecondReal[i]);
+		typename OPS::Vec SecondImag = OPS::Load(&pSecondImag[i]);
+		typename OPS::Vec Real = OPS::Sub(OPS::Mul(FirstReal, SecondReal), OPS::Mul(FirstImag, SecondImag));
+		typename OPS::Vec Imag = OPS::Add(OPS::Mul(FirstReal, SecondImag), OPS::Mul(FirstImag, SecondReal));
+		OPS::Store(&pOutReal[i], OPS::Add(OPS::Load(&pOutReal[i]), Real));
+		OPS::Store(&pOutImag[i], OPS::Add(OPS::Load(&pOutImag[i]), Imag));
+	}
+
+	ScalarComplexMultiplyAdd(&pOutReal[i], &pOutImag[i], &pFirstReal[i], &pFirstImag[i], &pSecondReal[i], &pSecondImag[i], Count - i);
+}
+
+template<typename OPS>
+static
+void
+VecComplexButterflies(fr_f32* pFirstReal, fr_f32* pFirstImag, fr_f32* pSecondReal, fr_f32* pSecondImag, fr_f32* pTwiddleReal, fr_f32* pTwiddleImag, fr_i32 Count)
+{
+	fr_i32 i = 0;
+	for (; i + 4 <= Count; i += 4) {
+		typename OPS::Vec FirstReal = OPS::Load(&pFirstReal[i]);
+		typename OPS::Vec FirstImag = OPS::Load(&pFirstImag[i]);
+		typename OPS::Vec SecondReal = OPS::Load(&pSecondReal[i]);
+		typename OPS::Vec SecondImag = OPS::Load(&pSecondImag[i]);
+		typename OPS::Vec TwiddleReal = OPS::Load(&pTwiddleReal[i]);
+		typename OPS::Vec TwiddleImag = OPS::Load(&pTwiddleImag[i]);
+		typename OPS::Vec Real = OPS::Sub(OPS::Mul(SecondReal, TwiddleReal), OPS::Mul(SecondImag, TwiddleImag));
+		typename OPS::Vec Imag = OPS::Add(OPS::Mul(SecondReal, TwiddleImag), OPS::Mul(SecondImag, TwiddleReal));
+		OPS::Store(&pSecondReal[i], OPS::Sub(FirstReal, Real));
+		OPS::Store(&pSecondImag[i], OPS::Sub(FirstImag, Imag));
+		OPS::Store(&pFirstReal[i], OPS::Add(FirstReal, Real));
+		OPS::Store(&pFirstImag[i], OPS::Add(FirstImag, Imag));
+	}
+
+	ScalarComplexButterflies(&pFirstReal[i], &pFirstImag[i], &pSecondReal[i], &pSecondImag[i], &pTwiddleReal[i], &pTwiddleImag[i], Count - i);
+}
+
+template<typename OPS>
+static
+void
+VecSumDifference(fr_f32* pFirstBuffer, fr_f32* pSecondBuffer, fr_i32 Count)
+{
+	fr_i32 i = 0;
+	for (; i + 4 <= Count; i += 4) {
+		typename OPS::Vec First = OPS::Load(&pFirstBuffer[i]);
+		typename OPS::Vec Second = OPS::Load(&pSecondBuffer[i]);
+		OPS::Store(&pFirstBuffer[i], OPS::Add(First, Second));
+		OPS::Store(&pSecondBuffer[i], OPS::Sub(First, Second));
+	}
+
+	ScalarSumDifference(&pFirstBuffer[i], &pSecondBuffer[i], Count - i);
+}
+
+#ifdef FRESPONZE_X86_SIMD
+/* SSE2 is the base of x86-64, so we don't need target attributes here */
+struct Sse2Ops
+{
+	typedef __m128 Vec;
+
+	static Vec Load(const fr_f32* pData) { return _mm_loadu_ps(pData); }
+	static void Store(fr_f32* pData, Vec Value) { _mm_storeu_ps(pData, Value); }
+	static Vec Add(Vec First, Vec Second) { return _mm_add_ps(First, Second); }
+	static Vec Sub(Vec First, Vec Second) { return _mm_sub_ps(First, Second); }
+	static Vec Mul(Vec First, Vec Second) { return _mm_mul_ps(First, Second); }
+	static Vec Splat(fr_f32 Value) { return _mm_set1_ps(Value); }
+	static Vec Ramp(fr_f32 Start, fr_f32 Step) { return _mm_setr_ps(Start, Start + Step, Start + Step * 2.f, Start + Step * 3.f); }
+	static Vec LoadMask(const fr_u32* pBits) { return _mm_castsi128_ps(_mm_loadu_si128((const __m128i*)pBits)); }
+	static Vec Select(Vec Mask, Vec First, Vec Second) { return _mm_or_ps(_mm_and_ps(Mask, First), _mm_andnot_ps(Mask, Second)); }
+
+	/* New frame goes to the first lanes, other lanes get previous lanes of Value */
+	template<fr_i32 LaneChannels>
+	static Vec ShiftIn(Vec Value, fr_f32** ppData, fr_i32 Frame)
+	{
+		if (LaneChannels == 1) return _mm_move_ss(_mm_shuffle_ps(Value, Value, _MM_SHUFFLE(2, 1, 0, 0)), _mm_set_ss(ppData[0][Frame]));
+		if (LaneChannels == 2) return _mm_movelh_ps(_mm_setr_ps(ppData[0][Frame], ppData[1][Frame], 0.f, 0.f), Value);
+		return _mm_setr_ps(ppData[0][Frame], ppData[1][Frame], ppData[2][Frame], ppData[3][Frame]);
+	}
+
+	template<bool Accumulate>
+	static void StorePlanar(fr_f32* pData, Vec Value)
+	{
+		Store(pData, Accumulate ? Add(Load(pData), Value) : Value);
+	}
+
+	static void Transpose(Vec& A, Vec& B, Vec& C, Vec& D)
+	{
+		_MM_TRANSPOSE4_PS(A, B, C, D);
+	}
+
+	static void Interleave2(Vec Left, Vec Right, fr_f32* pLinear)
+	{
+		_mm_storeu_ps(pLinear, _mm_unpacklo_ps(Left, Right));
+		_mm_storeu_ps(pLinear + 4, _mm_unpackhi_ps(Left, Right));
+	}
+
+	static void Deinterleave2(const fr_f32* pLinear, Vec& Left, Vec& Right)
+	{
+		__m128 First = _mm_loadu_ps(pLinear);
+		__m128 Second = _mm_loadu_ps(pLinear + 4);
+		Left = _mm_shuffle_ps(First, Second, _MM_SHUFFLE(2, 0, 2, 0));
+		Right = _mm_shuffle_ps(First, Second, _MM_SHUFFLE(3, 1, 3, 1));
+	}
+};
+
+static
+void
+Sse2FloatToDoubleSingle(fr_f32* pFloat, fr_f64* pDouble, fr_i32 FramesCount)
+{
+	fr_i32 i = 0;
+	for (; i + 4 <= FramesCount; i += 4) {
+		__m128 Value = _mm_loadu_ps(&pFloat[i]);
+		_mm_storeu_pd(&pDouble[i], _mm_cvtps_pd(Value));
+		_mm_storeu_pd(&pDouble[i + 2], _mm_cvtps_pd(_mm_movehl_ps(Value, Value)));
+	}
+
+	ScalarFloatToDoubleSingle(&pFloat[i], &pDouble[i], FramesCount - i);
+}
+
+static
+void
+Sse2DoubleToFloatSingle(fr_f32* pFloat, fr_f64* pDouble, fr_i32 FramesCount)
+{
+	fr_i32 i = 0;
+	for (; i + 4 <= FramesCount; i += 4) {
+		__m128 Low = _mm_cvtpd_ps(_mm_loadu_pd(&pDouble[i]));
+		__m128 High = _mm_cvtpd_ps(_mm_loadu_pd(&pDouble[i + 2]));
+		_mm_storeu_ps(&pFloat[i], _mm_movelh_ps(Low, High));
+	}
+
+	ScalarDoubleToFloatSingle(&pFloat[i], &pDouble[i], FramesCount - i);
+}
+
+/* 
+	Interleaving is limited by memory bandwidth, so AVX2 and AVX-512 
+	versions are used only for add and conversion kernels.
+*/
+FR_TARGET("avx2")
+static
+void
+Avx2MixerAddToBuffer(fr_f32* pFirstBuffer, fr_f32* pSecondBuffer, fr_i64 Samples)
+{
+	fr_i64 i = 0;
+	for (; i + 8 <= Samples; i += 8) {
+		_mm256_storeu_ps(&pFirstBuffer[i], _mm256_add_ps(_mm256_loadu_ps(&pFirstBuffer[i]), _mm256_loadu_ps(&pSecondBuffer[i])));
+	}
+
+	ScalarMixerAddToBuffer(&pFirstBuffer[i], &pSecondBuffer[i], Samples - i);
+}
+
+FR_TARGET("avx2")
+static
+void
+Avx2MixerAddToBufferRamp(fr_f32* pFirstBuffer, fr_f32* pSecondBuffer, fr_i64 Samples, fr_f32 StartGain, fr_f32 EndGain)
+{
+	if (Samples <= 0) return;
+	fr_f32 GainStep = (EndGain - StartGain) / (fr_f32)Samples;
+	__m256 Gain = _mm256_add_ps(_mm256_set1_ps(StartGain), _mm256_mul_ps(_mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f), _mm256_set1_ps(GainStep)));
+	__m256 VecStep = _mm256_set1_ps(GainStep * 8.f);
+	fr_i64 i = 0;
+	for (; i + 8 <= Samples; i += 8) {
+		__m256 Value = _mm256_mul_ps(_mm256_loadu_ps(&pSecondBuffer[i]), Gain);
+		_mm256_storeu_ps(&pFirstBuffer[i], _mm256_add_ps(_mm256_loadu_ps(&pFirstBuffer[i]), Value));
+		Gain = _mm256_add_ps(Gain, VecStep);
+	}
+
+	ScalarMixerAddToBufferRamp(&pFirstBuffer[i], &pSecondBuffer[i], Samples - i, StartGain + GainStep * (fr_f32)i, EndGain);
+}
+
+FR_TARGET("avx2")
+static
+void
+Avx2FloatToDoubleSingle(fr_f32* pFloat, fr_f64* pDouble, fr_i32 FramesCount)
+{
+	fr_i32 i = 0;
+	for (; i + 4 <= FramesCount; i += 4) {
+		_mm256_storeu_pd(&pDouble[i], _mm256_cvtps_pd(_mm_loadu_ps(&pFloat[i])));
+	}
+
+	ScalarFloatToDoubleSingle(&pFloat[i], &pDouble[i], FramesCount - i);
+}
+
+FR_TARGET("avx2")
+static
+void
+Avx2DoubleToFloatSingle(fr_f32* pFloat, fr_f64* pDouble, fr_i32 FramesCount)
+{
+	fr_i32 i = 0;
+	for (; i + 4 <= FramesCount; i += 4) {
+		_mm_storeu_ps(&pFloat[i], _mm256_cvtpd_ps(_mm256_loadu_pd(&pDouble[i])));
+	}
+
+	ScalarDoubleToFloatSingle(&pFloat[i], &pDouble[i], FramesCount - i);
+}
+
+FR_TARGET("avx512f")
+static
+void
+Avx512MixerAddToBuffer(fr_f32* pFirstBuffer, fr_f32* pSecondBuffer, fr_i64 Samples)
+{
+	fr_i64 i = 0;
+	for (; i + 16 <= Samples; i += 16) {
+		_mm512_storeu_ps(&pFirstBuffer[i], _mm512_add_ps(_mm512_loadu_ps(&pFirstBuffer[i]), _mm512_loadu_ps(&pSecondBuffer[i])));
+	}
+
+	ScalarMixerAddToBuffer(&pFirstBuffer[i], &pSecondBuffer[i], Samples - i);
+}
+
+FR_TARGET("avx512f")
+static
+void
+Avx512FloatToDoubleSingle(fr_f32* pFloat, fr_f64* pDouble, fr_i32 FramesCount)
+{
+	fr_i32 i = 0;
+	for (; i + 8 <= FramesCount; i += 8) {
+		_mm512_storeu_pd(&pDouble[i], _mm512_cvtps_pd(_mm256_loadu_ps(&pFloat[i])));
+	}
+
+	ScalarFloatToDoubleSingle(&pFloat[i], &pDouble[i], FramesCount - i);
+}
+
+FR_TARGET("avx512f")
+static
+void
+Avx512DoubleToFloatSingle(fr_f32* pFloat, fr_f64* pDouble, fr_i32 FramesCount)
+{
+	fr_i32 i = 0;
+	for (; i + 8 <= FramesCount; i += 8) {
+		_mm256_storeu_ps(&pFloat[i], _mm512_cvtpd_ps(_mm512_loadu_pd(&pDouble[i])));
+	}
+
+	ScalarDoubleToFloatSingle(&pFloat[i], &pDouble[i], FramesCount - i);
+}
+
+static
+void
+GetX86Features(bool& IsAvx2, bool& IsAvx512)
+{
+#ifdef _MSC_VER
+	int CpuInfo[4] = {};
+	IsAvx2 = false;
+	IsAvx512 = false;
+
+	__cpuid(CpuInfo, 0);
+	if (CpuInfo[0] < 7) return;
+
+	/* OS must save YMM/ZMM registers on context switch */
+	__cpuid(CpuInfo, 1);
+	if (!(CpuInfo[2] & (1 << 27)) || !(CpuInfo[2] & (1 << 28))) return;
+	unsigned long long Xcr0 = _xgetbv(0);
+
+	__cpuidex(CpuInfo, 7, 0);
+	IsAvx2 = ((Xcr0 & 0x6) == 0x6) && (CpuInfo[1] & (1 << 5));
+	IsAvx512 = ((Xcr0 & 0xE6) == 0xE6) && (CpuInfo[1] & (1 << 16));
+#else
+	__builtin_cpu_init();
+	IsAvx2 = __builtin_cpu_supports("avx2");
+	IsAvx512 = __builtin_cpu_supports("avx512f");
+#endif
+}
+#endif
+
+#ifdef FRESPONZE_NEON_SIMD
+struct NeonOps
+{
+	typedef float32x4_t Vec;
+
+	static Vec Load(const fr_f32* pData) { return vld1q_f32(pData); }
+	static void Store(fr_f32* pData, Vec Value) { vst1q_f32(pData, Value); }
+	static Vec Add(Vec First, Vec Second) { return vaddq_f32(First, Second); }
+	static Vec Sub(Vec First, Vec Second) { return vsubq_f32(First, Second); }
+	static Vec Mul(Vec First, Vec Second) { return vmulq_f32(First, Second); }
+	static Vec Splat(fr_f32 Value) { return vdupq_n_f32(Value); }
+	static Vec LoadMask(const fr_u32* pBits) { return vreinterpretq_f32_u32(vld1q_u32(pBits)); }
+	static Vec Select(Vec Mask, Vec First, Vec Second) { return vbslq_f32(vreinterpretq_u32_f32(Mask), First, Second); }
+
+	template<fr_i32 LaneChannels>
+	static Vec ShiftIn(Vec Value, fr_f32** ppData, fr_i32 Frame)
+	{
+		if (LaneChannels == 1) return vextq_f32(vdupq_n_f32(ppData[0][Frame]), Value, 3);
+		if (LaneChannels == 2) {
+			const fr_f32 Values[2] = { ppData[0][Frame], ppData[1][Frame] };
+			return vcombine_f32(vld1_f32(Values), vget_low_f32(Value));
+		}
+
+		const fr_f32 Values[4] = { ppData[0][Frame], ppData[1][Frame], ppData[2][Frame], ppData[3][Frame] };
+		return vld1q_f32(Values);
+	}
+
+	static Vec Ramp(fr_f32 Start, fr_f32 Step)
+	{
+		const fr_f32 Values[4] = { Start, Start + Step, Start + Step * 2.f, Start + Step * 3.f };
+		return vld1q_f32(Values);
+	}
+
+	template<bool Accumulate>
+	static void StorePlanar(fr_f32* pData, Vec Value)
+	{
+		Store(pData, Accumulate ? Add(Load(pData), Value) : Value);
+	}
+
+	static void Transpose(Vec& A, Vec& B, Vec& C, Vec& D)
+	{
+		float32x4x2_t AB = vtrnq_f32(A, B);
+		float32x4x2_t CD = vtrnq_f32(C, D);
+		A = vcombine_f32(vget_low_f32(AB.val[0]), vget_low_f32(CD.val[0]));
+		B = vcombine_f32(vget_low_f32(AB.val[1]), vget_low_f32(CD.val[1]));
+		C = vcombine_f32(vget_high_f32(AB.val[0]), vget_high_f32(CD.val[0]));
+		D = vcombine_f32(vget_high_f32(AB.val[1]), vget_high_f32(CD.val[1]));
+	}
+
+	static void Interleave2(Vec Left, Vec Right, fr_f32* pLinear)
+	{
+		float32x4x2_t Value = { { Left, Right } };
+		vst2q_f32(pLinear, Value);
+	}
+
+	static void Deinterleave2(const fr_f32* pLinear, Vec& Left, Vec& Right)
+	{
+		float32x4x2_t Value = vld2q_f32(pLinear);
+		Left = Value.val[0];
+		Right = Value.val[1];
+	}
+};
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+static
+void
+NeonFloatToDoubleSingle(fr_f32* pFloat, fr_f64* pDouble, fr_i32 FramesCount)
+{
+	fr_i32 i = 0;
+	for (; i + 4 <= FramesCount; i += 4) {
+		float32x4_t Value = vld1q_f32(&pFloat[i]);
+		vst1q_f64(&pDouble[i], vcvt_f64_f32(vget_low_f32(Value)));
+		vst1q_f64(&pDouble[i + 2], vcvt_high_f64_f32(Value));
+	}
+
+	ScalarFloatToDoubleSingle(&pFloat[i], &pDouble[i], FramesCount - i);
+}
+
+static
+void
+NeonDoubleToFloatSingle(fr_f32* pFloat, fr_f64* pDouble, fr_i32 FramesCount)
+{
+	fr_i32 i = 0;
+	for (; i + 4 <= FramesCount; i += 4) {
+		float32x2_t Low = vcvt_f32_f64(vld1q_f64(&pDouble[i]));
+		vst1q_f32(&pFloat[i], vcvt_high_f32_f64(Low, vld1q_f64(&pDouble[i + 2])));
+	}
+
+	ScalarDoubleToFloatSingle(&pFloat[i], &pDouble[i], FramesCount - i);
+}
+#endif
+#endif
+
+/* Scalar table is constant-initialized, so it's valid even before dynamic initialization */
+FresponzeKernels FrKernels = {
+	"Scalar",
+	ScalarMixerAddToBuffer,
+	ScalarMixerAddToBufferRamp,
+	ScalarScaleBufferRamp,
+	ScalarPlanarToLinear,
+	ScalarLinearToPlanar,
+	ScalarMixLinearToPlanar,
+	ScalarFloatToDoubleSingle,
+	ScalarDoubleToFloatSingle,
+	ScalarBiquadLanes,
+	ScalarSvfLanes,
+	ScalarComplexMultiplyAdd,
+	ScalarComplexButterflies,
+	ScalarSumDifference
+};
+
+static
+bool
+InitializeKernels()
+{
+#ifdef FRESPONZE_X86_SIMD
+	bool IsAvx2 = false;
+	bool IsAvx512 = false;
+	GetX86Features(IsAvx2, IsAvx512);
+
+	FrKernels.pName = "SSE2";
+	FrKernels.pMixerAddToBuffer = VecMixerAddToBuffer<Sse2Ops>;
+	FrKernels.pMixerAddToBufferRamp = VecMixerAddToBufferRamp<Sse2Ops>;
+	FrKernels.pScaleBufferRamp = VecScaleBufferRamp<Sse2Ops>;
+	FrKernels.pPlanarToLinear = VecPlanarToLinear<Sse2Ops>;
+	FrKernels.pLinearToPlanar = VecLinearToPlanar<Sse2Ops, false>;
+	FrKernels.pMixLinearToPlanar = VecLinearToPlanar<Sse2Ops, true>;
+	FrKernels.pFloatToDoubleSingle = Sse2FloatToDoubleSingle;
+	FrKernels.pDoubleToFloatSingle = Sse2DoubleToFloatSingle;
+	FrKernels.pBiquadLanes = VecBiquadLanes<Sse2Ops>;
+	FrKernels.pSvfLanes = VecSvfLanes<Sse2Ops>;
+	FrKernels.pComplexMultiplyAdd = VecComplexMultiplyAdd<Sse2Ops>;
+	FrKernels.pComplexButterflies = VecComplexButterflies<Sse2Ops>;
+	FrKernels.pSumDifference = VecSumDifference<Sse2Ops>;
+
+	if (IsAvx2) {
+		FrKernels.pName = "AVX2";
+		FrKernels.pMixerAddToBuffer = Avx2MixerAddToBuffer;
+		FrKernels.pMixerAddToBufferRamp = Avx2MixerAddToBufferRamp;
+		FrKernels.pFloatToDoubleSingle = Avx2FloatToDoubleSingle;
+		FrKernels.pDoubleToFloatSingle = Avx2DoubleToFloatSingle;
+	}
+
+	if (IsAvx512) {
+		FrKernels.pName = "AVX-512";
+		FrKernels.pMixerAddToBuffer = Avx512MixerAddToBuffer;
+		FrKernels.pFloatToDoubleSingle = Avx512FloatToDoubleSingle;
+		FrKernels.pDoubleToFloatSingle = Avx512DoubleToFloatSingle;
+	}
+#elif defined(FRESPONZE_NEON_SIMD)
+	FrKernels.pName = "NEON";
+	FrKernels.pMixerAddToBuffer = VecMixerAddToBuffer<NeonOps>;
+	FrKernels.pMixerAddToBufferRamp = VecMixerAddToBufferRamp<NeonOps>;
+	FrKernels.pScaleBufferRamp = VecScaleBufferRamp<NeonOps>;
+	FrKernels.pPlanarToLinear = VecPlanarToLinear<NeonOps>;
+	FrKernels.pLinearToPlanar = VecLinearToPlanar<NeonOps, false>;
+	FrKernels.pMixLinearToPlanar = VecLinearToPlanar<NeonOps, true>;
+	FrKernels.pBiquadLanes = VecBiquadLanes<NeonOps>;
+	FrKernels.pSvfLanes = VecSvfLanes<NeonOps>;
+	FrKernels.pComplexMultiplyAdd = VecComplexMultiplyAdd<NeonOps>;
+	FrKernels.pComplexButterflies = VecComplexButterflies<NeonOps>;
+	FrKernels.pSumDifference = VecSumDifference<NeonOps>;
+#if defined(__aarch64__) || defined(_M_ARM64)
+	FrKernels.pFloatToDoubleSingle = NeonFloatToDoubleSingle;
+	FrKernels.pDoubleToFloatSingle = NeonDoubleToFloatSingle;
+#endif
+#endif
+
+	return true;
+}
+
+static bool IsKernelsInitialized = InitializeKernels();
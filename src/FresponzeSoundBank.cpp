@@ -0,0 +1,435 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2019-2020. All rights reserved.
+* Copyright (C) Suirless, 2020. All rights reserved.
+* Fresponze - fast, simple and modern multimedia sound library
+* Apache-2 License
+**********************************************************************
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*****************************************************************/
+#include "FresponzeSoundBank.h"
+#include "FresponzeWavFile.h"
+#include "FresponzeOpusFile.h"
+
+#define PCM_DECODE_BLOCK 4096
+
+void*
+GetFormatListener(char* pListenerOpenLink)
+{
+	if (!strcmp(GetFilePathFormat(pListenerOpenLink), ".wav")) return new CRIFFMediaResource();
+#ifdef FRESPONZE_USE_OPUS
+	if (!strcmp(GetFilePathFormat(pListenerOpenLink), ".opus")) return new COpusMediaResource();
+#endif
+	return nullptr;
+} 
+
+CPcmMediaResource::CPcmMediaResource()
+{
+	AddRef();
+}
+
+CPcmMediaResource::~CPcmMediaResource()
+{
+	_RELEASE(pOwnCursor);
+}
+
+bool
+CPcmMediaResource::Decode(IMediaResource* pSourceResource, PcmFormat DecodeFormat, fr_i64 MaxFrames)
+{
+	fr_i64 OutputFrames = 0;
+	fr_i64 DecodedFrames = 0;
+	IMediaCursor* pCursor = nullptr;
+	PcmFormat SourceFormat = {};
+	PcmFormat CursorFormat = {};
+	fr_f32* pBlockData[MAX_CHANNELS] = {};
+
+	pSourceResource->GetFormat(SourceFormat);
+	if (!SourceFormat.Channels || SourceFormat.Channels > MAX_CHANNELS || !SourceFormat.SampleRate || !DecodeFormat.SampleRate) return false;
+	if (!pSourceResource->CreateCursor(pCursor)) return false;
+
+	CalculateFrames64(SourceFormat.Frames, SourceFormat.SampleRate, DecodeFormat.SampleRate, OutputFrames);
+	if (MaxFrames >= 0) OutputFrames = std::min(OutputFrames, MaxFrames);
+	fileFormat = SourceFormat;
+	fileFormat.SampleRate = DecodeFormat.SampleRate;
+	fileFormat.Bits = 32;
+	fileFormat.IsFloat = true;
+
+	/* Resampler of cursor must accept the whole block in source sample rate */
+	CursorFormat = fileFormat;
+	CalculateFrames(PCM_DECODE_BLOCK, DecodeFormat.SampleRate, SourceFormat.SampleRate, CursorFormat.Frames);
+	CursorFormat.Frames = std::max(CursorFormat.Frames, PCM_DECODE_BLOCK);
+	pCursor->SetFormat(CursorFormat);
+
+	/* Cursor always writes full block, so we need space for the last one */
+	PcmData.Resize(fileFormat.Channels, (fr_i32)OutputFrames + PCM_DECODE_BLOCK);
+	while (DecodedFrames < OutputFrames) {
+		for (fr_i32 i = 0; i < fileFormat.Channels; i++) {
+			pBlockData[i] = &PcmData.GetBufferData(i)[DecodedFrames];
+		}
+
+		fr_i64 ReadedFrames = pCursor->ReadAt(DecodedFrames, PCM_DECODE_BLOCK, pBlockData);
+		if (ReadedFrames <= 0) break;
+		DecodedFrames += ReadedFrames;
+	}
+
+	_RELEASE(pCursor);
+	FileFrames = std::min(DecodedFrames, OutputFrames);
+	fileFormat.Frames = (fr_i32)FileFrames;
+	outputFormat = fileFormat;
+	FramePosition = 0;
+	return FileFrames > 0;
+}
+
+fr_i64
+CPcmMediaResource::GetMemorySize()
+{
+	return (fr_i64)PcmData.GetBuffersCount() * PcmData.GetBufferSize() * sizeof(fr_f32);
+}
+
+bool
+CPcmMediaResource::OpenResource(void* pResourceLinker)
+{
+	/* Resource is created only by decoding other one */
+	return false;
+}
+
+bool
+CPcmMediaResource::CloseResource()
+{
+	return true;
+}
+
+void
+CPcmMediaResource::GetFormat(PcmFormat& format)
+{
+	format = fileFormat;
+}
+
+void
+CPcmMediaResource::SetFormat(PcmFormat outputFormat)
+{
+	this->outputFormat = outputFormat;
+	if (pOwnCursor) pOwnCursor->SetFormat(outputFormat);
+}
+
+void
+CPcmMediaResource::GetVendorName(const char*& vendorName)
+{
+	vendorName = "PCM";
+}
+
+void
+CPcmMediaResource::GetVendorString(const char*& vendorString)
+{
+	vendorString = "Decoded sound bank resource";
+}
+
+fr_i64
+CPcmMediaResource::Read(fr_i64 FramesCount, fr_f32** ppFloatData)
+{
+	fr_i64 OutputPosition = 0;
+	fr_i64 ReadedFrames = 0;
+	if (!pOwnCursor) {
+		if (!CreateCursor(pOwnCursor)) return 0;
+		pOwnCursor->SetFormat(outputFormat);
+	}
+
+	CalculateFrames64(FramePosition, fileFormat.SampleRate, outputFormat.SampleRate, OutputPosition);
+	ReadedFrames = pOwnCursor->ReadAt(OutputPosition, FramesCount, ppFloatData);
+	if (ReadedFrames <= 0) {
+		/* Set position to 0 for replay */
+		FramePosition = 0;
+		return 0;
+	}
+
+	CalculateFrames64(OutputPosition + ReadedFrames, outputFormat.SampleRate, fileFormat.SampleRate, FramePosition);
+	return ReadedFrames;
+}
+
+fr_i64
+CPcmMediaResource::ReadRaw(fr_i64 FramesCount, fr_f32** ppFloatData)
+{
+	fr_i64 ReadedFrames = ReadRawAt(FramePosition, FramesCount, ppFloatData);
+	FramePosition += ReadedFrames;
+	return ReadedFrames;
+}
+
+fr_i64
+CPcmMediaResource::ReadRawAt(fr_i64 Position, fr_i64 FramesCount, fr_f32** ppFloatData)
+{
+	FramesCount = std::min(FramesCount, FileFrames - Position);
+	if (Position < 0 || FramesCount <= 0) return 0;
+
+	for (fr_i32 i = 0; i < fileFormat.Channels; i++) {
+		memcpy(ppFloatData[i], &PcmData.GetBufferData(i)[Position], FramesCount * sizeof(fr_f32));
+	}
+
+	return FramesCount;
+}
+
+fr_i64
+CPcmMediaResource::SetPosition(fr_i64 FramePosition)
+{
+	return (this->FramePosition = std::max(std::min(FramePosition, FileFrames), (fr_i64)0));
+}
+
+fr_i64
+CPcmMediaResource::GetPosition()
+{
+	return FramePosition;
+}
+
+fr_i32
+CPcmMediaResource::GetDelay()
+{
+	return pOwnCursor ? pOwnCursor->GetDelay() : 0;
+}
+
+bool
+CPcmMediaResource::CreateCursor(IMediaCursor*& pCursor)
+{
+	if (!FileFrames) return false;
+	pCursor = new CPcmMediaCursor(this);
+	return true;
+}
+
+CPcmMediaCursor::CPcmMediaCursor(CPcmMediaResource* pParentResource)
+{
+	AddRef();
+	pParentResource->Clone((void**)&pResource);
+	pResource->GetFormat(fileFormat);
+	outputFormat = fileFormat;
+}
+
+CPcmMediaCursor::~CPcmMediaCursor()
+{
+	_RELEASE(pResource);
+}
+
+fr_i64
+CPcmMediaCursor::Decode(fr_i64 Position, fr_i64 FramesCount, fr_f32** ppFloatData)
+{
+	return pResource->ReadRawAt(Position, FramesCount, ppFloatData);
+}
+
+/* FNV-1a, only to skip string comparison for most of entries */
+inline
+fr_u64
+GetPathHash(const fr_utf8* pPath)
+{
+	fr_u64 Hash = 0xcbf29ce484222325ull;
+	while (*pPath) {
+		Hash ^= (fr_u8)*pPath++;
+		Hash *= 0x100000001b3ull;
+	}
+
+	return Hash;
+}
+
+CSoundBank::CSoundBank()
+{
+	AddRef();
+}
+
+CSoundBank::~CSoundBank()
+{
+	while (pFirstEntry) {
+		SoundBankEntry* pEntry = pFirstEntry;
+		UnlinkEntry(pEntry);
+		FreeEntry(pEntry);
+	}
+
+	_RELEASE(pPrefetcher);
+}
+
+void
+CSoundBank::SetPrefetcher(CStreamPrefetcher* pStreamPrefetcher, fr_f32 AheadSeconds)
+{
+	_RELEASE(pPrefetcher);
+	if (pStreamPrefetcher) pStreamPrefetcher->Clone((void**)&pPrefetcher);
+	PrefetchTime = AheadSeconds;
+}
+
+void
+CSoundBank::SetHeadCacheTime(fr_f32 Seconds)
+{
+	HeadCacheTime = std::max(Seconds, 0.f);
+}
+
+void
+CSoundBank::SetMemoryBudget(fr_i64 BytesBudget)
+{
+	MemoryBudget = std::max(BytesBudget, (fr_i64)0);
+	Trim(0);
+}
+
+void
+CSoundBank::SetMaxPreloadTime(fr_f32 Seconds)
+{
+	MaxPreloadTime = std::max(Seconds, 0.f);
+}
+
+fr_i64
+CSoundBank::GetMemoryUsed()
+{
+	return MemoryUsed;
+}
+
+SoundBankEntry*
+CSoundBank::FindEntry(const fr_utf8* pPath, fr_u64 PathHash)
+{
+	SoundBankEntry* pEntry = pFirstEntry;
+	while (pEntry) {
+		if (pEntry->PathHash == PathHash && !strcmp(pEntry->pPath, pPath)) return pEntry;
+		pEntry = pEntry->pNext;
+	}
+
+	return nullptr;
+}
+
+void
+CSoundBank::LinkEntry(SoundBankEntry* pEntry)
+{
+	/* The first entry is the last used one */
+	pEntry->pPrev = nullptr;
+	pEntry->pNext = pFirstEntry;
+	if (pFirstEntry) pFirstEntry->pPrev = pEntry;
+	else pLastEntry = pEntry;
+	pFirstEntry = pEntry;
+}
+
+void
+CSoundBank::UnlinkEntry(SoundBankEntry* pEntry)
+{
+	if (pEntry->pPrev) pEntry->pPrev->pNext = pEntry->pNext;
+	else pFirstEntry = pEntry->pNext;
+	if (pEntry->pNext) pEntry->pNext->pPrev = pEntry->pPrev;
+	else pLastEntry = pEntry->pPrev;
+
+	pEntry->pNext = nullptr;
+	pEntry->pPrev = nullptr;
+}
+
+void
+CSoundBank::FreeEntry(SoundBankEntry* pEntry)
+{
+	MemoryUsed -= pEntry->MemorySize;
+	_RELEASE(pEntry->pResource);
+	if (pEntry->pPath) FreeFastMemory(pEntry->pPath);
+	delete pEntry;
+}
+
+bool
+CSoundBank::Trim(fr_i64 BytesToFit)
+{
+	SoundBankEntry* pEntry = pLastEntry;
+	if (BytesToFit > MemoryBudget) return false;
+
+	/* Evict oldest decoded entries, which are not used by listeners */
+	while (pEntry && MemoryUsed + BytesToFit > MemoryBudget) {
+		SoundBankEntry* pPrevEntry = pEntry->pPrev;
+		if (pEntry->MemorySize && pEntry->pResource->GetRefCount() <= 1) {
+			UnlinkEntry(pEntry);
+			FreeEntry(pEntry);
+		}
+
+		pEntry = pPrevEntry;
+	}
+
+	return MemoryUsed + BytesToFit <= MemoryBudget;
+}
+
+void
+CSoundBank::Purge()
+{
+	SoundBankEntry* pEntry = pLastEntry;
+	while (pEntry) {
+		SoundBankEntry* pPrevEntry = pEntry->pPrev;
+		if (pEntry->pResource->GetRefCount() <= 1) {
+			UnlinkEntry(pEntry);
+			FreeEntry(pEntry);
+		}
+
+		pEntry = pPrevEntry;
+	}
+}
+
+bool
+CSoundBank::GetResource(const fr_utf8* pPath, PcmFormat MixFormat, IMediaResource*& pResource)
+{
+	fr_u64 PathHash = 0;
+	fr_i64 DecodedFrames = 0;
+	PcmFormat FileFormat = {};
+	SoundBankEntry* pEntry = nullptr;
+	IMediaResource* pFileResource = nullptr;
+	if (!pPath) return false;
+
+	PathHash = GetPathHash(pPath);
+	pEntry = FindEntry(pPath, PathHash);
+	if (pEntry) {
+		UnlinkEntry(pEntry);
+		LinkEntry(pEntry);
+		return pEntry->pResource->Clone((void**)&pResource);
+	}
+
+	pFileResource = (IMediaResource*)GetFormatListener((char*)pPath);
+	if (!pFileResource) return false;
+	if (!pFileResource->OpenResource((void*)pPath)) {
+		_RELEASE(pFileResource);
+		return false;
+	}
+
+	pEntry = new SoundBankEntry;
+	pEntry->PathHash = PathHash;
+	pEntry->pPath = (fr_utf8*)FastMemAlloc((fr_i32)strlen(pPath) + 1);
+	memcpy(pEntry->pPath, pPath, strlen(pPath) + 1);
+	pEntry->pResource = pFileResource;
+
+	/* Short assets are decoded if they fit to budget, other ones are streamed from file */
+	pFileResource->GetFormat(FileFormat);
+	if (MixFormat.SampleRate && FileFormat.SampleRate && FileFormat.Frames <= (fr_f64)MaxPreloadTime * FileFormat.SampleRate) {
+		CalculateFrames64(FileFormat.Frames, FileFormat.SampleRate, MixFormat.SampleRate, DecodedFrames);
+		if (Trim((DecodedFrames + PCM_DECODE_BLOCK) * FileFormat.Channels * (fr_i64)sizeof(fr_f32))) {
+			CPcmMediaResource* pPcmResource = new CPcmMediaResource;
+			if (pPcmResource->Decode(pFileResource, MixFormat)) {
+				_RELEASE(pEntry->pResource);
+				pEntry->pResource = pPcmResource;
+				pEntry->MemorySize = pPcmResource->GetMemorySize();
+				MemoryUsed += pEntry->MemorySize;
+			} else {
+				_RELEASE(pPcmResource);
+			}
+		}
+	}
+
+	/* Audio thread reads decoded stream from ring, decoder works in prefetch thread */
+	if (!pEntry->MemorySize && pPrefetcher) {
+		CPcmMediaResource* pHeadResource = nullptr;
+		fr_i64 HeadFrames = (fr_i64)(HeadCacheTime * MixFormat.SampleRate);
+		if (HeadFrames > 0 && Trim((HeadFrames + PCM_DECODE_BLOCK) * FileFormat.Channels * (fr_i64)sizeof(fr_f32))) {
+			pHeadResource = new CPcmMediaResource;
+			if (pHeadResource->Decode(pFileResource, MixFormat, HeadFrames)) {
+				pEntry->MemorySize = pHeadResource->GetMemorySize();
+				MemoryUsed += pEntry->MemorySize;
+			} else {
+				_RELEASE(pHeadResource);
+			}
+		}
+
+		pEntry->pResource = new CStreamedMediaResource(pFileResource, pPrefetcher, PrefetchTime, pHeadResource);
+		_RELEASE(pHeadResource);
+		_RELEASE(pFileResource);
+	}
+
+	LinkEntry(pEntry);
+	return pEntry->pResource->Clone((void**)&pResource);
+}
@@ -0,0 +1,112 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2019-2020. All rights reserved.
+* Copyright (C) Suirless, 2020. All rights reserved.
+* Fresponze - fast, simple and modern multimedia sound library
+* Apache-2 License
+**********************************************************************
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*****************************************************************/
+#include "FresponzeSpectralChain.h"
+
+void
+CSpectralChain::SetFormat(fr_i32 ChannelsCount)
+{
+	fr_f64 OverlapSum = 0.;
+	if (ChannelsCount <= 0 || ChannelsCount > MAX_CHANNELS) return;
+
+	Channels = ChannelsCount;
+	FFT.Initialize(SPECTRAL_FFT_SIZE);
+	Window.Resize(SPECTRAL_FFT_SIZE);
+	for (fr_i32 i = 0; i < SPECTRAL_FFT_SIZE; i++) {
+		Window[i] = (fr_f32)sqrt(0.5 - 0.5 * cos(2. * M_PI * i / SPECTRAL_FFT_SIZE));
+	}
+
+	/* Sum of squared windows of overlapped frames is constant for periodic Hann */
+	for (fr_i32 i = 0; i < SPECTRAL_FFT_SIZE; i += SPECTRAL_HOP_SIZE) {
+		OverlapSum += (fr_f64)Window[i] * Window[i];
+	}
+
+	OutputScale = (fr_f32)(1. / OverlapSum);
+	InputFrames.Resize(Channels, SPECTRAL_FFT_SIZE);
+	OutputFrames.Resize(Channels, SPECTRAL_FFT_SIZE);
+	RealBins.Resize(Channels, FFT.GetBinsCount());
+	ImagBins.Resize(Channels, FFT.GetBinsCount());
+	TimeBuffer.Resize(SPECTRAL_FFT_SIZE);
+	TempBuffer.Resize(SPECTRAL_FFT_SIZE);
+	Reset();
+}
+
+void
+CSpectralChain::Reset()
+{
+	HopPosition = 0;
+	InputFrames.Clear();
+	OutputFrames.Clear();
+}
+
+void
+CSpectralChain::ProcessFrame(EffectNodeStruct* pFirstEffect)
+{
+	fr_f32* pTime = TimeBuffer.Data();
+	fr_f32* pWindow = Window.Data();
+
+	for (fr_i32 c = 0; c < Channels; c++) {
+		fr_f32* pInput = InputFrames.GetBufferData(c);
+		for (fr_i32 i = 0; i < SPECTRAL_FFT_SIZE; i++) {
+			pTime[i] = pInput[i] * pWindow[i];
+		}
+
+		FFT.Forward(pTime, RealBins.GetBufferData(c), ImagBins.GetBufferData(c), TempBuffer.Data());
+		memmove(pInput, pInput + SPECTRAL_HOP_SIZE, sizeof(fr_f32) * (SPECTRAL_FFT_SIZE - SPECTRAL_HOP_SIZE));
+	}
+
+	EffectNodeStruct* pNode = pFirstEffect;
+	while (pNode) {
+		pNode->pEffect->ProcessSpectrum(RealBins.GetBuffers(), ImagBins.GetBuffers(), FFT.GetBinsCount());
+		pNode = pNode->pNext;
+	}
+
+	/* Played hop is dropped, and the new frame is added to the rest */
+	for (fr_i32 c = 0; c < Channels; c++) {
+		fr_f32* pOutput = OutputFrames.GetBufferData(c);
+		FFT.Inverse(RealBins.GetBufferData(c), ImagBins.GetBufferData(c), pTime, TempBuffer.Data());
+		memmove(pOutput, pOutput + SPECTRAL_HOP_SIZE, sizeof(fr_f32) * (SPECTRAL_FFT_SIZE - SPECTRAL_HOP_SIZE));
+		memset(pOutput + SPECTRAL_FFT_SIZE - SPECTRAL_HOP_SIZE, 0, sizeof(fr_f32) * SPECTRAL_HOP_SIZE);
+		for (fr_i32 i = 0; i < SPECTRAL_FFT_SIZE; i++) {
+			pOutput[i] += pTime[i] * pWindow[i] * OutputScale;
+		}
+	}
+}
+
+void
+CSpectralChain::Process(fr_f32** ppData, fr_i32 Frames, EffectNodeStruct* pFirstEffect)
+{
+	fr_i32 Position = 0;
+	if (!Channels) return;
+
+	while (Position < Frames) {
+		fr_i32 ChunkFrames = std::min(Frames - Position, SPECTRAL_HOP_SIZE - HopPosition);
+		for (fr_i32 c = 0; c < Channels; c++) {
+			fr_f32* pData = ppData[c] + Position;
+			memcpy(InputFrames.GetBufferData(c) + SPECTRAL_FFT_SIZE - SPECTRAL_HOP_SIZE + HopPosition, pData, sizeof(fr_f32) * ChunkFrames);
+			memcpy(pData, OutputFrames.GetBufferData(c) + HopPosition, sizeof(fr_f32) * ChunkFrames);
+		}
+
+		Position += ChunkFrames;
+		HopPosition += ChunkFrames;
+		if (HopPosition == SPECTRAL_HOP_SIZE) {
+			ProcessFrame(pFirstEffect);
+			HopPosition = 0;
+		}
+	}
+}
@@ -0,0 +1,470 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2019-2020. All rights reserved.
+* Copyright (C) Suirless, 2020. All rights reserved.
+* Fresponze - fast, simple and modern multimedia sound library
+* Apache-2 License
+**********************************************************************
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*****************************************************************/
+#include "FresponzeStreaming.h"
+#include <numeric>
+
+CPrefetchCursor::CPrefetchCursor(IMediaCursor* pSource, fr_f32 AheadSeconds)
+{
+	AddRef();
+	pSource->Clone((void**)&pSourceCursor);
+	pSourceCursor->GetFormat(fileFormat);
+	AheadTime = AheadSeconds > 0.f ? AheadSeconds : PREFETCH_DEFAULT_AHEAD_TIME;
+}
+
+CPrefetchCursor::~CPrefetchCursor()
+{
+	_RELEASE(pSourceCursor);
+}
+
+void
+CPrefetchCursor::GetFormat(PcmFormat& format)
+{
+	format = fileFormat;
+}
+
+void
+CPrefetchCursor::SetFormat(PcmFormat outputFormat)
+{
+	/* Format is applied by prefetch thread, and consumer waits for new ring */
+	this->outputFormat = outputFormat;
+	NextPosition = -1;
+	RequestVersion.fetch_add(1, std::memory_order_release);
+	FormatVersion.fetch_add(1, std::memory_order_release);
+}
+
+fr_i32
+CPrefetchCursor::GetDelay()
+{
+	return SourceDelay.load(std::memory_order_relaxed);
+}
+
+fr_i64
+CPrefetchCursor::ReadRing(fr_f32** ppFloatData, fr_i64 FramesCount, fr_i32 Channels)
+{
+	fr_i64 FramesToRead = std::min(FramesCount, Ring.GetReadAvailable() / Channels);
+	if (FramesToRead <= 0) return 0;
+
+	ReadBuffer.Resize((fr_i32)(FramesToRead * Channels));
+	Ring.Read(ReadBuffer.Data(), FramesToRead * Channels);
+	if (ppFloatData) LinearToPlanar(ppFloatData, ReadBuffer.Data(), (fr_i32)(FramesToRead * Channels), Channels);
+	return FramesToRead;
+}
+
+fr_i64
+CPrefetchCursor::ReadAt(fr_i64 Position, fr_i64 FramesCount, fr_f32** ppFloatData, bool* pIsEnd)
+{
+	fr_i32 Channels = outputFormat.Channels;
+	fr_i32 Version = 0;
+	fr_i64 StreamEnd = -1;
+	fr_i64 FramesToReturn = FramesCount;
+	fr_i64 ReadedFrames = 0;
+	if (pIsEnd) *pIsEnd = false;
+	if (!ppFloatData || !Channels || FramesCount <= 0) return 0;
+
+	/* Random access: prefetch thread restarts decoding from new position */
+	if (Position != NextPosition) {
+		RequestedPosition.store(Position, std::memory_order_relaxed);
+		RequestVersion.fetch_add(1, std::memory_order_release);
+	}
+
+	Version = RequestVersion.load(std::memory_order_relaxed);
+	StreamEnd = EndPosition.load(std::memory_order_acquire);
+	if (StreamEnd >= 0) FramesToReturn = std::max(std::min(FramesCount, StreamEnd - Position), (fr_i64)0);
+
+	if (ReadyVersion.load(std::memory_order_acquire) == Version) {
+		if (ConsumedVersion != Version) {
+			RingPosition = ReadyPosition.load(std::memory_order_relaxed);
+			ConsumedVersion = Version;
+		}
+
+		/* Data which was decoded too late is skipped, so timeline of stream is kept */
+		if (RingPosition < Position) RingPosition += ReadRing(nullptr, Position - RingPosition, Channels);
+		if (RingPosition == Position) {
+			ReadedFrames = ReadRing(ppFloatData, FramesToReturn, Channels);
+			RingPosition += ReadedFrames;
+		}
+	}
+
+	for (fr_i32 i = 0; i < Channels; i++) {
+		memset(&ppFloatData[i][ReadedFrames], 0, (FramesCount - ReadedFrames) * sizeof(fr_f32));
+	}
+
+	if (ReadedFrames < FramesToReturn) StarvationsCount.fetch_add(1, std::memory_order_relaxed);
+	if (StreamEnd >= 0 && Position + FramesToReturn >= StreamEnd) {
+		/* Prefetch thread continues from the start of stream, so looping doesn't need seek */
+		if (pIsEnd) *pIsEnd = true;
+		NextPosition = 0;
+		if (RingPosition == StreamEnd) {
+			RingPosition = 0;
+		} else {
+			RequestedPosition.store(0, std::memory_order_relaxed);
+			RequestVersion.fetch_add(1, std::memory_order_release);
+		}
+
+		return FramesToReturn;
+	}
+
+	NextPosition = Position + FramesCount;
+	return FramesCount;
+}
+
+void
+CPrefetchCursor::Prepare(fr_i64 DecodePosition, fr_i64 ReadPosition)
+{
+	if (ReadPosition == NextPosition) return;
+	RequestedPosition.store(std::max(std::min(DecodePosition, ReadPosition), (fr_i64)0), std::memory_order_relaxed);
+	RequestVersion.fetch_add(1, std::memory_order_release);
+	NextPosition = ReadPosition;
+}
+
+fr_i64
+CPrefetchCursor::Prefetch()
+{
+	fr_i32 NewFormatVersion = FormatVersion.load(std::memory_order_acquire);
+	fr_i32 Version = RequestVersion.load(std::memory_order_acquire);
+
+	/* Consumer doesn't read ring now, because format change also changes request version */
+	if (NewFormatVersion != AppliedFormatVersion) {
+		fr_i64 AheadFrames = std::max((fr_i64)(AheadTime * outputFormat.SampleRate), (fr_i64)PREFETCH_BLOCK_FRAMES * 2);
+		pSourceCursor->SetFormat(outputFormat);
+		RingChannels = outputFormat.Channels;
+		Ring.Resize(AheadFrames * RingChannels);
+		DecodeBuffer.Resize(RingChannels, PREFETCH_BLOCK_FRAMES);
+		LinearBuffer.Resize(PREFETCH_BLOCK_FRAMES * RingChannels);
+		EndPosition.store(-1, std::memory_order_relaxed);
+		SourceDelay.store(pSourceCursor->GetDelay(), std::memory_order_relaxed);
+		AppliedFormatVersion = NewFormatVersion;
+		AppliedVersion = -1;
+	}
+
+	if (!RingChannels) return StarvationsCount.exchange(0, std::memory_order_relaxed);
+	if (Version != AppliedVersion) {
+		Ring.Reset();
+		DecodePosition = RequestedPosition.load(std::memory_order_relaxed);
+		ReadyPosition.store(DecodePosition, std::memory_order_relaxed);
+		AppliedVersion = Version;
+	}
+
+	while (Ring.GetWriteAvailable() >= (fr_i64)PREFETCH_BLOCK_FRAMES * RingChannels) {
+		bool IsEnd = false;
+		fr_i64 ReadedFrames = pSourceCursor->ReadAt(DecodePosition, PREFETCH_BLOCK_FRAMES, DecodeBuffer.GetBuffers(), &IsEnd);
+		if (ReadedFrames > 0) {
+			PlanarToLinear(DecodeBuffer.GetBuffers(), LinearBuffer.Data(), (fr_i32)(ReadedFrames * RingChannels), RingChannels);
+			Ring.Write(LinearBuffer.Data(), ReadedFrames * RingChannels);
+			DecodePosition += ReadedFrames;
+		}
+
+		/* End of stream is reported by cursor: store its length and continue from the start for looping */
+		if (IsEnd) {
+			if (DecodePosition <= 0) break;
+			EndPosition.store(DecodePosition, std::memory_order_release);
+			DecodePosition = 0;
+		} else if (ReadedFrames <= 0) {
+			/* Source can't give data now, try again on the next poll */
+			break;
+		}
+
+		if (RequestVersion.load(std::memory_order_relaxed) != AppliedVersion) break;
+	}
+
+	if (ReadyVersion.load(std::memory_order_relaxed) != AppliedVersion) ReadyVersion.store(AppliedVersion, std::memory_order_release);
+	return StarvationsCount.exchange(0, std::memory_order_relaxed);
+}
+
+CHeadCacheCursor::CHeadCacheCursor(IMediaCursor* pHead, CPrefetchCursor* pStream)
+{
+	AddRef();
+	pHead->Clone((void**)&pHeadCursor);
+	pStream->Clone((void**)&pStreamCursor);
+	pHeadCursor->GetFormat(headFormat);
+	pStreamCursor->GetFormat(fileFormat);
+}
+
+CHeadCacheCursor::~CHeadCacheCursor()
+{
+	_RELEASE(pHeadCursor);
+	_RELEASE(pStreamCursor);
+}
+
+void
+CHeadCacheCursor::GetFormat(PcmFormat& format)
+{
+	format = fileFormat;
+}
+
+void
+CHeadCacheCursor::SetFormat(PcmFormat outputFormat)
+{
+	fr_i64 StreamFrames = 0;
+	fr_i64 AlignFrames = 1;
+	fr_i64 TailFrames = 0;
+	CalculateFrames64(headFormat.Frames, headFormat.SampleRate, outputFormat.SampleRate, HeadFrames);
+	CalculateFrames64(fileFormat.Frames, fileFormat.SampleRate, outputFormat.SampleRate, StreamFrames);
+	IsWholeStream = HeadFrames >= StreamFrames;
+	Channels = outputFormat.Channels;
+	pHeadCursor->SetFormat(outputFormat);
+	pStreamCursor->SetFormat(outputFormat);
+
+	/* Output frames which are multiples of AlignFrames are exactly on input frames */
+	if (fileFormat.SampleRate > 0 && outputFormat.SampleRate > 0 && fileFormat.SampleRate != outputFormat.SampleRate) {
+		AlignFrames = outputFormat.SampleRate / std::gcd(outputFormat.SampleRate, fileFormat.SampleRate);
+		TailFrames = std::max((fr_i64)HEAD_CACHE_WARMUP_FRAMES, (fr_i64)pHeadCursor->GetDelay() * 2);
+	}
+
+	HandoffPosition = IsWholeStream ? HeadFrames : std::max(HeadFrames - TailFrames, (fr_i64)0);
+	WarmupPosition = std::max((HandoffPosition - HEAD_CACHE_WARMUP_FRAMES - TailFrames) / AlignFrames * AlignFrames, (fr_i64)0);
+
+	/* Stream is decoded behind head before the first read */
+	if (!IsWholeStream) pStreamCursor->Prepare(WarmupPosition, HandoffPosition);
+}
+
+fr_i32
+CHeadCacheCursor::GetDelay()
+{
+	return pStreamCursor->GetDelay();
+}
+
+fr_i64
+CHeadCacheCursor::ReadAt(fr_i64 Position, fr_i64 FramesCount, fr_f32** ppFloatData, bool* pIsEnd)
+{
+	fr_i64 HeadReaded = 0;
+	fr_f32* ppStreamData[MAX_CHANNELS] = {};
+	if (pIsEnd) *pIsEnd = false;
+	if (!ppFloatData || !Channels || FramesCount <= 0) return 0;
+	if (Position >= HandoffPosition) return pStreamCursor->ReadAt(Position, FramesCount, ppFloatData, pIsEnd);
+
+	HeadReaded = pHeadCursor->ReadAt(Position, std::min(FramesCount, HandoffPosition - Position), ppFloatData);
+	if (IsWholeStream) {
+		if (pIsEnd) *pIsEnd = HeadReaded < FramesCount;
+		for (fr_i32 i = 0; i < Channels; i++) {
+			memset(&ppFloatData[i][HeadReaded], 0, (FramesCount - HeadReaded) * sizeof(fr_f32));
+		}
+
+		return HeadReaded;
+	}
+
+	/* Playback is inside head, so stream must be ready at the end of it */
+	pStreamCursor->Prepare(WarmupPosition, HandoffPosition);
+	if (HeadReaded == FramesCount) return FramesCount;
+
+	for (fr_i32 i = 0; i < Channels; i++) {
+		ppStreamData[i] = &ppFloatData[i][HeadReaded];
+	}
+
+	return HeadReaded + pStreamCursor->ReadAt(Position + HeadReaded, FramesCount - HeadReaded, ppStreamData, pIsEnd);
+}
+
+CStreamPrefetcher::CStreamPrefetcher()
+{
+	AddRef();
+	pThreadEvent = CreatePlatformEvent();
+	hThread = CreateAudioThread(ThreadProc, this, false);
+	if (!hThread) TypeToLog("Streaming: can't create prefetch thread");
+}
+
+CStreamPrefetcher::~CStreamPrefetcher()
+{
+	CPrefetchCursor* pCursor = nullptr;
+	if (hThread) {
+		IsTerminating = true;
+		pThreadEvent->Raise();
+		JoinAudioThread(hThread);
+		hThread = nullptr;
+	}
+
+	while (NewCursors.Pop(pCursor)) {
+		_RELEASE(pCursor);
+	}
+
+	while (pFirstCursor) {
+		pCursor = pFirstCursor->pNext;
+		_RELEASE(pFirstCursor);
+		pFirstCursor = pCursor;
+	}
+
+	if (pThreadEvent) delete pThreadEvent;
+}
+
+void
+CStreamPrefetcher::ThreadProc(void* pContext)
+{
+	CStreamPrefetcher* pThis = (CStreamPrefetcher*)pContext;
+	while (!pThis->IsTerminating) {
+		pThis->PrefetchAll();
+		pThis->pThreadEvent->Wait(PREFETCH_POLL_TIME);
+	}
+}
+
+void
+CStreamPrefetcher::PrefetchAll()
+{
+	CPrefetchCursor* pCursor = nullptr;
+	CPrefetchCursor** ppCurrent = &pFirstCursor;
+	while (NewCursors.Pop(pCursor)) {
+		pCursor->pNext = pFirstCursor;
+		pFirstCursor = pCursor;
+	}
+
+	while (*ppCurrent) {
+		pCursor = *ppCurrent;
+
+		/* Nobody reads this cursor anymore */
+		if (pCursor->GetRefCount() <= 1) {
+			*ppCurrent = pCursor->pNext;
+			_RELEASE(pCursor);
+			continue;
+		}
+
+		StarvationsCount.fetch_add(pCursor->Prefetch(), std::memory_order_relaxed);
+		ppCurrent = &pCursor->pNext;
+	}
+}
+
+bool
+CStreamPrefetcher::AddCursor(CPrefetchCursor* pCursor)
+{
+	CPrefetchCursor* pNewCursor = nullptr;
+	if (!hThread || !pCursor) return false;
+
+	pCursor->Clone((void**)&pNewCursor);
+	if (!NewCursors.Push(pNewCursor)) {
+		_RELEASE(pNewCursor);
+		return false;
+	}
+
+	pThreadEvent->Raise();
+	return true;
+}
+
+fr_i64
+CStreamPrefetcher::GetStarvationsCount()
+{
+	return StarvationsCount.load(std::memory_order_relaxed);
+}
+
+CStreamedMediaResource::CStreamedMediaResource(IMediaResource* pSourceResource, CStreamPrefetcher* pStreamPrefetcher, fr_f32 AheadSeconds, IMediaResource* pHeadResource)
+{
+	AddRef();
+	pSourceResource->Clone((void**)&pSource);
+	pStreamPrefetcher->Clone((void**)&pPrefetcher);
+	if (pHeadResource) pHeadResource->Clone((void**)&pHead);
+	pSource->GetFormat(fileFormat);
+	AheadTime = AheadSeconds;
+}
+
+CStreamedMediaResource::~CStreamedMediaResource()
+{
+	_RELEASE(pSource);
+	_RELEASE(pHead);
+	_RELEASE(pPrefetcher);
+}
+
+bool
+CStreamedMediaResource::OpenResource(void* pResourceLinker)
+{
+	/* Source resource is already opened */
+	return true;
+}
+
+bool
+CStreamedMediaResource::CloseResource()
+{
+	return pSource->CloseResource();
+}
+
+void
+CStreamedMediaResource::GetFormat(PcmFormat& format)
+{
+	pSource->GetFormat(format);
+}
+
+void
+CStreamedMediaResource::SetFormat(PcmFormat outputFormat)
+{
+	pSource->SetFormat(outputFormat);
+}
+
+void
+CStreamedMediaResource::GetVendorName(const char*& vendorName)
+{
+	pSource->GetVendorName(vendorName);
+}
+
+void
+CStreamedMediaResource::GetVendorString(const char*& vendorString)
+{
+	pSource->GetVendorString(vendorString);
+}
+
+fr_i64
+CStreamedMediaResource::Read(fr_i64 FramesCount, fr_f32** ppFloatData)
+{
+	return pSource->Read(FramesCount, ppFloatData);
+}
+
+fr_i64
+CStreamedMediaResource::ReadRaw(fr_i64 FramesCount, fr_f32** ppFloatData)
+{
+	return pSource->ReadRaw(FramesCount, ppFloatData);
+}
+
+fr_i64
+CStreamedMediaResource::SetPosition(fr_i64 FramePosition)
+{
+	return pSource->SetPosition(FramePosition);
+}
+
+fr_i64
+CStreamedMediaResource::GetPosition()
+{
+	return pSource->GetPosition();
+}
+
+fr_i32
+CStreamedMediaResource::GetDelay()
+{
+	return pSource->GetDelay();
+}
+
+bool
+CStreamedMediaResource::CreateCursor(IMediaCursor*& pCursor)
+{
+	IMediaCursor* pSourceCursor = nullptr;
+	IMediaCursor* pHeadCursor = nullptr;
+	CPrefetchCursor* pNewCursor = nullptr;
+	if (!pSource->CreateCursor(pSourceCursor)) return false;
+
+	pNewCursor = new CPrefetchCursor(pSourceCursor, AheadTime);
+	_RELEASE(pSourceCursor);
+	if (!pPrefetcher->AddCursor(pNewCursor)) {
+		_RELEASE(pNewCursor);
+		return false;
+	}
+
+	/* Head cursor doesn't need prefetch thread, it reads decoded data */
+	if (pHead && pHead->CreateCursor(pHeadCursor)) {
+		pCursor = new CHeadCacheCursor(pHeadCursor, pNewCursor);
+		_RELEASE(pHeadCursor);
+		_RELEASE(pNewCursor);
+		return true;
+	}
+
+	pCursor = pNewCursor;
+	return true;
+}
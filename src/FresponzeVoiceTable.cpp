@@ -0,0 +1,160 @@
+/*********************************************************************
+* Copyright (C) Anton Kovalev (vertver), 2019-2020. All rights reserved.
+* Copyright (C) Suirless, 2020. All rights reserved.
+* Fresponze - fast, simple and modern multimedia sound library
+* Apache-2 License
+**********************************************************************
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*****************************************************************/
+#include "FresponzeVoiceTable.h"
+
+#define CACHE_LINE_SIZE 64
+#define ALIGN_TO_CACHE_LINE(x) (((x) + (CACHE_LINE_SIZE - 1)) & ~((size_t)CACHE_LINE_SIZE - 1))
+
+template<typename TYPE>
+static
+TYPE*
+TakeColumn(fr_u8*& pCurrent, fr_i32 Count)
+{
+	TYPE* pColumn = (TYPE*)pCurrent;
+	pCurrent += ALIGN_TO_CACHE_LINE(sizeof(TYPE) * Count);
+	return pColumn;
+}
+
+CVoiceTable::CVoiceTable(fr_i32 MaxVoicesCount)
+{
+	size_t ColumnsSize = 0;
+	fr_u8* pCurrent = nullptr;
+
+	Capacity = MaxVoicesCount;
+	ColumnsSize += ALIGN_TO_CACHE_LINE(sizeof(IBaseEmitter*) * Capacity);
+	ColumnsSize += ALIGN_TO_CACHE_LINE(sizeof(ListenersNode*) * Capacity);
+	ColumnsSize += ALIGN_TO_CACHE_LINE(sizeof(fr_i32) * Capacity);
+	ColumnsSize += ALIGN_TO_CACHE_LINE(sizeof(fr_f32) * Capacity);
+	ColumnsSize += ALIGN_TO_CACHE_LINE(sizeof(fr_i64) * Capacity);
+	ColumnsSize += ALIGN_TO_CACHE_LINE(sizeof(fr_i32) * Capacity);
+	ColumnsSize += ALIGN_TO_CACHE_LINE(sizeof(fr_f32) * Capacity);
+	ColumnsSize += ALIGN_TO_CACHE_LINE(sizeof(fr_i32) * Capacity);
+	ColumnsSize += ALIGN_TO_CACHE_LINE(sizeof(fr_i64) * Capacity);
+	ColumnsSize += ALIGN_TO_CACHE_LINE(sizeof(fr_i64) * Capacity);
+	ColumnsSize += ALIGN_TO_CACHE_LINE(sizeof(fr_i32) * Capacity);
+	ColumnsSize += ALIGN_TO_CACHE_LINE(sizeof(fr_i32) * Capacity);
+	ColumnsSize += ALIGN_TO_CACHE_LINE(sizeof(fr_u32) * Capacity);
+	ColumnsSize += ALIGN_TO_CACHE_LINE(sizeof(fr_i32) * Capacity);
+	ColumnsSize += ALIGN_TO_CACHE_LINE(sizeof(fr_i32) * Capacity);
+
+	pMemory = FastMemAlloc((fr_i32)(ColumnsSize + CACHE_LINE_SIZE));
+	memset(pMemory, 0, ColumnsSize + CACHE_LINE_SIZE);
+	pCurrent = (fr_u8*)ALIGN_TO_CACHE_LINE((size_t)pMemory);
+
+	pEmitters = TakeColumn<IBaseEmitter*>(pCurrent, Capacity);
+	pListeners = TakeColumn<ListenersNode*>(pCurrent, Capacity);
+	pStates = TakeColumn<fr_i32>(pCurrent, Capacity);
+	pGains = TakeColumn<fr_f32>(pCurrent, Capacity);
+	pPositions = TakeColumn<fr_i64>(pCurrent, Capacity);
+	pPriorities = TakeColumn<fr_i32>(pCurrent, Capacity);
+	pAudibilities = TakeColumn<fr_f32>(pCurrent, Capacity);
+	pFlags = TakeColumn<fr_i32>(pCurrent, Capacity);
+	pStartTimes = TakeColumn<fr_i64>(pCurrent, Capacity);
+	pStopTimes = TakeColumn<fr_i64>(pCurrent, Capacity);
+	pSlots = TakeColumn<fr_i32>(pCurrent, Capacity);
+	pOrder = TakeColumn<fr_i32>(pCurrent, Capacity);
+	pGenerations = TakeColumn<fr_u32>(pCurrent, Capacity);
+	pIndices = TakeColumn<fr_i32>(pCurrent, Capacity);
+	pFreeSlots = TakeColumn<fr_i32>(pCurrent, Capacity);
+
+	/* First free slot is on top of the stack */
+	for (fr_i32 i = 0; i < Capacity; i++) {
+		pGenerations[i] = 1;
+		pIndices[i] = -1;
+		pFreeSlots[i] = Capacity - i - 1;
+	}
+
+	FreeSlotsCount = Capacity;
+}
+
+CVoiceTable::~CVoiceTable()
+{
+	FreeFastMemory(pMemory);
+}
+
+VoiceHandle
+CVoiceTable::Add(IBaseEmitter* pEmitter, ListenersNode* pListNode)
+{
+	if (!FreeSlotsCount) return INVALID_VOICE_HANDLE;
+
+	fr_i32 Slot = pFreeSlots[--FreeSlotsCount];
+	fr_i32 VoiceIndex = VoicesCount++;
+	pEmitters[VoiceIndex] = pEmitter;
+	pListeners[VoiceIndex] = pListNode;
+	pStates[VoiceIndex] = pEmitter->GetState();
+	pGains[VoiceIndex] = 1.f;
+	pPositions[VoiceIndex] = pEmitter->GetPosition();
+	pPriorities[VoiceIndex] = pEmitter->GetPriority();
+	pAudibilities[VoiceIndex] = 1.f;
+	pFlags[VoiceIndex] = eVoiceRealFlag;
+	pStartTimes[VoiceIndex] = NO_SCHEDULED_TIME;
+	pStopTimes[VoiceIndex] = NO_SCHEDULED_TIME;
+	pSlots[VoiceIndex] = Slot;
+	pIndices[Slot] = VoiceIndex;
+
+	return ((VoiceHandle)pGenerations[Slot] << 32) | (VoiceHandle)(fr_u32)Slot;
+}
+
+fr_i32
+CVoiceTable::GetIndex(VoiceHandle Handle)
+{
+	fr_u32 Slot = (fr_u32)(Handle & 0xFFFFFFFF);
+	fr_u32 Generation = (fr_u32)(Handle >> 32);
+	if (Slot >= (fr_u32)Capacity || pGenerations[Slot] != Generation) return -1;
+	return pIndices[Slot];
+}
+
+void
+CVoiceTable::RemoveAt(fr_i32 VoiceIndex)
+{
+	fr_i32 Slot = pSlots[VoiceIndex];
+	fr_i32 LastIndex = --VoicesCount;
+
+	/* Move the last voice to free place */
+	if (VoiceIndex != LastIndex) {
+		pEmitters[VoiceIndex] = pEmitters[LastIndex];
+		pListeners[VoiceIndex] = pListeners[LastIndex];
+		pStates[VoiceIndex] = pStates[LastIndex];
+		pGains[VoiceIndex] = pGains[LastIndex];
+		pPositions[VoiceIndex] = pPositions[LastIndex];
+		pPriorities[VoiceIndex] = pPriorities[LastIndex];
+		pAudibilities[VoiceIndex] = pAudibilities[LastIndex];
+		pFlags[VoiceIndex] = pFlags[LastIndex];
+		pStartTimes[VoiceIndex] = pStartTimes[LastIndex];
+		pStopTimes[VoiceIndex] = pStopTimes[LastIndex];
+		pSlots[VoiceIndex] = pSlots[LastIndex];
+		pIndices[pSlots[VoiceIndex]] = VoiceIndex;
+	}
+
+	pEmitters[LastIndex] = nullptr;
+	pListeners[LastIndex] = nullptr;
+	pIndices[Slot] = -1;
+	if (!++pGenerations[Slot]) pGenerations[Slot] = 1;
+	pFreeSlots[FreeSlotsCount++] = Slot;
+}
+
+bool
+CVoiceTable::Remove(VoiceHandle Handle)
+{
+	fr_i32 VoiceIndex = GetIndex(Handle);
+	if (VoiceIndex < 0) return false;
+
+	RemoveAt(VoiceIndex);
+	return true;
+}
@@ -190,16 +190,52 @@ CRIFFMediaResource::Read(fr_i64 FramesCount, fr_f32** ppFloatData)
 fr_i64
 CRIFFMediaResource::ReadRaw(fr_i64 FramesCount, fr_f32** ppFloatData)
 {
+	ReadRawAt(FramePosition, FramesCount, ppFloatData);
+	FramePosition += FramesCount;
+	return true;
+}
+
+fr_i64
+CRIFFMediaResource::ReadRawAt(fr_i64 Position, fr_i64 FramesCount, fr_f32** ppFloatData)
+{
+	FramesCount = std::min(FramesCount, FileFrames - Position);
+	if (Position < 0 || FramesCount <= 0) return 0;
 
 	/* Convert interleaved to planar buffer */
 	for (fr_i64 i = 0; i < FramesCount * fileFormat.Channels; i++) {
-		transferBuffers[i % fileFormat.Channels][i / fileFormat.Channels] = this->GetSample(FramePosition * fileFormat.Channels + i);
+		ppFloatData[i % fileFormat.Channels][i / fileFormat.Channels] = GetSample(Position * fileFormat.Channels + i);
 	}
 
-	FramePosition += FramesCount;
+	return FramesCount;
+}
+
+bool
+CRIFFMediaResource::CreateCursor(IMediaCursor*& pCursor)
+{
+	if (!pMappedArea) return false;
+	pCursor = new CRIFFMediaCursor(this);
 	return true;
 }
 
+CRIFFMediaCursor::CRIFFMediaCursor(CRIFFMediaResource* pParentResource)
+{
+	AddRef();
+	pParentResource->Clone((void**)&pResource);
+	pResource->GetFormat(fileFormat);
+	outputFormat = fileFormat;
+}
+
+CRIFFMediaCursor::~CRIFFMediaCursor()
+{
+	_RELEASE(pResource);
+}
+
+fr_i64
+CRIFFMediaCursor::Decode(fr_i64 Position, fr_i64 FramesCount, fr_f32** ppFloatData)
+{
+	return pResource->ReadRawAt(Position, FramesCount, ppFloatData);
+}
+
 fr_i64 
 CRIFFMediaResource::SetPosition(fr_i64 FramePosition)
 {
@@ -212,4 +248,126 @@ fr_i64
 CRIFFMediaResource::GetPosition()
 {
 	return FramePosition;
-}
\ No newline at end of file
+}
+
+fr_i32
+CRIFFMediaResource::GetDelay()
+{
+	fr_i64 Delay = 0;
+	if (!resampler || !outputFormat.SampleRate || outputFormat.SampleRate == fileFormat.SampleRate) return 0;
+	CalculateFrames64(resampler->GetDelayTime(), fileFormat.SampleRate, outputFormat.SampleRate, Delay);
+	return (fr_i32)Delay;
+}
+
+CRIFFWriter::CRIFFWriter()
+{
+	AddRef();
+}
+
+CRIFFWriter::~CRIFFWriter()
+{
+	Close();
+}
+
+bool
+CRIFFWriter::Open(const fr_utf8* pFilePath, PcmFormat Format)
+{
+	Close();
+	if (!pFilePath || !Format.Channels || !Format.SampleRate) return false;
+
+#ifdef WINDOWS_PLATFORM
+	fr_wstring4k maxPathString = {};
+	if (MultiByteToWideChar(CP_UTF8, 0, pFilePath, -1, maxPathString, ARRAYSIZE(maxPathString)) <= 0) return false;
+	pFile = _wfopen(maxPathString, L"wb");
+#else
+	pFile = fopen(pFilePath, "wb");
+#endif
+	if (!pFile) {
+		TypeToLogFormated("RIFF writer: can't open file %s", pFilePath);
+		return false;
+	}
+
+	FileFormat = Format;
+	FileFormat.Bits = FileFormat.IsFloat ? 32 : 16;
+	DataBytes = 0;
+
+	/* Header with zero sizes, it will be rewritten on close */
+	if (!WriteHeader()) {
+		fclose(pFile);
+		pFile = nullptr;
+		return false;
+	}
+
+	return true;
+}
+
+bool
+CRIFFWriter::WriteHeader()
+{
+	wav_header Header = {};
+	memcpy(Header.riff_header, "RIFF", 4);
+	memcpy(Header.wave_header, "WAVE", 4);
+	memcpy(Header.fmt_header, "fmt ", 4);
+	memcpy(Header.data_header, "data", 4);
+	Header.fmt_chunk_size = 16;
+	Header.audio_format = FileFormat.IsFloat ? 3 : 1;
+	Header.num_channels = (fr_i16)FileFormat.Channels;
+	Header.sample_rate = FileFormat.SampleRate;
+	Header.bit_depth = (fr_i16)FileFormat.Bits;
+	Header.sample_alignment = (fr_i16)(FileFormat.Channels * FileFormat.Bits / 8);
+	Header.byte_rate = FileFormat.SampleRate * Header.sample_alignment;
+	Header.data_bytes = (fr_i32)DataBytes;
+	Header.wav_size = (fr_i32)(DataBytes + sizeof(wav_header) - 8);
+
+	if (fseek(pFile, 0, SEEK_SET)) return false;
+	return fwrite(&Header, sizeof(wav_header), 1, pFile) == 1;
+}
+
+bool
+CRIFFWriter::Write(fr_f32* pLinearData, fr_i64 FramesCount)
+{
+	fr_i64 SamplesCount = FramesCount * FileFormat.Channels;
+	fr_i64 BytesCount = SamplesCount * FileFormat.Bits / 8;
+	if (!pFile || !pLinearData) return false;
+	if (FramesCount <= 0) return true;
+
+	/* RIFF sizes are 32-bit values */
+	if (DataBytes + BytesCount + (fr_i64)sizeof(wav_header) > 0x7FFFFFFF) {
+		TypeToLog("RIFF writer: file size limit is reached");
+		return false;
+	}
+
+	if (FileFormat.IsFloat) {
+		if (fwrite(pLinearData, sizeof(fr_f32), (size_t)SamplesCount, pFile) != (size_t)SamplesCount) return false;
+	} else {
+		ConvertBuffer.Resize((fr_i32)SamplesCount);
+		fr_i16* pShortData = ConvertBuffer.Data();
+		for (fr_i64 i = 0; i < SamplesCount; i++) {
+			pShortData[i] = f32toi16(pLinearData[i]);
+		}
+
+		if (fwrite(pShortData, sizeof(fr_i16), (size_t)SamplesCount, pFile) != (size_t)SamplesCount) return false;
+	}
+
+	DataBytes += BytesCount;
+	return true;
+}
+
+bool
+CRIFFWriter::Close()
+{
+	bool IsWritten = true;
+	if (!pFile) return false;
+
+	IsWritten = WriteHeader();
+	if (fclose(pFile)) IsWritten = false;
+	pFile = nullptr;
+	return IsWritten;
+}
+
+fr_i64
+CRIFFWriter::GetWrittenFrames()
+{
+	if (!FileFormat.Channels || !FileFormat.Bits) return 0;
+	return DataBytes / (FileFormat.Channels * FileFormat.Bits / 8);
+}
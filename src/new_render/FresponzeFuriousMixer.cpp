@@ -17,223 +17,130 @@
 * limitations under the License.
 *****************************************************************/
 #include "FresponzeFuriousMixer.h"
-#include "FresponzeWavFile.h"
-#include "FresponzeOpusFile.h"
-#include "FresponzeMasterEmitter.h"
-#include "FresponzeResonanceEmitter.h"
 
-#define RING_BUFFERS_COUNT 2
-
-CFuriousMixer::CFuriousMixer()
-{
-	AddRef();
-}
-
-CFuriousMixer::~CFuriousMixer()
-{
-	FreeStuff();
-}
-
-void
-CFuriousMixer::FreeStuff()
-{
-	ListenersNode* pNode = pFirstListener;
-	while (pNode) {
-		ListenersNode* pNextNode = pNode->pNext;
-		_RELEASE(pNode->pListener);
-		pNode = pNextNode;
+CFuriousMixer::CFuriousMixer(fr_i32 ThreadsCount)
+{
+	/* Render thread is also working as first worker */
+	if (ThreadsCount <= 0) ThreadsCount = GetCPUCoresCount();
+	WorkersCount = std::min(std::max(ThreadsCount, 1), MAX_FURIOUS_WORKERS);
+	pWorkers = new FuriousWorker[WorkersCount];
+	pDoneEvent = CreatePlatformEvent();
+	for (fr_i32 i = 0; i < WorkersCount; i++) {
+		pWorkers[i].Index = i;
+		pWorkers[i].pMixer = this;
+		if (!i) continue;
+
+		pWorkers[i].pStartEvent = CreatePlatformEvent();
+		pWorkers[i].hThread = CreateAudioThread(WorkerThreadProc, &pWorkers[i], true);
+		if (!pWorkers[i].hThread) {
+			TypeToLogFormated("Furious mixer: can't create worker thread (%i workers are used)", i);
+			delete pWorkers[i].pStartEvent;
+			pWorkers[i].pStartEvent = nullptr;
+			WorkersCount = i;
+			break;
+		}
 	}
 }
 
-bool
-CFuriousMixer::SetNewFormat(PcmFormat fmt)
+CFuriousMixer::~CFuriousMixer()
 {
-	int counter = 0;
-	ListenersNode* pNode = pFirstListener;
-	while (pNode) {
-		if (pNode->pListener) pNode->pListener->SetFormat(fmt);
-		pNode = pNode->pNext;
-		counter++;
+	/* Producer thread uses workers, so we must stop it first */
+	StopProducer();
+	IsTerminating = true;
+	for (fr_i32 i = 1; i < WorkersCount; i++) {
+		pWorkers[i].pStartEvent->Raise();
+		JoinAudioThread(pWorkers[i].hThread);
+		delete pWorkers[i].pStartEvent;
 	}
 
-	return !!counter;
-}
-
-bool
-CFuriousMixer::SetMixFormat(PcmFormat& NewFormat)
-{
-	SetNewFormat(NewFormat);
-	SetBufferSamples(NewFormat.Frames);
-	MixFormat = NewFormat;
-	return true;
+	delete pDoneEvent;
+	delete[] pWorkers;
 }
 
-bool
-CFuriousMixer::GetMixFormat(PcmFormat& ThisFormat)
+void
+CFuriousMixer::WorkerThreadProc(void* pContext)
 {
-	ThisFormat = MixFormat;
-	return true;
-}
+	FuriousWorker* pWorker = (FuriousWorker*)pContext;
+	CFuriousMixer* pThis = pWorker->pMixer;
+	while (true) {
+		pWorker->pStartEvent->Wait();
+		if (pThis->IsTerminating) break;
 
-bool
-CFuriousMixer::CreateNode(ListenersNode*& pNode)
-{
-	ListenersNode* pCurrent = pLastListener;
-	if (!pCurrent) {
-		pLastListener = new ListenersNode;
-		pFirstListener = pLastListener;
-	}
-	else {
-		pLastListener->pNext = new ListenersNode;
-		pLastListener->pNext->pPrev = pLastListener;
-		pLastListener = pLastListener->pNext;
+		pThis->ProcessJob(pWorker, pWorker->TempBuffer, pWorker->Target);
+		if (pThis->PendingWorkers.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			pThis->pDoneEvent->Raise();
+		}
 	}
-
-	pNode = pLastListener;
-	return true;
 }
 
-bool
-CFuriousMixer::DeleteNode(ListenersNode* pNode)
+void
+CFuriousMixer::ProcessJob(FuriousWorker* pWorker, C2DFloatBuffer& TempBuffer, BusesMixTarget& Target)
 {
-	ListenersNode* pCurrent = pLastListener;
-	if (!pNode) return false;
-	while (pCurrent) {
-		if (pCurrent == pNode) {
-			if (pLastListener == pCurrent) pLastListener = pCurrent->pPrev;
-			if (pFirstListener == pCurrent) pFirstListener = pCurrent->pNext;
-			if (pCurrent->pPrev) pCurrent->pPrev->pNext = pCurrent->pNext;
-			if (pCurrent->pNext) pCurrent->pNext->pPrev = pCurrent->pPrev;
-			_RELEASE(pCurrent->pListener);
-			delete pCurrent;
-			return true;
+	ListenersNode** ppListeners = Voices.GetListeners();
+	for (fr_i32 i = 0; i < Voices.GetCount(); i++) {
+		if (ppListeners[i]->WorkerIndex == pWorker->Index) {
+			MixVoice(i, TempBuffer, Target, JobFrames, JobChannels);
 		}
-		pCurrent = pCurrent->pPrev;
 	}
-
-	return false;
-}
-
-// The MSVC compiler don't want to inline this function, so a rename it with 'D' prefix
-inline
-void*
-GetDFormatListener(char* pListenerOpenLink)
-{
-	if (!strcmp(GetFilePathFormat(pListenerOpenLink), ".wav")) return new CRIFFMediaResource();
-#ifdef FRESPONZE_USE_OPUS
-	if (!strcmp(GetFilePathFormat(pListenerOpenLink), ".opus")) return new COpusMediaResource();
-#endif
-	return nullptr;
 }
 
 bool
-CFuriousMixer::AddEmitterToListener(ListenersNode* pListener, IBaseEmitter* pEmmiter)
+CFuriousMixer::MixVoices(fr_i32 Frames, fr_i32 Channels)
 {
-	PcmFormat tempFormat = {};
-	if (!pListener->pListener->AddEmitter(pEmmiter)) return false;
-	pEmmiter->SetListener(pListener->pListener);
-
-	pListener->pListener->GetFormat(tempFormat);
-	pEmmiter->SetFormat(&tempFormat);
+	fr_i32 UsedWorkers = 0;
+	fr_i32 VoicesPerWorker = 0;
+	fr_i32 CurrentVoices = 0;
+	fr_i32 CurrentWorker = 0;
+	ListenersNode* pListNode = pFirstListener;
 
-	return true;
-}
+	UsedWorkers = std::min(WorkersCount, Voices.GetCount() / MIN_VOICES_PER_WORKER);
+	if (UsedWorkers <= 1) return CAdvancedMixer::MixVoices(Frames, Channels);
 
-bool
-CFuriousMixer::DeleteEmitterFromListener(ListenersNode* pListener, IBaseEmitter* pEmmiter)
-{
-	if (!pListener->pListener->DeleteEmitter(pEmmiter)) return false;
-	pEmmiter->SetListener(nullptr);
-	return true;
-}
-
-bool
-CFuriousMixer::CreateListener(void* pListenerOpenLink, ListenersNode*& pNewListener, PcmFormat ListFormat)
-{
-	if (!ListFormat.Bits) ListFormat = MixFormat;
+	/* 
+		Split listeners to contiguous groups with balanced voices count. 
+		Voices of one listener are always processed by the same worker.
+	*/
+	VoicesPerWorker = (Voices.GetCount() + UsedWorkers - 1) / UsedWorkers;
+	while (pListNode) {
+		if (CurrentVoices >= VoicesPerWorker && CurrentWorker < UsedWorkers - 1) {
+			CurrentWorker++;
+			CurrentVoices = 0;
+		}
 
-	IMediaResource* pNewResource = (IMediaResource*)GetDFormatListener((char*)pListenerOpenLink);
-	if (!pNewResource) return false;
-	if (!pNewResource->OpenResource(pListenerOpenLink)) {
-		_RELEASE(pNewResource);
-		return false;
+		pListNode->WorkerIndex = CurrentWorker;
+		CurrentVoices += pListNode->VoicesCount;
+		pListNode = pListNode->pNext;
 	}
 
-	if (ListFormat.Bits) pNewResource->SetFormat(ListFormat);
-	CreateNode(pNewListener);
-	pNewListener->pListener = new CMediaListener(pNewResource);
-	pNewListener->pListener->SetFormat(ListFormat);
-	return true;
-}
-
-bool
-CFuriousMixer::DeleteListener(ListenersNode* pListNode)
-{
-	return DeleteNode(pListNode);
-}
+	UsedWorkers = CurrentWorker + 1;
+	if (UsedWorkers <= 1) return CAdvancedMixer::MixVoices(Frames, Channels);
 
-bool
-CFuriousMixer::CreateEmitter(IBaseEmitter*& pEmitterToCreate, fr_i32 Type)
-{
-	switch (Type)
-	{
-	case 0: pEmitterToCreate = GetAdvancedEmitter(); break;
-	case 1: pEmitterToCreate = GetSteamEmitter(); break;
-	case 2: pEmitterToCreate = GetResonanceEmitter(); break;
-	default:
-		break;
+	JobFrames = Frames;
+	JobChannels = Channels;
+	for (fr_i32 i = 1; i < UsedWorkers; i++) {
+		pWorkers[i].TempBuffer.Resize(Channels, Frames);
+		pWorkers[i].Target.Reset(Channels, Frames);
 	}
 
-	return true;
-}
-
-bool
-CFuriousMixer::Record(fr_f32* pBuffer, fr_i32 Frames, fr_i32 Channels, fr_i32 SampleRate)
-{
-	return false;
-}
-
-bool
-CFuriousMixer::Update(fr_f32* pBuffer, fr_i32 Frames, fr_i32 Channels, fr_i32 SampleRate)
-{
-	fr_i32 UpdatedSamples = 0;
-	if (RingBuffer.GetLeftBuffers() <= 0) {
-		/* No buffers in queue - no data. Render it */
-		if (!Render(BufferedSamples, Channels, SampleRate)) return false;
+	PendingWorkers.store(UsedWorkers - 1, std::memory_order_release);
+	for (fr_i32 i = 1; i < UsedWorkers; i++) {
+		pWorkers[i].pStartEvent->Raise();
 	}
 
-	fr_i32 ret = RingBuffer.ReadData(pBuffer, Frames * Channels);
-	UpdatedSamples += ret / Channels;
-	/*
-		If we can't read more data because WASAPI or other output send
-		non-typical samples count query to ring buffer, we must render
-		data to push new data to required buffer with other write position
-	*/
-	if (UpdatedSamples < Frames) {
-		if (!Render(BufferedSamples, Channels, SampleRate)) return false;
-		ret = RingBuffer.ReadData(&pBuffer[ret], (Frames - UpdatedSamples) * Channels);
-		UpdatedSamples += ret / Channels;
-		if (UpdatedSamples < Frames) {
-			return false;
+	/* First job is processed in the render thread directly to mixer buses */
+	ProcessJob(&pWorkers[0], tempBuffer, BusesTarget);
+	pDoneEvent->Wait();
+
+	/* Reduce partial bus mixes in fixed order to get the same result every time */
+	for (fr_i32 i = 1; i < UsedWorkers; i++) {
+		for (fr_i32 Bus = 0; Bus < eAllBusesCount; Bus++) {
+			if (!pWorkers[i].Target.IsActive[Bus]) continue;
+			C2DFloatBuffer& BusBuffer = BusesTarget.GetBuffer(Bus);
+			for (fr_i32 o = 0; o < Channels; o++) {
+				MixerAddToBuffer(BusBuffer.GetBufferData(o), pWorkers[i].Target.Buffers[Bus].GetBufferData(o), Frames);
+			}
 		}
 	}
 
 	return true;
 }
-
-bool
-CFuriousMixer::Render(fr_i32 Frames, fr_i32 Channels, fr_i32 SampleRate)
-{
-	ListenersNode* pListNode = pFirstListener;
-	PcmFormat fmt = { };
-
-
-
-	return true;
-}
-
-bool
-CFuriousMixer::Flush()
-{
-	return true;
-}
@@ -17,40 +17,48 @@
 * limitations under the License.
 *****************************************************************/
 #pragma once
-#include "FresponzeMixer.h"
-#include "FresponzeListener.h"
+#include "FresponzeAdvancedMixer.h"
+#include <atomic>
 
-class CFuriousMixer : public IAdvancedMixer
+#define MAX_FURIOUS_WORKERS 16
+#define MIN_VOICES_PER_WORKER 8
+
+class CFuriousMixer;
+
+struct FuriousWorker
 {
-protected:
-	fr_i32 BufferedSamples = 0;
-	ListenersNode* pFirstListener = nullptr;
-	ListenersNode* pLastListener = nullptr;
+	fr_i32 Index = 0;
+	fr_ptr hThread = nullptr;
+	CFuriousMixer* pMixer = nullptr;
+	IBaseEvent* pStartEvent = nullptr;
+	C2DFloatBuffer TempBuffer;
+	BusesMixTarget Target;
+};
 
-	void FreeStuff();
-	bool SetNewFormat(PcmFormat fmt);
+/*
+	Parallel version of advanced mixer. Listeners are splitted to contiguous
+	groups with similar voices count, every group is processed by real-time 
+	worker with own scratch buffers, and partial mixes are summed in workers 
+	order, so the output doesn't depend on threads timings. Voices of one 
+	listener share the same media resource, so we never split listener 
+	between workers.
+*/
+class CFuriousMixer : public CAdvancedMixer
+{
+protected:
+	std::atomic<bool> IsTerminating = { false };
+	fr_i32 WorkersCount = 0;
+	fr_i32 JobFrames = 0;
+	fr_i32 JobChannels = 0;
+	std::atomic<fr_i32> PendingWorkers = { 0 };
+	IBaseEvent* pDoneEvent = nullptr;
+	FuriousWorker* pWorkers = nullptr;
 
-	bool CreateNode(ListenersNode*& pNode);
-	bool DeleteNode(ListenersNode* pNode);
+	static void WorkerThreadProc(void* pContext);
+	void ProcessJob(FuriousWorker* pWorker, C2DFloatBuffer& TempBuffer, BusesMixTarget& Target);
+	bool MixVoices(fr_i32 Frames, fr_i32 Channels) override;
 
 public:
-	CFuriousMixer();
+	CFuriousMixer(fr_i32 ThreadsCount = 0);
 	~CFuriousMixer();
-	void SetBufferSamples(fr_i32 SamplesIn) override { BufferedSamples = SamplesIn; }
-
-	bool SetMixFormat(PcmFormat& NewFormat) override;
-	bool GetMixFormat(PcmFormat& ThisFormat) override;
-
-	bool Record(fr_f32* pBuffer, fr_i32 Frames, fr_i32 Channels, fr_i32 SampleRate) override;
-	bool Update(fr_f32* pBuffer, fr_i32 Frames, fr_i32 Channels, fr_i32 SampleRate) override;
-	bool Render(fr_i32 Frames, fr_i32 Channels, fr_i32 SampleRate) override;
-	bool Flush() override;
-
-	bool AddEmitterToListener(ListenersNode* pListener, IBaseEmitter* pEmmiter) override;
-	bool DeleteEmitterFromListener(ListenersNode* pListener, IBaseEmitter* pEmmiter) override;
-
-	bool CreateListener(void* pListenerOpenLink /* local or internet link */, ListenersNode*& pNewListener, PcmFormat ListFormat = {}) override;
-	bool DeleteListener(ListenersNode* pListNode) override;
-
-	bool CreateEmitter(IBaseEmitter*& pEmitterToCreate, fr_i32 Type) override;
-};
\ No newline at end of file
+};
@@ -179,6 +179,12 @@ CAlsaAudioEndpoint::ThreadProc()
 
         }
 
+        /* Frames which are written to device, but not played yet */
+        snd_pcm_sframes_t DeviceDelay = 0;
+        if (!snd_pcm_delay(pAlsaHandle, &DeviceDelay)) {
+            pAudioCallback->LatencyCallback((fr_i32)DeviceDelay);
+        }
+
         /*
         while (AvailableFrames > 0) {
             fr_i32 TimeToSleep = (((double)AvailableFrames * 500.) / (double)EndpointInfo.EndpointFormat.SampleRate) ;
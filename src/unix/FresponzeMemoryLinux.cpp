@@ -18,6 +18,8 @@
 *****************************************************************/
 #include "FresponzeTypes.h"
 #include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
 #define ALIGN_SIZE(Size, AlSize)        ((Size + (AlSize-1)) & (~(AlSize-1)))
 #define ALIGN_SIZE_64K(Size)            ALIGN_SIZE(Size, 65536)
 #define ALIGN_SIZE_16(Size)             ALIGN_SIZE(Size, 16)
@@ -89,6 +91,68 @@ GetMapFileSystem()
     return nullptr;
 }
 
+struct PosixThreadContext
+{
+    bool IsRealtime;
+    FrThreadFunction* pThreadFunction;
+    void* pContext;
+};
+
+fr_ptr
+CreateAudioThread(
+        FrThreadFunction* pThreadFunction,
+        void* pContext,
+        bool IsRealtime
+)
+{
+    pthread_t* pThread = (pthread_t*)FastMemAlloc(sizeof(pthread_t));
+    PosixThreadContext* pThreadContext = (PosixThreadContext*)FastMemAlloc(sizeof(PosixThreadContext));
+    pThreadContext->IsRealtime = IsRealtime;
+    pThreadContext->pThreadFunction = pThreadFunction;
+    pThreadContext->pContext = pContext;
+
+    auto ThreadProc = [](void* pData) -> void* {
+        PosixThreadContext ThreadContext = *(PosixThreadContext*)pData;
+        FreeFastMemory(pData);
+        if (ThreadContext.IsRealtime) {
+            /* We can't get SCHED_FIFO without rights, so just try it and work as usual thread */
+            sched_param Param = {};
+            Param.sched_priority = sched_get_priority_max(SCHED_FIFO) - 1;
+            if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &Param)) {
+                TypeToLog("Threads: Can't set real-time priority to worker thread");
+            }
+        }
+
+        ThreadContext.pThreadFunction(ThreadContext.pContext);
+        return nullptr;
+    };
+
+    if (pthread_create(pThread, nullptr, ThreadProc, pThreadContext)) {
+        FreeFastMemory(pThreadContext);
+        FreeFastMemory(pThread);
+        return nullptr;
+    }
+
+    return pThread;
+}
+
+void
+JoinAudioThread(
+        fr_ptr pThreadHandle
+)
+{
+    if (!pThreadHandle) return;
+    pthread_join(*(pthread_t*)pThreadHandle, nullptr);
+    FreeFastMemory(pThreadHandle);
+}
+
+fr_i32
+GetCPUCoresCount()
+{
+    long CoresCount = sysconf(_SC_NPROCESSORS_ONLN);
+    return CoresCount > 0 ? (fr_i32)CoresCount : 1;
+}
+
 CPosixEvent::CPosixEvent()
 {
     m_id.signaled = false;
@@ -195,6 +195,9 @@ CWASAPIAudioEnpoint::ThreadProc()
 					goto EndOfThread; 
 				}
 
+				/* Padding is the data which is queued in device, but not played yet */
+				pAudioCallback->LatencyCallback((fr_i32)StreamPadding);
+
 				BYTE* pByte = nullptr;
 				INT32 AvailableFrames = FramesInBuffer;
 				AvailableFrames -= StreamPadding;
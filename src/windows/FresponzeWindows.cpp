@@ -17,6 +17,9 @@
 *****************************************************************/
 #include "FresponzeTypes.h"
 #include "FresponzeFileSystemWindows.h"
+#include <process.h>
+#include <avrt.h>
+#pragma comment(lib, "avrt.lib")
 #define ALIGN_SIZE(Size, AlSize)        ((Size + (AlSize-1)) & (~(AlSize-1)))
 #define ALIGN_SIZE_64K(Size)            ALIGN_SIZE(Size, 65536)
 #define ALIGN_SIZE_16(Size)             ALIGN_SIZE(Size, 16)
@@ -114,6 +117,71 @@ GetMapFileSystem()
 	return new CWindowsMapFile();
 }
 
+struct WindowsThreadContext
+{
+	bool IsRealtime;
+	FrThreadFunction* pThreadFunction;
+	void* pContext;
+};
+
+unsigned
+__stdcall
+AudioThreadProc(void* pData)
+{
+	DWORD dwTask = 0;
+	HANDLE hMMCSS = nullptr;
+	WindowsThreadContext ThreadContext = *(WindowsThreadContext*)pData;
+	FreeFastMemory(pData);
+	if (ThreadContext.IsRealtime) {
+		hMMCSS = AvSetMmThreadCharacteristicsA("Pro Audio", &dwTask);
+		if (IsInvalidHandle(hMMCSS)) TypeToLog("Threads: AvSetMmThreadCharacteristicsA() failed");
+		else AvSetMmThreadPriority(hMMCSS, AVRT_PRIORITY_CRITICAL);
+	}
+
+	ThreadContext.pThreadFunction(ThreadContext.pContext);
+	if (!IsInvalidHandle(hMMCSS)) AvRevertMmThreadCharacteristics(hMMCSS);
+	return 0;
+}
+
+fr_ptr
+CreateAudioThread(
+	FrThreadFunction* pThreadFunction,
+	void* pContext,
+	bool IsRealtime
+)
+{
+	WindowsThreadContext* pThreadContext = (WindowsThreadContext*)FastMemAlloc(sizeof(WindowsThreadContext));
+	pThreadContext->IsRealtime = IsRealtime;
+	pThreadContext->pThreadFunction = pThreadFunction;
+	pThreadContext->pContext = pContext;
+
+	HANDLE hThread = (HANDLE)_beginthreadex(nullptr, 0, AudioThreadProc, pThreadContext, 0, nullptr);
+	if (IsInvalidHandle(hThread)) {
+		FreeFastMemory(pThreadContext);
+		return nullptr;
+	}
+
+	return hThread;
+}
+
+void
+JoinAudioThread(
+	fr_ptr pThreadHandle
+)
+{
+	if (IsInvalidHandle(pThreadHandle)) return;
+	WaitForSingleObject((HANDLE)pThreadHandle, INFINITE);
+	CloseHandle((HANDLE)pThreadHandle);
+}
+
+fr_i32
+GetCPUCoresCount()
+{
+	SYSTEM_INFO sysInfo = {};
+	GetNativeSystemInfo(&sysInfo);
+	return sysInfo.dwNumberOfProcessors ? (fr_i32)sysInfo.dwNumberOfProcessors : 1;
+}
+
 CWinEvent::CWinEvent()
 {
 	hEvent = CreateEventEx(nullptr, nullptr, 0, EVENT_ALL_ACCESS);